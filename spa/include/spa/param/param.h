@@ -89,6 +89,9 @@ enum spa_param_io {
 	SPA_PARAM_IO_START,
 	SPA_PARAM_IO_id,	/**< type ID, uniquely identifies the io area (Id enum spa_io_type) */
 	SPA_PARAM_IO_size,	/**< size of the io area (Int) */
+	SPA_PARAM_IO_memId,	/**< id of the shared memory block with the io
+				  *  area, when the area is shared with the
+				  *  client (Int) */
 };
 
 enum spa_param_availability {
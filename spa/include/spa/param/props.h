@@ -85,6 +85,14 @@ enum spa_prop {
 	SPA_PROP_monitorVolumes,		/**< a volume array, one volume per
 						  *  channel (Array of Float) */
 	SPA_PROP_latencyOffsetNsec,		/**< delay adjustment */
+	SPA_PROP_volumeRampSamples,		/**< move volume changes in the same
+						  *  update to the new value over this
+						  *  many samples (Int) */
+	SPA_PROP_volumeRampStepSamples,		/**< take the exact ramp volume every
+						  *  this many samples and interpolate
+						  *  linearly in between (Int) */
+	SPA_PROP_volumeRampScale,		/**< the shape of the ramp (Id enum
+						  *  spa_prop_volume_ramp_scale) */
 
 	SPA_PROP_START_Video	= 0x20000,	/**< video related properties */
 	SPA_PROP_brightness,
@@ -99,6 +107,13 @@ enum spa_prop {
 	SPA_PROP_START_CUSTOM	= 0x1000000,
 };
 
+/** shape of a volume ramp */
+enum spa_prop_volume_ramp_scale {
+	SPA_PROP_VOLUME_RAMP_NONE,		/**< no ramp, change immediately */
+	SPA_PROP_VOLUME_RAMP_LINEAR,		/**< linear in amplitude */
+	SPA_PROP_VOLUME_RAMP_EXPONENTIAL,	/**< linear in dB */
+};
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
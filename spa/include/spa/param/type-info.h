@@ -82,6 +82,16 @@ static const struct spa_type_info spa_type_prop_monitor_volume[] = {
 	{ 0, 0, NULL, NULL },
 };
 
+#define SPA_TYPE_INFO_VolumeRampScale		SPA_TYPE_INFO_ENUM_BASE "VolumeRampScale"
+#define SPA_TYPE_INFO_VOLUME_RAMP_SCALE_BASE	SPA_TYPE_INFO_VolumeRampScale ":"
+
+static const struct spa_type_info spa_type_prop_volume_ramp_scale[] = {
+	{ SPA_PROP_VOLUME_RAMP_NONE, SPA_TYPE_Int, SPA_TYPE_INFO_VOLUME_RAMP_SCALE_BASE "none", NULL },
+	{ SPA_PROP_VOLUME_RAMP_LINEAR, SPA_TYPE_Int, SPA_TYPE_INFO_VOLUME_RAMP_SCALE_BASE "linear", NULL },
+	{ SPA_PROP_VOLUME_RAMP_EXPONENTIAL, SPA_TYPE_Int, SPA_TYPE_INFO_VOLUME_RAMP_SCALE_BASE "exponential", NULL },
+	{ 0, 0, NULL, NULL },
+};
+
 static const struct spa_type_info spa_type_props[] = {
 	{ SPA_PROP_START, SPA_TYPE_Id, SPA_TYPE_INFO_PROPS_BASE, spa_type_param, },
 	{ SPA_PROP_unknown, SPA_TYPE_None, SPA_TYPE_INFO_PROPS_BASE "unknown", NULL },
@@ -113,6 +123,9 @@ static const struct spa_type_info spa_type_props[] = {
 	{ SPA_PROP_monitorMute, SPA_TYPE_Bool, SPA_TYPE_INFO_PROPS_BASE "monitorMute", NULL },
 	{ SPA_PROP_monitorVolumes, SPA_TYPE_Array, SPA_TYPE_INFO_PROPS_BASE "monitorVolumes", spa_type_prop_monitor_volume },
 	{ SPA_PROP_latencyOffsetNsec, SPA_TYPE_Long, SPA_TYPE_INFO_PROPS_BASE "latencyOffsetNsec", NULL },
+	{ SPA_PROP_volumeRampSamples, SPA_TYPE_Int, SPA_TYPE_INFO_PROPS_BASE "volumeRampSamples", NULL },
+	{ SPA_PROP_volumeRampStepSamples, SPA_TYPE_Int, SPA_TYPE_INFO_PROPS_BASE "volumeRampStepSamples", NULL },
+	{ SPA_PROP_volumeRampScale, SPA_TYPE_Id, SPA_TYPE_INFO_PROPS_BASE "volumeRampScale", spa_type_prop_volume_ramp_scale },
 
 	{ SPA_PROP_brightness, SPA_TYPE_Int, SPA_TYPE_INFO_PROPS_BASE "brightness", NULL },
 	{ SPA_PROP_contrast, SPA_TYPE_Int, SPA_TYPE_INFO_PROPS_BASE "contrast", NULL },
@@ -159,6 +172,7 @@ static const struct spa_type_info spa_type_param_io[] = {
 	{ SPA_PARAM_IO_START, SPA_TYPE_Id, SPA_TYPE_INFO_PARAM_IO_BASE, spa_type_param, },
 	{ SPA_PARAM_IO_id, SPA_TYPE_Id, SPA_TYPE_INFO_PARAM_IO_BASE "id", spa_type_io },
 	{ SPA_PARAM_IO_size, SPA_TYPE_Int, SPA_TYPE_INFO_PARAM_IO_BASE "size", NULL },
+	{ SPA_PARAM_IO_memId, SPA_TYPE_Int, SPA_TYPE_INFO_PARAM_IO_BASE "memId", NULL },
 	{ 0, 0, NULL, NULL },
 };
 
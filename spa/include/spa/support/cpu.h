@@ -80,13 +80,49 @@ struct spa_cpu { struct spa_interface iface; };
 #define SPA_CPU_FLAG_ARMV8		(1 << 6)
 
 #define SPA_CPU_FORCE_AUTODETECT	((uint32_t)-1)
+
+#define SPA_CPU_CACHE_DATA		1	/**< data cache */
+#define SPA_CPU_CACHE_INSTRUCTION	2	/**< instruction cache */
+#define SPA_CPU_CACHE_UNIFIED		3	/**< unified data and instruction cache */
+
+/** a cache used by a CPU */
+struct spa_cpu_cache {
+	uint32_t level;			/**< cache level, 1 for L1 */
+	uint32_t type;			/**< one of SPA_CPU_CACHE_* */
+	uint32_t size;			/**< size in bytes */
+	uint32_t line_size;		/**< line size in bytes */
+	uint32_t n_shared;		/**< number of CPUs sharing this cache */
+};
+
+#define SPA_CPU_CORE_TYPE_UNKNOWN	0
+#define SPA_CPU_CORE_TYPE_PERFORMANCE	1	/**< a big or performance core */
+#define SPA_CPU_CORE_TYPE_EFFICIENCY	2	/**< a little or efficiency core */
+
+#define SPA_CPU_MAX_CACHES		8
+
+/** topology of one online CPU */
+struct spa_cpu_info {
+	uint32_t id;			/**< the logical CPU number */
+	uint32_t core_id;		/**< core, unique within the package */
+	uint32_t package_id;		/**< physical package */
+	uint32_t numa_node;		/**< NUMA node, 0 when unknown */
+	uint32_t core_type;		/**< one of SPA_CPU_CORE_TYPE_* */
+	uint32_t capacity;		/**< relative capacity, 1024 for the fastest
+					  *  CPU, 0 when unknown */
+	uint32_t max_freq;		/**< maximum frequency in kHz, 0 when unknown */
+	uint32_t n_siblings;		/**< number of hardware threads on this
+					  *  core, including this one */
+	uint32_t n_caches;		/**< number of valid caches */
+	struct spa_cpu_cache caches[SPA_CPU_MAX_CACHES];
+};
+
 /**
  * methods
  */
 struct spa_cpu_methods {
 	/** the version of the methods. This can be used to expand this
 	  structure in the future */
-#define SPA_VERSION_CPU_METHODS	0
+#define SPA_VERSION_CPU_METHODS	1
 	uint32_t version;
 
 	/** get CPU flags */
@@ -100,6 +136,30 @@ struct spa_cpu_methods {
 
 	/** get maximum required alignment of data */
 	uint32_t (*get_max_align) (void *object);
+
+	/**
+	 * Get the topology of an online CPU.
+	 *
+	 * The topology is read on the first call to this method or
+	 * get_cache_size.
+	 *
+	 * \param index the index of the CPU, starting from 0
+	 * \param info the result
+	 * \return 0 on success, -ENOENT when there are no more CPUs
+	 *
+	 * Since version 1
+	 */
+	int (*get_info) (void *object, uint32_t index, struct spa_cpu_info *info);
+
+	/**
+	 * Get the size of the largest cache of \a level used by \a cpu,
+	 * data and unified caches only.
+	 *
+	 * \return the size in bytes, 0 when unknown
+	 *
+	 * Since version 1
+	 */
+	uint32_t (*get_cache_size) (void *object, uint32_t cpu, uint32_t level);
 };
 
 #define spa_cpu_method(o,method,version,...)				\
@@ -115,6 +175,8 @@ struct spa_cpu_methods {
 #define spa_cpu_force_flags(c,f)	spa_cpu_method(c, force_flags, 0, f)
 #define spa_cpu_get_count(c)		spa_cpu_method(c, get_count, 0)
 #define spa_cpu_get_max_align(c)	spa_cpu_method(c, get_max_align, 0)
+#define spa_cpu_get_info(c,i,n)		spa_cpu_method(c, get_info, 1, i, n)
+#define spa_cpu_get_cache_size(c,p,l)	spa_cpu_method(c, get_cache_size, 1, p, l)
 
 /** keys can be given when initializing the cpu handle */
 #define SPA_KEY_CPU_FORCE		"cpu.force"		/**< force cpu flags */
@@ -0,0 +1,99 @@
+/* Simple Plugin API
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SPA_PARALLEL_H
+#define SPA_PARALLEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <spa/utils/defs.h>
+#include <spa/utils/hook.h>
+
+/**
+ * The parallel interface
+ *
+ * A small fork/join pool of worker threads that nodes can use to split
+ * independent work (ports, channels, sample blocks) inside one process
+ * call. The pool does not allocate or take locks while running and can
+ * be used from the data thread. The caller runs the tasks that no worker
+ * claimed yet and only waits for the tasks that are in progress, the
+ * workers run with realtime priority.
+ */
+#define SPA_TYPE_INTERFACE_Parallel	SPA_TYPE_INFO_INTERFACE_BASE "Parallel"
+
+#define SPA_VERSION_PARALLEL		0
+struct spa_parallel { struct spa_interface iface; };
+
+/** a task function, called with \a index in [0, n_tasks) */
+typedef void (*spa_parallel_func_t) (void *data, uint32_t index);
+
+/**
+ * methods
+ */
+struct spa_parallel_methods {
+	/** the version of the methods. This can be used to expand this
+	  structure in the future */
+#define SPA_VERSION_PARALLEL_METHODS	0
+	uint32_t version;
+
+	/** get the number of threads, including the caller, that
+	 * will execute tasks concurrently */
+	uint32_t (*get_n_threads) (void *object);
+
+	/** run \a func for each index in [0, \a n_tasks) and wait until
+	 * all tasks completed. The calling thread executes tasks as well.
+	 * Tasks must be independent, they can run in any order.
+	 *
+	 * \return 0 on success, < 0 on error.
+	 */
+	int (*run) (void *object, uint32_t n_tasks,
+			spa_parallel_func_t func, void *data);
+};
+
+#define spa_parallel_method(o,method,version,...)			\
+({									\
+	int _res = -ENOTSUP;						\
+	struct spa_parallel *_p = o;					\
+	spa_interface_call_res(&_p->iface,				\
+			struct spa_parallel_methods, _res,		\
+			method, version, ##__VA_ARGS__);		\
+	_res;								\
+})
+#define spa_parallel_get_n_threads(p)		spa_parallel_method(p, get_n_threads, 0)
+#define spa_parallel_run(p,...)			spa_parallel_method(p, run, 0, __VA_ARGS__)
+
+/** keys can be given when initializing the parallel handle */
+#define SPA_KEY_PARALLEL_THREADS	"parallel.threads"	/**< total number of threads,
+								  *  including the caller */
+#define SPA_KEY_PARALLEL_RT_PRIO	"parallel.rt.prio"	/**< realtime priority of the
+								  *  workers, 0 to not use
+								  *  realtime scheduling */
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* SPA_PARALLEL_H */
@@ -48,6 +48,7 @@ struct spa_system { struct spa_interface iface; };
 
 /* IO events */
 #define SPA_IO_IN	(1 << 0)
+#define SPA_IO_PRI	(1 << 1)
 #define SPA_IO_OUT	(1 << 2)
 #define SPA_IO_ERR	(1 << 3)
 #define SPA_IO_HUP	(1 << 4)
@@ -34,6 +34,7 @@ extern "C" {
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <locale.h>
 
 #include <spa/utils/defs.h>
 
@@ -188,13 +189,75 @@ static inline int spa_json_is_container(const char *val, int len)
 	return len > 0 && (*val == '{'  || *val == '[');
 }
 
+/** Get the length of the container that \a iter just returned in \a value
+ * and move \a iter to its closing bracket. The container is scanned with
+ * the states of spa_json_next(), so a '#' or '"' only starts a comment or
+ * a string between tokens, but the tokens are not returned or validated.
+ * When the container is not closed, the length goes up to the end of
+ * \a iter. */
 static inline int spa_json_container_len(struct spa_json *iter, const char *value, int len)
 {
-	const char *val;
-	struct spa_json sub;
-	spa_json_enter(iter, &sub);
-	while (spa_json_next(&sub, &val) > 0);
-	return sub.cur + 1 - value;
+	const char *p = iter->cur, *end = iter->end;
+	uint32_t depth = 0;
+	enum { __STRUCT, __BARE, __STRING, __ESC, __COMMENT } state = __STRUCT;
+
+	for (; p < end; p++) {
+ again:
+		switch (state) {
+		case __STRUCT:
+			switch (*p) {
+			case '\t': case ' ': case '\r': case '\n': case ':': case '=': case ',':
+				continue;
+			case '#':
+				state = __COMMENT;
+				continue;
+			case '"':
+				state = __STRING;
+				continue;
+			case '[': case '{':
+				depth++;
+				continue;
+			case '}': case ']':
+				if (depth == 0) {
+					iter->cur = p;
+					return p + 1 - value;
+				}
+				depth--;
+				continue;
+			default:
+				state = __BARE;
+			}
+			continue;
+		case __BARE:
+			switch (*p) {
+			case '\t': case ' ': case '\r': case '\n':
+			case ':': case ',': case '=': case ']': case '}':
+				state = __STRUCT;
+				goto again;
+			}
+			continue;
+		case __STRING:
+			switch (*p) {
+			case '\\':
+				state = __ESC;
+				continue;
+			case '"':
+				state = __STRUCT;
+			}
+			continue;
+		case __ESC:
+			state = __STRING;
+			continue;
+		case __COMMENT:
+			switch (*p) {
+			case '\n': case '\r':
+				state = __STRUCT;
+			}
+			continue;
+		}
+	}
+	iter->cur = end;
+	return end - value;
 }
 
 /* object */
@@ -223,11 +286,109 @@ static inline bool spa_json_is_null(const char *val, int len)
 	return len == 4 && strncmp(val, "null", 4) == 0;
 }
 
+/* number */
+
+/* Parse [+-]digits[.digits][(e|E)[+-]digits] into a mantissa and a decimal
+ * exponent. Returns false for anything else, like hex, inf or too many
+ * digits, so that the caller can use the slow path. */
+static inline bool spa_json_parse_decimal(const char *val, int len,
+		bool *neg, uint64_t *mantissa, int *exponent)
+{
+	const char *p = val, *end = val + len;
+	uint64_t m = 0;
+	int e = 0, x = 0, digits = 0;
+	bool eneg = false;
+
+	if (p < end && (*p == '-' || *p == '+'))
+		*neg = *p++ == '-';
+	else
+		*neg = false;
+
+	for (; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+		m = m * 10 + (*p - '0');
+	if (p < end && *p == '.') {
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++, e--)
+			m = m * 10 + (*p - '0');
+	}
+	if (digits == 0 || digits > 19)
+		return false;
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		if (++p < end && (*p == '-' || *p == '+'))
+			eneg = *p++ == '-';
+		if (p == end)
+			return false;
+		for (; p < end && *p >= '0' && *p <= '9'; p++) {
+			if ((x = x * 10 + (*p - '0')) > 1000)
+				return false;
+		}
+		e += eneg ? -x : x;
+	}
+	if (p != end)
+		return false;
+
+	*mantissa = m;
+	*exponent = e;
+	return true;
+}
+
+/* strtof with a '.' decimal point in any locale. The '.' is swapped for
+ * the decimal point of the locale in a terminated copy of the token, a
+ * token with the locale decimal point in it is not a float. Tokens that
+ * don't fit the copy are parsed in place. */
+static inline float spa_json_strtof(const char *val, int len, char **endp)
+{
+	const char *dp = localeconv()->decimal_point;
+	char buf[96], *p;
+	int i, j, dl = strlen(dp);
+	bool swap = dl != 1 || *dp != '.';
+	float res;
+
+	if (len * dl >= (int)sizeof(buf))
+		return strtof(val, endp);
+
+	for (i = 0, j = 0; i < len; i++) {
+		if (swap && val[i] == *dp) {
+			*endp = (char *)val + i;
+			return 0.0f;
+		}
+		if (swap && val[i] == '.') {
+			memcpy(&buf[j], dp, dl);
+			j += dl;
+		} else {
+			buf[j++] = val[i];
+		}
+	}
+	buf[j] = '\0';
+
+	res = strtof(buf, &p);
+	if (p == buf + j)
+		*endp = (char *)val + len;
+	else
+		*endp = (char *)val;
+	return res;
+}
+
 /* float */
 static inline int spa_json_parse_float(const char *val, int len, float *result)
 {
+	static const float powers[] = {
+		1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+	};
+	uint64_t m;
+	int e;
+	bool neg;
 	char *end;
-	*result = strtof(val, &end);
+
+	/* when both the mantissa and the power of 10 are exact floats, one
+	 * multiplication or division gives the correctly rounded result */
+	if (spa_json_parse_decimal(val, len, &neg, &m, &e) &&
+	    m <= (1u << 24) && e >= -10 && e <= 10) {
+		*result = e < 0 ? (float)m / powers[-e] : (float)m * powers[e];
+		if (neg)
+			*result = -*result;
+		return 1;
+	}
+	*result = spa_json_strtof(val, len, &end);
 	return end == val + len;
 }
 static inline bool spa_json_is_float(const char *val, int len)
@@ -247,9 +408,24 @@ static inline int spa_json_get_float(struct spa_json *iter, float *res)
 /* int */
 static inline int spa_json_parse_int(const char *val, int len, int *result)
 {
-	char *end;
-	*result = strtol(val, &end, 0);
-	return end == val + len;
+	const char *p = val, *end = val + len;
+	bool neg = false;
+	int64_t v = 0;
+	char *e;
+
+	/* decimal without a leading 0, the rest is octal or hex for strtol */
+	if (p < end && (*p == '-' || *p == '+'))
+		neg = *p++ == '-';
+	if (p < end && *p >= '1' && *p <= '9' && end - p <= 9) {
+		for (; p < end && *p >= '0' && *p <= '9'; p++)
+			v = v * 10 + (*p - '0');
+		if (p == end) {
+			*result = neg ? -v : v;
+			return 1;
+		}
+	}
+	*result = strtol(val, &e, 0);
+	return e == val + len;
 }
 static inline bool spa_json_is_int(const char *val, int len)
 {
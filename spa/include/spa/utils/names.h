@@ -35,6 +35,7 @@ extern "C" {
 #define SPA_NAME_SUPPORT_LOG		"support.log"			/**< A Log interface */
 #define SPA_NAME_SUPPORT_LOOP		"support.loop"			/**< A Loop/LoopControl/LoopUtils
 									  *  interface */
+#define SPA_NAME_SUPPORT_PARALLEL	"support.parallel"		/**< A Parallel interface */
 #define SPA_NAME_SUPPORT_SYSTEM		"support.system"		/**< A System interface */
 
 #define SPA_NAME_SUPPORT_NODE_DRIVER	"support.node.driver"		/**< A dummy driver node */
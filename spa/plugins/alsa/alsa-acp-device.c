@@ -28,6 +28,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <time.h>
 
 #include <alsa/asoundlib.h>
 
@@ -69,6 +70,28 @@ static void reset_props(struct props *props)
 	props->auto_port = DEFAULT_AUTO_PORT;
 }
 
+struct param_entry {
+	uint32_t index;
+	struct spa_pod *param;
+};
+
+/* prebuilt, unfiltered params of one id. The list is refcounted so that
+ * it stays alive while its params are emitted, even when a result
+ * callback causes a rebuild. */
+struct param_list {
+	int ref;
+	uint32_t n_entries;
+	struct param_entry *entries;
+};
+
+/* the cache is valid as long as generation matches the generation of
+ * the param */
+struct param_cache {
+	bool valid;
+	uint32_t generation;
+	struct param_list *list;
+};
+
 struct impl {
 	struct spa_handle handle;
 	struct spa_device device;
@@ -83,6 +106,8 @@ struct impl {
 #define IDX_EnumRoute		2
 #define IDX_Route		3
 	struct spa_param_info params[4];
+	uint32_t generation[4];
+	struct param_cache cache[4];
 
 	struct spa_hook_list hooks;
 
@@ -98,6 +123,33 @@ struct impl {
 
 static int emit_info(struct impl *this, bool full);
 
+static void param_changed(struct impl *this, uint32_t idx)
+{
+	this->info.change_mask |= SPA_DEVICE_CHANGE_MASK_PARAMS;
+	this->params[idx].user++;
+	this->generation[idx]++;
+}
+
+static void param_list_unref(struct param_list *list)
+{
+	uint32_t i;
+
+	if (--list->ref > 0)
+		return;
+	for (i = 0; i < list->n_entries; i++)
+		free(list->entries[i].param);
+	free(list->entries);
+	free(list);
+}
+
+static void clear_cache(struct param_cache *cache)
+{
+	if (cache->list)
+		param_list_unref(cache->list);
+	cache->list = NULL;
+	cache->valid = false;
+}
+
 static void handle_acp_poll(struct spa_source *source)
 {
 	struct impl *this = source->data;
@@ -460,88 +512,190 @@ static struct acp_port *find_port_for_device(struct acp_card *card, struct acp_d
 	return NULL;
 }
 
-static int impl_enum_params(void *object, int seq,
-			    uint32_t id, uint32_t start, uint32_t num,
-			    const struct spa_pod *filter)
+static int param_id_to_idx(uint32_t id)
 {
-	struct impl *this = object;
-	struct spa_pod *param;
+	switch (id) {
+	case SPA_PARAM_EnumProfile:
+		return IDX_EnumProfile;
+	case SPA_PARAM_Profile:
+		return IDX_Profile;
+	case SPA_PARAM_EnumRoute:
+		return IDX_EnumRoute;
+	case SPA_PARAM_Route:
+		return IDX_Route;
+	default:
+		return -ENOENT;
+	}
+}
+
+static int add_entry(struct param_list *list, uint32_t index, const struct spa_pod *param)
+{
+	struct param_entry *entries;
+
+	if (param == NULL)
+		return -errno;
+
+	entries = realloc(list->entries, (list->n_entries + 1) * sizeof(*entries));
+	if (entries == NULL)
+		return -errno;
+	list->entries = entries;
+
+	if ((param = spa_pod_copy(param)) == NULL)
+		return -errno;
+
+	entries[list->n_entries].index = index;
+	entries[list->n_entries].param = (struct spa_pod *)param;
+	list->n_entries++;
+	return 0;
+}
+
+static int build_cache(struct impl *this, uint32_t id, struct param_cache *cache)
+{
+	struct param_list *list;
 	struct spa_pod_builder b = { 0 };
 	uint8_t buffer[4096];
-	struct spa_result_device_params result;
-	uint32_t count = 0;
-	struct acp_card *card;
+	struct acp_card *card = this->card;
 	struct acp_card_profile *pr;
 	struct acp_port *p;
 	struct acp_device *dev;
+	uint32_t i;
+	int res = 0;
 
-	spa_return_val_if_fail(this != NULL, -EINVAL);
-	spa_return_val_if_fail(num != 0, -EINVAL);
-
-	card = this->card;
-
-	result.id = id;
-	result.next = start;
-      next:
-	result.index = result.next++;
-
-	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	if ((list = calloc(1, sizeof(*list))) == NULL)
+		return -errno;
+	list->ref = 1;
 
 	switch (id) {
 	case SPA_PARAM_EnumProfile:
-		if (result.index >= card->n_profiles)
-			return 0;
-
-		pr = card->profiles[result.index];
-		param = build_profile(&b, id, pr, false);
+		for (i = 0; i < card->n_profiles && res >= 0; i++) {
+			spa_pod_builder_init(&b, buffer, sizeof(buffer));
+			pr = card->profiles[i];
+			res = add_entry(list, i, build_profile(&b, id, pr, false));
+		}
 		break;
 
 	case SPA_PARAM_Profile:
-		if (result.index > 0 || card->active_profile_index >= card->n_profiles)
-			return 0;
+		if (card->active_profile_index >= card->n_profiles)
+			break;
 
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
 		pr = card->profiles[card->active_profile_index];
-		param = build_profile(&b, id, pr, true);
+		res = add_entry(list, 0, build_profile(&b, id, pr, true));
 		break;
 
 	case SPA_PARAM_EnumRoute:
-		if (result.index >= card->n_ports)
-			return 0;
-
-		p = card->ports[result.index];
-		param = build_route(&b, id, p, NULL, SPA_ID_INVALID);
+		for (i = 0; i < card->n_ports && res >= 0; i++) {
+			spa_pod_builder_init(&b, buffer, sizeof(buffer));
+			p = card->ports[i];
+			res = add_entry(list, i, build_route(&b, id, p, NULL, SPA_ID_INVALID));
+		}
 		break;
 
 	case SPA_PARAM_Route:
-		while (true) {
-			if (result.index >= card->n_devices)
-				return 0;
-
-			dev = card->devices[result.index];
-			if (SPA_FLAG_IS_SET(dev->flags, ACP_DEVICE_ACTIVE) &&
-			    (p = find_port_for_device(card, dev)) != NULL)
-				break;
+		for (i = 0; i < card->n_devices && res >= 0; i++) {
+			dev = card->devices[i];
+			if (!SPA_FLAG_IS_SET(dev->flags, ACP_DEVICE_ACTIVE) ||
+			    (p = find_port_for_device(card, dev)) == NULL)
+				continue;
 
-			result.index++;
+			spa_pod_builder_init(&b, buffer, sizeof(buffer));
+			res = add_entry(list, i, build_route(&b, id, p, dev,
+						card->active_profile_index));
 		}
-		result.next = result.index + 1;
-		param = build_route(&b, id, p, dev, card->active_profile_index);
-		if (param == NULL)
-			return -errno;
 		break;
 
 	default:
-		return -ENOENT;
+		res = -ENOENT;
+		break;
+	}
+	if (res < 0) {
+		param_list_unref(list);
+		return res;
 	}
+	/* a list that is being emitted is freed when the emit is done */
+	clear_cache(cache);
+	cache->list = list;
+	return 0;
+}
+
+static int update_cache(struct impl *this, uint32_t id, uint32_t idx)
+{
+	struct param_cache *cache = &this->cache[idx];
+	struct timespec ts1, ts2;
+	uint64_t elapsed;
+	int res;
+
+	if (cache->valid && cache->generation == this->generation[idx])
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts1);
+	if ((res = build_cache(this, id, cache)) < 0)
+		return res;
+	clock_gettime(CLOCK_MONOTONIC, &ts2);
+
+	cache->generation = this->generation[idx];
+	cache->valid = true;
+
+	elapsed = (SPA_TIMESPEC_TO_NSEC(&ts2) - SPA_TIMESPEC_TO_NSEC(&ts1)) / SPA_NSEC_PER_USEC;
+	spa_log_debug(this->log, NAME" %p: card %d built %d params of id %d in %"PRIu64" usec",
+			this, this->card->index, cache->list->n_entries, id, elapsed);
+	return 0;
+}
+
+static int impl_enum_params(void *object, int seq,
+			    uint32_t id, uint32_t start, uint32_t num,
+			    const struct spa_pod *filter)
+{
+	struct impl *this = object;
+	struct spa_pod *param;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[4096];
+	struct spa_result_device_params result;
+	struct param_list *list;
+	uint32_t i, count = 0;
+	int idx, res;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(num != 0, -EINVAL);
 
-	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
-		goto next;
+	if ((idx = param_id_to_idx(id)) < 0)
+		return idx;
 
-	spa_device_emit_result(&this->hooks, seq, 0,
-			SPA_RESULT_TYPE_DEVICE_PARAMS, &result);
+	if ((res = update_cache(this, id, idx)) < 0)
+		return res;
 
-	if (++count != num)
-		goto next;
+	/* keep the list alive, a result callback can enumerate again and
+	 * replace the cached list */
+	list = this->cache[idx].list;
+	list->ref++;
+
+	result.id = id;
+
+	for (i = 0; i < list->n_entries; i++) {
+		struct param_entry *e = &list->entries[i];
+
+		if (e->index < start)
+			continue;
+
+		result.index = e->index;
+		result.next = e->index + 1;
+
+		if (filter == NULL) {
+			result.param = e->param;
+		} else {
+			spa_pod_builder_init(&b, buffer, sizeof(buffer));
+			if (spa_pod_filter(&b, &param, e->param, filter) < 0)
+				continue;
+			result.param = param;
+		}
+
+		spa_device_emit_result(&this->hooks, seq, 0,
+				SPA_RESULT_TYPE_DEVICE_PARAMS, &result);
+
+		if (++count == num)
+			break;
+	}
+	param_list_unref(list);
 
 	return 0;
 }
@@ -622,6 +776,8 @@ static int impl_set_param(void *object,
 		}
 
 		res = acp_card_set_profile(this->card, id, save ? ACP_PROFILE_SAVE : 0);
+		/* the save flag is not signaled with an event */
+		this->generation[IDX_Profile]++;
 		emit_info(this, false);
 		break;
 	}
@@ -652,6 +808,7 @@ static int impl_set_param(void *object,
 		res = acp_device_set_port(dev, id, save ? ACP_PORT_SAVE : 0);
 		if (props)
 			apply_device_props(this, dev, props);
+		this->generation[IDX_Route]++;
 		emit_info(this, false);
 		break;
 	}
@@ -707,10 +864,9 @@ static void card_profile_changed(void *data, uint32_t old_index, uint32_t new_in
 	}
 	setup_sources(this);
 
-	this->info.change_mask |= SPA_DEVICE_CHANGE_MASK_PARAMS;
-	this->params[IDX_Profile].user++;
-	this->params[IDX_Route].user++;
-	this->params[IDX_EnumRoute].user++;
+	param_changed(this, IDX_Profile);
+	param_changed(this, IDX_Route);
+	param_changed(this, IDX_EnumRoute);
 }
 
 static void card_profile_available(void *data, uint32_t index,
@@ -723,9 +879,8 @@ static void card_profile_available(void *data, uint32_t index,
 	spa_log_info(this->log, "card profile %s available %s -> %s", p->name,
 			acp_available_str(old), acp_available_str(available));
 
-	this->info.change_mask |= SPA_DEVICE_CHANGE_MASK_PARAMS;
-	this->params[IDX_EnumProfile].user++;
-	this->params[IDX_Profile].user++;
+	param_changed(this, IDX_EnumProfile);
+	param_changed(this, IDX_Profile);
 
 	if (this->props.auto_profile) {
 		uint32_t best = acp_card_find_best_profile_index(card, NULL);
@@ -743,8 +898,7 @@ static void card_port_changed(void *data, uint32_t old_index, uint32_t new_index
 	spa_log_info(this->log, "card port changed from %s to %s",
 			op->name, np->name);
 
-	this->info.change_mask |= SPA_DEVICE_CHANGE_MASK_PARAMS;
-	this->params[IDX_Route].user++;
+	param_changed(this, IDX_Route);
 }
 
 static void card_port_available(void *data, uint32_t index,
@@ -757,9 +911,8 @@ static void card_port_available(void *data, uint32_t index,
 	spa_log_info(this->log, "card port %s available %s -> %s", p->name,
 			acp_available_str(old), acp_available_str(available));
 
-	this->info.change_mask |= SPA_DEVICE_CHANGE_MASK_PARAMS;
-	this->params[IDX_EnumRoute].user++;
-	this->params[IDX_Route].user++;
+	param_changed(this, IDX_EnumRoute);
+	param_changed(this, IDX_Route);
 
 	if (this->props.auto_port) {
 		uint32_t i;
@@ -781,16 +934,14 @@ static void on_volume_changed(void *data, struct acp_device *dev)
 {
 	struct impl *this = data;
 	spa_log_info(this->log, "device %s volume changed", dev->name);
-	this->info.change_mask |= SPA_DEVICE_CHANGE_MASK_PARAMS;
-	this->params[IDX_Route].user++;
+	param_changed(this, IDX_Route);
 }
 
 static void on_mute_changed(void *data, struct acp_device *dev)
 {
 	struct impl *this = data;
 	spa_log_info(this->log, "device %s mute changed", dev->name);
-	this->info.change_mask |= SPA_DEVICE_CHANGE_MASK_PARAMS;
-	this->params[IDX_Route].user++;
+	param_changed(this, IDX_Route);
 }
 
 static void on_set_soft_volume(void *data, struct acp_device *dev,
@@ -889,7 +1040,11 @@ static SPA_PRINTF_FUNC(6,0) void impl_acp_log_func(void *data,
 static int impl_clear(struct spa_handle *handle)
 {
 	struct impl *this = (struct impl *) handle;
+	uint32_t i;
+
 	remove_sources(this);
+	for (i = 0; i < SPA_N_ELEMENTS(this->cache); i++)
+		clear_cache(&this->cache[i]);
 	if (this->card) {
 		acp_card_destroy(this->card);
 		this->card = NULL;
@@ -0,0 +1,242 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/buffer/buffer.h>
+#include <spa/control/control.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/param/props.h>
+#include <spa/pod/builder.h>
+
+#include "test-helper.h"
+
+#define CHANNELS	2
+#define MAX_SAMPLES	1024
+#define MAX_COUNT	20000
+#define RAMP_STEP	32
+
+static const uint32_t sample_counts[] = { 256, 1024 };
+
+struct port_data {
+	struct spa_io_buffers io;
+	struct spa_buffer buffer;
+	struct spa_buffer *buffers[1];
+	struct spa_data datas[CHANNELS];
+	struct spa_chunk chunks[CHANNELS];
+};
+
+static struct port_data ports[3];
+static float planar[2][CHANNELS][MAX_SAMPLES] SPA_ALIGNED(64);
+static uint8_t control[2][32 * 1024] SPA_ALIGNED(8);
+
+static const struct spa_handle_factory *find_factory(const char *name)
+{
+	uint32_t index = 0;
+	const struct spa_handle_factory *factory;
+
+	while (spa_handle_factory_enum(&factory, &index) == 1) {
+		if (strcmp(factory->name, name) == 0)
+			return factory;
+	}
+	return NULL;
+}
+
+static void setup_port(struct spa_node *node, enum spa_direction direction, uint32_t port_id,
+		struct port_data *pd, const struct spa_pod *format,
+		uint32_t n_datas, void **data, uint32_t size, uint32_t status)
+{
+	uint32_t i;
+	int res;
+
+	res = spa_node_port_set_param(node, direction, port_id, SPA_PARAM_Format, 0, format);
+	spa_assert(res >= 0);
+
+	for (i = 0; i < n_datas; i++) {
+		pd->chunks[i] = (struct spa_chunk) { .offset = 0, .size = size, };
+		pd->datas[i] = (struct spa_data) {
+			.type = SPA_DATA_MemPtr,
+			.maxsize = size,
+			.data = data[i],
+			.chunk = &pd->chunks[i],
+		};
+	}
+	pd->buffer = (struct spa_buffer) { .n_datas = n_datas, .datas = pd->datas, };
+	pd->buffers[0] = &pd->buffer;
+
+	res = spa_node_port_use_buffers(node, direction, port_id, 0, pd->buffers, 1);
+	spa_assert(res == 0);
+
+	pd->io = SPA_IO_BUFFERS_INIT;
+	pd->io.status = status;
+	pd->io.buffer_id = 0;
+	res = spa_node_port_set_io(node, direction, port_id, SPA_IO_Buffers,
+			&pd->io, sizeof(pd->io));
+	spa_assert(res == 0);
+}
+
+/* one volume change every RAMP_STEP samples, each in its own control */
+static uint32_t build_events(void *data, uint32_t n_samples, float target, uint32_t scale)
+{
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(data, sizeof(control[0]));
+	struct spa_pod_frame f[1];
+	float start = 1.0f - target;
+	uint32_t i;
+
+	spa_pod_builder_push_sequence(&b, &f[0], 0);
+	for (i = 0; i < n_samples; i += RAMP_STEP) {
+		spa_pod_builder_control(&b, i, SPA_CONTROL_Properties);
+		spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_Props, 0,
+				SPA_PROP_volume, SPA_POD_Float(start +
+					(target - start) * (i + RAMP_STEP) / n_samples));
+	}
+	spa_pod_builder_pop(&b, &f[0]);
+	return b.state.offset;
+}
+
+/* the same curve as one ramp */
+static uint32_t build_ramp(void *data, uint32_t n_samples, float target, uint32_t scale)
+{
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(data, sizeof(control[0]));
+	struct spa_pod_frame f[1];
+
+	spa_pod_builder_push_sequence(&b, &f[0], 0);
+	spa_pod_builder_control(&b, 0, SPA_CONTROL_Properties);
+	spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Props, 0,
+			SPA_PROP_volume, SPA_POD_Float(target),
+			SPA_PROP_volumeRampSamples, SPA_POD_Int(n_samples),
+			SPA_PROP_volumeRampStepSamples, SPA_POD_Int(RAMP_STEP),
+			SPA_PROP_volumeRampScale, SPA_POD_Id(scale));
+	spa_pod_builder_pop(&b, &f[0]);
+	return b.state.offset;
+}
+
+static void run_test(const char *label, uint32_t n_samples,
+		uint32_t (*build) (void *data, uint32_t n_samples, float target, uint32_t scale),
+		uint32_t scale)
+{
+	const struct spa_handle_factory *factory;
+	struct spa_handle *handle;
+	struct spa_node *node;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *format, *ctrl_format;
+	struct spa_audio_info_raw info;
+	struct timespec ts;
+	uint64_t t1, t2, elapsed;
+	void *datas[CHANNELS], *ctrl_data[1] = { control[0] };
+	uint32_t i, size;
+	void *iface;
+	int res;
+
+	factory = find_factory(SPA_NAME_AUDIO_PROCESS_CHANNELMIX);
+	spa_assert(factory != NULL);
+
+	handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+	spa_assert(handle != NULL);
+	res = spa_handle_factory_init(factory, handle, NULL, NULL, 0);
+	spa_assert(res >= 0);
+	res = spa_handle_get_interface(handle, SPA_TYPE_INTERFACE_Node, &iface);
+	spa_assert(res >= 0);
+	node = iface;
+
+	spa_zero(info);
+	info.format = SPA_AUDIO_FORMAT_F32P;
+	info.rate = 48000;
+	info.channels = CHANNELS;
+	info.position[0] = SPA_AUDIO_CHANNEL_FL;
+	info.position[1] = SPA_AUDIO_CHANNEL_FR;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	format = spa_format_audio_raw_build(&b, SPA_PARAM_Format, &info);
+	ctrl_format = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Format, SPA_PARAM_Format,
+			SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_application),
+			SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_control));
+
+	for (i = 0; i < CHANNELS; i++)
+		datas[i] = planar[0][i];
+	setup_port(node, SPA_DIRECTION_INPUT, 0, &ports[0], format,
+			CHANNELS, datas, n_samples * sizeof(float), SPA_STATUS_HAVE_DATA);
+	for (i = 0; i < CHANNELS; i++)
+		datas[i] = planar[1][i];
+	setup_port(node, SPA_DIRECTION_OUTPUT, 0, &ports[1], format,
+			CHANNELS, datas, n_samples * sizeof(float), SPA_STATUS_NEED_DATA);
+
+	/* fade out and in on alternate cycles */
+	size = build(control[0], n_samples, 0.0f, scale);
+	size = SPA_MAX(size, build(control[1], n_samples, 1.0f, scale));
+	setup_port(node, SPA_DIRECTION_INPUT, 1, &ports[2], ctrl_format,
+			1, ctrl_data, size, SPA_STATUS_HAVE_DATA);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		ports[0].io.status = SPA_STATUS_HAVE_DATA;
+		ports[1].io.status = SPA_STATUS_NEED_DATA;
+		ports[2].io.status = SPA_STATUS_HAVE_DATA;
+		ports[2].datas[0].data = control[i & 1];
+		spa_node_process(node);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+	elapsed = t2 - t1;
+
+	fprintf(stderr, "%-20s samples %4d, controls %5u bytes: %8"PRIu64" nsec/cycle\n",
+			label, n_samples, size, elapsed / MAX_COUNT);
+
+	spa_handle_clear(handle);
+	free(handle);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i, j;
+
+	for (i = 0; i < CHANNELS; i++)
+		for (j = 0; j < MAX_SAMPLES; j++)
+			planar[0][i][j] = 0.5f;
+
+	for (i = 0; i < SPA_N_ELEMENTS(sample_counts); i++) {
+		run_test("per-event", sample_counts[i], build_events, 0);
+		run_test("linear ramp", sample_counts[i], build_ramp,
+				SPA_PROP_VOLUME_RAMP_LINEAR);
+		run_test("exponential ramp", sample_counts[i], build_ramp,
+				SPA_PROP_VOLUME_RAMP_EXPONENTIAL);
+	}
+	return 0;
+}
@@ -0,0 +1,291 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <spa/support/plugin.h>
+#include <spa/support/parallel.h>
+#include <spa/param/param.h>
+#include <spa/param/audio/format.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/buffer/buffer.h>
+
+#include "test-helper.h"
+
+#define MAX_SAMPLES	1024
+#define MAX_CHANNELS	SPA_AUDIO_MAX_CHANNELS
+#define MAX_COUNT	2000
+
+static const uint32_t channel_counts[] = { 8, 32, 64 };
+static const uint32_t sample_counts[] = { 256, 1024 };
+static const uint32_t thread_counts[] = { 0, 2, 4 };
+
+struct port_data {
+	struct spa_io_buffers io;
+	struct spa_buffer buffer;
+	struct spa_buffer *buffers[1];
+	struct spa_data datas[MAX_CHANNELS];
+	struct spa_chunk chunks[MAX_CHANNELS];
+};
+
+static struct port_data ports[2][MAX_CHANNELS];
+static uint8_t interleaved[MAX_SAMPLES * MAX_CHANNELS * sizeof(int16_t)] SPA_ALIGNED(64);
+static float planar[MAX_CHANNELS][MAX_SAMPLES] SPA_ALIGNED(64);
+
+static const struct spa_handle_factory *find_factory(const char *name)
+{
+	uint32_t index = 0;
+	const struct spa_handle_factory *factory;
+
+	while (spa_handle_factory_enum(&factory, &index) == 1) {
+		if (strcmp(factory->name, name) == 0)
+			return factory;
+	}
+	return NULL;
+}
+
+static struct spa_handle *make_node(const char *name, struct spa_support *support,
+		uint32_t n_support, struct spa_node **node)
+{
+	const struct spa_handle_factory *factory;
+	struct spa_handle *handle;
+	void *iface;
+	int res;
+
+	factory = find_factory(name);
+	spa_assert(factory != NULL);
+
+	handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+	spa_assert(handle != NULL);
+
+	res = spa_handle_factory_init(factory, handle, NULL, support, n_support);
+	spa_assert(res >= 0);
+
+	res = spa_handle_get_interface(handle, SPA_TYPE_INTERFACE_Node, &iface);
+	spa_assert(res >= 0);
+	*node = iface;
+
+	return handle;
+}
+
+static void init_info(struct spa_audio_info_raw *info, uint32_t format, uint32_t n_channels)
+{
+	uint32_t i;
+
+	spa_zero(*info);
+	info->format = format;
+	info->rate = 48000;
+	info->channels = n_channels;
+	for (i = 0; i < n_channels; i++)
+		info->position[i] = SPA_AUDIO_CHANNEL_CUSTOM_START + i;
+}
+
+static void setup_port_config(struct spa_node *node, enum spa_direction direction,
+		uint32_t n_channels)
+{
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[4096];
+	struct spa_pod *param;
+	struct spa_audio_info_raw info;
+	int res;
+
+	init_info(&info, SPA_AUDIO_FORMAT_F32P, n_channels);
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_format_audio_raw_build(&b, SPA_PARAM_Format, &info);
+	param = spa_pod_builder_add_object(&b,
+		SPA_TYPE_OBJECT_ParamPortConfig, SPA_PARAM_PortConfig,
+		SPA_PARAM_PORT_CONFIG_direction,	SPA_POD_Id(direction),
+		SPA_PARAM_PORT_CONFIG_mode,		SPA_POD_Id(SPA_PARAM_PORT_CONFIG_MODE_dsp),
+		SPA_PARAM_PORT_CONFIG_format,		SPA_POD_Pod(param));
+
+	res = spa_node_set_param(node, SPA_PARAM_PortConfig, 0, param);
+	spa_assert(res == 0);
+}
+
+static void setup_port(struct spa_node *node, enum spa_direction direction, uint32_t port_id,
+		struct port_data *pd, const struct spa_pod *format,
+		void *data, uint32_t size, uint32_t status)
+{
+	int res;
+
+	res = spa_node_port_set_param(node, direction, port_id, SPA_PARAM_Format, 0, format);
+	spa_assert(res == 0);
+
+	pd->chunks[0] = (struct spa_chunk) { .offset = 0, .size = size, };
+	pd->datas[0] = (struct spa_data) {
+		.type = SPA_DATA_MemPtr,
+		.maxsize = size,
+		.data = data,
+		.chunk = &pd->chunks[0],
+	};
+	pd->buffer = (struct spa_buffer) { .n_datas = 1, .datas = pd->datas, };
+	pd->buffers[0] = &pd->buffer;
+
+	res = spa_node_port_use_buffers(node, direction, port_id, 0, pd->buffers, 1);
+	spa_assert(res == 0);
+
+	pd->io = SPA_IO_BUFFERS_INIT;
+	pd->io.status = status;
+	pd->io.buffer_id = 0;
+	res = spa_node_port_set_io(node, direction, port_id, SPA_IO_Buffers,
+			&pd->io, sizeof(pd->io));
+	spa_assert(res == 0);
+}
+
+static uint64_t run_node(struct spa_node *node, uint32_t n_channels,
+		enum spa_direction dsp_direction)
+{
+	struct timespec ts;
+	uint64_t t1, t2;
+	uint32_t i, j;
+	enum spa_direction other = SPA_DIRECTION_REVERSE(dsp_direction);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		ports[other][0].io.status = other == SPA_DIRECTION_INPUT ?
+			SPA_STATUS_HAVE_DATA : SPA_STATUS_NEED_DATA;
+		for (j = 0; j < n_channels; j++)
+			ports[dsp_direction][j].io.status = dsp_direction == SPA_DIRECTION_INPUT ?
+				SPA_STATUS_HAVE_DATA : SPA_STATUS_NEED_DATA;
+
+		spa_node_process(node);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	return (t2 - t1) / MAX_COUNT;
+}
+
+static void run_test(const char *name, struct spa_support *support, uint32_t n_support,
+		uint32_t n_channels, uint32_t n_samples, const char *label)
+{
+	struct spa_handle *handle;
+	struct spa_node *node;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[4096];
+	struct spa_pod *format, *dsp_format;
+	struct spa_audio_info_raw info;
+	struct spa_audio_info_dsp dsp_info = { .format = SPA_AUDIO_FORMAT_DSP_F32 };
+	enum spa_direction dsp_direction, other;
+	uint32_t i;
+	uint64_t nsec;
+
+	handle = make_node(name, support, n_support, &node);
+
+	if (strcmp(name, SPA_NAME_AUDIO_PROCESS_DEINTERLEAVE) == 0)
+		dsp_direction = SPA_DIRECTION_OUTPUT;
+	else
+		dsp_direction = SPA_DIRECTION_INPUT;
+	other = SPA_DIRECTION_REVERSE(dsp_direction);
+
+	setup_port_config(node, dsp_direction, n_channels);
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	init_info(&info, SPA_AUDIO_FORMAT_S16, n_channels);
+	format = spa_format_audio_raw_build(&b, SPA_PARAM_Format, &info);
+	dsp_format = spa_format_audio_dsp_build(&b, SPA_PARAM_Format, &dsp_info);
+
+	setup_port(node, other, 0, &ports[other][0], format,
+			interleaved, n_samples * n_channels * sizeof(int16_t),
+			other == SPA_DIRECTION_INPUT ? SPA_STATUS_HAVE_DATA : SPA_STATUS_NEED_DATA);
+	for (i = 0; i < n_channels; i++)
+		setup_port(node, dsp_direction, i, &ports[dsp_direction][i], dsp_format,
+			planar[i], n_samples * sizeof(float),
+			dsp_direction == SPA_DIRECTION_INPUT ? SPA_STATUS_HAVE_DATA : SPA_STATUS_NEED_DATA);
+
+	nsec = run_node(node, n_channels, dsp_direction);
+
+	fprintf(stderr, "%-28s %-10s channels %2d, samples %4d: %8"PRIu64" nsec/cycle\n",
+			name, label, n_channels, n_samples, nsec);
+
+	spa_handle_clear(handle);
+	free(handle);
+}
+
+int main(int argc, char *argv[])
+{
+	struct spa_support support[1];
+	struct spa_handle *handle;
+	void *iface;
+	char threads[16], label[32];
+	uint32_t i, j, k;
+	int res;
+
+	for (k = 0; k < SPA_N_ELEMENTS(thread_counts); k++) {
+		uint32_t n_support = 0;
+
+		handle = NULL;
+		if (thread_counts[k] > 0) {
+			struct spa_dict_item items[2];
+
+			snprintf(threads, sizeof(threads), "%u", thread_counts[k]);
+			items[0] = SPA_DICT_ITEM_INIT(SPA_KEY_PARALLEL_THREADS, threads);
+			/* the benchmark does not run realtime, neither do the workers */
+			items[1] = SPA_DICT_ITEM_INIT(SPA_KEY_PARALLEL_RT_PRIO, "0");
+
+			handle = load_handle(NULL, 0, "support/libspa-support.so",
+					SPA_NAME_SUPPORT_PARALLEL, &SPA_DICT_INIT(items, 2));
+			if (handle == NULL)
+				continue;
+			if ((res = spa_handle_get_interface(handle,
+					SPA_TYPE_INTERFACE_Parallel, &iface)) < 0) {
+				fprintf(stderr, "can't get Parallel interface %s\n", spa_strerror(res));
+				return -1;
+			}
+			support[n_support++] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_Parallel, iface);
+			snprintf(label, sizeof(label), "threads:%d",
+					spa_parallel_get_n_threads((struct spa_parallel*)iface));
+		} else {
+			snprintf(label, sizeof(label), "serial");
+		}
+
+		for (i = 0; i < SPA_N_ELEMENTS(channel_counts); i++) {
+			for (j = 0; j < SPA_N_ELEMENTS(sample_counts); j++) {
+				run_test(SPA_NAME_AUDIO_PROCESS_DEINTERLEAVE, support, n_support,
+						channel_counts[i], sample_counts[j], label);
+				run_test(SPA_NAME_AUDIO_PROCESS_INTERLEAVE, support, n_support,
+						channel_counts[i], sample_counts[j], label);
+			}
+		}
+		if (handle) {
+			spa_handle_clear(handle);
+			free(handle);
+		}
+	}
+	return 0;
+}
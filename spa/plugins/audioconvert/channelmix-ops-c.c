@@ -81,6 +81,51 @@ channelmix_f32_n_m_c(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT
 	}
 }
 
+void
+channelmix_f32_n_m_gain_c(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples,
+		uint32_t n_gains, float *gains, const float *deltas)
+{
+	uint32_t i, j, n;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	bool src_gain = n_gains == n_src;
+
+	for (i = 0; i < n_dst; i++) {
+		float *di = d[i];
+		bool empty = true;
+
+		for (j = 0; j < n_src; j++) {
+			const float *sj = s[j];
+			float g = mix->matrix_orig[i][j], dg = 0.0f;
+
+			if (g == 0.0f)
+				continue;
+			if (src_gain) {
+				dg = g * deltas[j];
+				g *= gains[j];
+			}
+			if (empty) {
+				for (n = 0; n < n_samples; n++)
+					di[n] = sj[n] * (g + dg * n);
+			} else {
+				for (n = 0; n < n_samples; n++)
+					di[n] += sj[n] * (g + dg * n);
+			}
+			empty = false;
+		}
+		if (empty) {
+			memset(di, 0, n_samples * sizeof(float));
+		} else if (!src_gain) {
+			float g = gains[i], dg = deltas[i];
+			for (n = 0; n < n_samples; n++)
+				di[n] *= g + dg * n;
+		}
+	}
+	for (i = 0; i < n_gains; i++)
+		gains[i] += deltas[i] * n_samples;
+}
+
 #define MASK_MONO	_M(FC)|_M(MONO)|_M(UNKNOWN)
 #define MASK_STEREO	_M(FL)|_M(FR)|_M(UNKNOWN)
 
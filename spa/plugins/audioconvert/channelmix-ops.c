@@ -398,13 +398,9 @@ static void impl_channelmix_set_volume(struct channelmix *mix, float volume, boo
 	uint32_t src_chan = mix->src_chan;
 	uint32_t dst_chan = mix->dst_chan;
 
-	spa_log_debug(mix->log, "volume:%f mute:%d n_volumes:%d", volume, mute, n_channel_volumes);
-
 	/** apply global volume to channels */
-	for (i = 0; i < n_channel_volumes; i++) {
+	for (i = 0; i < n_channel_volumes; i++)
 		volumes[i] = channel_volumes[i] * vol;
-		spa_log_debug(mix->log, "%d: %f * %f = %f", i, channel_volumes[i], vol, volumes[i]);
-	}
 
 	/** apply volumes per channel */
 	if (n_channel_volumes == src_chan) {
@@ -429,7 +425,6 @@ static void impl_channelmix_set_volume(struct channelmix *mix, float volume, boo
 	for (i = 0; i < dst_chan; i++) {
 		for (j = 0; j < src_chan; j++) {
 			float v = mix->matrix[i][j];
-			spa_log_debug(mix->log, "%d %d: %f", i, j, v);
 			if (i == 0 && j == 0)
 				t = v;
 			else if (t != v)
@@ -444,7 +439,8 @@ static void impl_channelmix_set_volume(struct channelmix *mix, float volume, boo
 	SPA_FLAG_UPDATE(mix->flags, CHANNELMIX_FLAG_IDENTITY,
 			dst_chan == src_chan && SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_COPY));
 
-	spa_log_debug(mix->log, "flags:%08x", mix->flags);
+	spa_log_trace_fp(mix->log, "volume:%f mute:%d n_volumes:%d flags:%08x",
+			volume, mute, n_channel_volumes, mix->flags);
 }
 
 static void impl_channelmix_free(struct channelmix *mix)
@@ -463,6 +459,7 @@ int channelmix_init(struct channelmix *mix)
 
 	mix->free = impl_channelmix_free;
 	mix->process = info->process;
+	mix->process_gain = channelmix_f32_n_m_gain_c;
 	mix->set_volume = impl_channelmix_set_volume;
 	mix->cpu_flags = info->cpu_flags;
 	return make_matrix(mix);
@@ -62,6 +62,12 @@ struct channelmix {
 
 	void (*process) (struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
 			uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples);
+	/** mix with matrix_orig and a per channel gain that moves by \a deltas
+	 * every sample. There is a gain per src channel when \a n_gains is
+	 * src_chan, else one per dst channel. \a gains is updated. */
+	void (*process_gain) (struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+			uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples,
+			uint32_t n_gains, float *gains, const float *deltas);
 	void (*set_volume) (struct channelmix *mix, float volume, bool mute,
 			uint32_t n_channel_volumes, float *channel_volumes);
 	void (*free) (struct channelmix *mix);
@@ -72,6 +78,7 @@ struct channelmix {
 int channelmix_init(struct channelmix *mix);
 
 #define channelmix_process(mix,...)	(mix)->process(mix, __VA_ARGS__)
+#define channelmix_process_gain(mix,...)	(mix)->process_gain(mix, __VA_ARGS__)
 #define channelmix_set_volume(mix,...)	(mix)->set_volume(mix, __VA_ARGS__)
 #define channelmix_free(mix)		(mix)->free(mix)
 
@@ -97,6 +104,11 @@ DEFINE_FUNCTION(f32_7p1_2, c);
 DEFINE_FUNCTION(f32_7p1_3p1, c);
 DEFINE_FUNCTION(f32_7p1_4, c);
 
+void channelmix_f32_n_m_gain_c(struct channelmix *mix,
+		uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src],
+		uint32_t n_samples, uint32_t n_gains, float *gains, const float *deltas);
+
 #if defined (HAVE_SSE)
 DEFINE_FUNCTION(copy, sse);
 DEFINE_FUNCTION(f32_2_4, sse);
@@ -25,6 +25,7 @@
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
 
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
@@ -58,6 +59,9 @@ struct impl;
 #define DEFAULT_MUTE	false
 #define DEFAULT_VOLUME	1.0f
 
+#define DEFAULT_RAMP_STEP	64
+#define MIN_RAMP_VOLUME		0.00001f	/* -100 dB, start and end of exponential ramps */
+
 struct props {
 	float volume;
 	bool mute;
@@ -113,6 +117,25 @@ struct port {
 
 	struct spa_pod_sequence *ctrl;
 	uint32_t ctrl_offset;
+	uint32_t ctrl_applied;
+};
+
+/* a volume ramp. The mix matrix has the end volumes while it runs, the
+ * process kernel applies the ramp to matrix_orig with a gain per sample.
+ * Every step samples the gain is set to the exact point on the curve and
+ * it moves linearly to the next one. */
+struct ramp {
+	uint32_t scale;
+	uint32_t samples;
+	uint32_t step;
+	uint32_t pos;
+	uint32_t n_volumes;
+	float start[SPA_AUDIO_MAX_CHANNELS];
+	float end[SPA_AUDIO_MAX_CHANNELS];
+	float gains[SPA_AUDIO_MAX_CHANNELS];	/* gain of the next sample */
+	float target[SPA_AUDIO_MAX_CHANNELS];	/* gain at the next step */
+	float deltas[SPA_AUDIO_MAX_CHANNELS];	/* gain change per sample */
+	bool sync;				/* gains are not at pos */
 };
 
 struct impl {
@@ -135,6 +158,9 @@ struct impl {
 	struct port out_port;
 
 	struct channelmix mix;
+	struct ramp ramp;
+	uint32_t n_volumes;
+	float volumes[SPA_AUDIO_MAX_CHANNELS];	/* volumes in the mix matrix */
 	unsigned int started:1;
 	unsigned int is_passthrough:1;
 	uint32_t cpu_flags;
@@ -149,6 +175,150 @@ struct impl {
 #define GET_OUT_PORT(this,id)		(&this->out_port)
 #define GET_PORT(this,d,id)		(IS_CONTROL_PORT(this,d,id) ? GET_CONTROL_PORT(this,id) : (d == SPA_DIRECTION_INPUT ? GET_IN_PORT(this,id) : GET_OUT_PORT(this,id)))
 
+static void mix_set_volumes(struct impl *this, uint32_t n_volumes, const float *volumes)
+{
+	uint32_t i;
+
+	this->n_volumes = n_volumes;
+	for (i = 0; i < n_volumes; i++)
+		this->volumes[i] = volumes[i];
+
+	channelmix_set_volume(&this->mix, 1.0f, this->props.mute,
+			n_volumes, this->volumes);
+}
+
+/* the gains at point t of the ramp */
+static void ramp_get_gains(struct ramp *r, float t, float *gains)
+{
+	uint32_t i;
+
+	for (i = 0; i < r->n_volumes; i++) {
+		float s = r->start[i], e = r->end[i];
+
+		if (t >= 1.0f)
+			gains[i] = e;
+		else if (r->scale == SPA_PROP_VOLUME_RAMP_EXPONENTIAL) {
+			s = SPA_MAX(s, MIN_RAMP_VOLUME);
+			e = SPA_MAX(e, MIN_RAMP_VOLUME);
+			gains[i] = s * powf(e / s, t);
+		} else
+			gains[i] = s + (e - s) * t;
+	}
+}
+
+/* apply the volume and channel volumes from the props to the mix matrix,
+ * ramping to them when ramp_samples > 0 */
+static void update_volumes(struct impl *this, uint32_t ramp_samples,
+		uint32_t ramp_step, uint32_t ramp_scale)
+{
+	struct props *p = &this->props;
+	struct ramp *r = &this->ramp;
+	float volumes[SPA_AUDIO_MAX_CHANNELS];
+	uint32_t i;
+
+	if (p->n_channel_volumes == 0) {
+		r->samples = 0;
+		this->n_volumes = 0;
+		channelmix_set_volume(&this->mix, p->volume, p->mute,
+				p->n_channel_volumes, p->channel_volumes);
+		return;
+	}
+	for (i = 0; i < p->n_channel_volumes; i++)
+		volumes[i] = p->volume * p->channel_volumes[i];
+
+	if (ramp_samples == 0 || ramp_scale == SPA_PROP_VOLUME_RAMP_NONE ||
+	    this->n_volumes != p->n_channel_volumes) {
+		r->samples = 0;
+		mix_set_volumes(this, p->n_channel_volumes, volumes);
+		return;
+	}
+
+	/* start from the current gain, this also makes a new ramp continue
+	 * from the current point of a running ramp */
+	if (r->pos < r->samples) {
+		if (r->sync)
+			ramp_get_gains(r, (float)r->pos / r->samples, r->gains);
+		for (i = 0; i < r->n_volumes; i++)
+			this->volumes[i] = r->gains[i];
+	}
+	r->scale = ramp_scale;
+	r->samples = ramp_samples;
+	r->step = ramp_step > 0 ? ramp_step : DEFAULT_RAMP_STEP;
+	r->pos = 0;
+	r->sync = false;
+	r->n_volumes = p->n_channel_volumes;
+	for (i = 0; i < r->n_volumes; i++) {
+		r->start[i] = r->gains[i] = r->target[i] = this->volumes[i];
+		r->end[i] = volumes[i];
+	}
+	spa_log_trace_fp(this->log, NAME " %p: ramp %u samples step:%u scale:%u", this,
+			r->samples, r->step, r->scale);
+
+	/* the matrix is only made here, for the end of the ramp and with the
+	 * mute applied right away */
+	mix_set_volumes(this, r->n_volumes, volumes);
+}
+
+/* run the mix and render the active ramp, if any */
+static void mix_process(struct impl *this,
+		uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src],
+		uint32_t n_samples)
+{
+	struct ramp *r = &this->ramp;
+	const float *s[n_src];
+	float *d[n_dst];
+	uint32_t i, chunk;
+
+	if (SPA_LIKELY(r->pos >= r->samples)) {
+		channelmix_process(&this->mix, n_dst, dst, n_src, src, n_samples);
+		return;
+	}
+	if (this->props.mute ||
+	    (r->n_volumes != this->mix.src_chan && r->n_volumes != this->mix.dst_chan)) {
+		/* nothing to ramp, the matrix has the end state */
+		r->pos = SPA_MIN(r->samples, r->pos + n_samples);
+		r->sync = true;
+		channelmix_process(&this->mix, n_dst, dst, n_src, src, n_samples);
+		return;
+	}
+
+	for (i = 0; i < n_src; i++)
+		s[i] = src[i];
+	for (i = 0; i < n_dst; i++)
+		d[i] = dst[i];
+
+	while (n_samples > 0 && r->pos < r->samples) {
+		uint32_t offs = r->pos % r->step;
+		uint32_t len = SPA_MIN(r->step, r->samples - r->pos + offs);
+
+		if (offs == 0 || r->sync) {
+			/* start from the exact point, so that errors don't add up */
+			if (r->sync)
+				ramp_get_gains(r, (float)r->pos / r->samples, r->gains);
+			else
+				memcpy(r->gains, r->target, r->n_volumes * sizeof(float));
+			ramp_get_gains(r, (float)(r->pos - offs + len) / r->samples, r->target);
+			for (i = 0; i < r->n_volumes; i++)
+				r->deltas[i] = (r->target[i] - r->gains[i]) / (len - offs);
+			r->sync = false;
+		}
+		chunk = SPA_MIN(len - offs, n_samples);
+
+		channelmix_process_gain(&this->mix, n_dst, (void**)d, n_src, (const void**)s,
+				chunk, r->n_volumes, r->gains, r->deltas);
+		for (i = 0; i < n_src; i++)
+			s[i] += chunk;
+		for (i = 0; i < n_dst; i++)
+			d[i] += chunk;
+
+		r->pos += chunk;
+		n_samples -= chunk;
+	}
+	if (n_samples > 0)
+		channelmix_process(&this->mix, n_dst, (void**)d, n_src, (const void**)s, n_samples);
+}
+
 #define _MASK(ch)	(1ULL << SPA_AUDIO_CHANNEL_ ## ch)
 #define STEREO	(_MASK(FL)|_MASK(FR))
 
@@ -289,8 +459,8 @@ static int setup_convert(struct impl *this,
 
 	remap_volumes(&this->props, src_info);
 
-	channelmix_set_volume(&this->mix, this->props.volume, this->props.mute,
-			this->props.n_channel_volumes, this->props.channel_volumes);
+	this->n_volumes = 0;
+	update_volumes(this, 0, 0, SPA_PROP_VOLUME_RAMP_NONE);
 
 	emit_params_changed(this);
 
@@ -411,6 +581,8 @@ static int apply_props(struct impl *this, const struct spa_pod *param)
 	struct spa_pod_object *obj = (struct spa_pod_object *) param;
 	struct props *p = &this->props;
 	int changed = 0;
+	int32_t ramp_samples = 0, ramp_step = DEFAULT_RAMP_STEP;
+	uint32_t ramp_scale = SPA_PROP_VOLUME_RAMP_LINEAR;
 
 	SPA_POD_OBJECT_FOREACH(obj, prop) {
 		switch (prop->key) {
@@ -418,6 +590,15 @@ static int apply_props(struct impl *this, const struct spa_pod *param)
 			if (spa_pod_get_float(&prop->value, &p->volume) == 0)
 				changed++;
 			break;
+		case SPA_PROP_volumeRampSamples:
+			spa_pod_get_int(&prop->value, &ramp_samples);
+			break;
+		case SPA_PROP_volumeRampStepSamples:
+			spa_pod_get_int(&prop->value, &ramp_step);
+			break;
+		case SPA_PROP_volumeRampScale:
+			spa_pod_get_id(&prop->value, &ramp_scale);
+			break;
 		case SPA_PROP_mute:
 			if (spa_pod_get_bool(&prop->value, &p->mute) == 0)
 				changed++;
@@ -438,8 +619,9 @@ static int apply_props(struct impl *this, const struct spa_pod *param)
 	}
 	if (changed && this->mix.set_volume) {
 		remap_volumes(&this->props, &GET_IN_PORT(this, 0)->format);
-		channelmix_set_volume(&this->mix, p->volume, p->mute,
-				p->n_channel_volumes, p->channel_volumes);
+		/* negative ramps are invalid, apply the volume right away */
+		update_volumes(this, SPA_MAX(ramp_samples, 0),
+				SPA_MAX(ramp_step, 0), ramp_scale);
 	}
 	return changed;
 }
@@ -458,8 +640,7 @@ static int apply_midi(struct impl *this, const struct spa_pod *value)
 
 	p->volume = val[2] / 127.0;
 	if (this->mix.set_volume)
-		channelmix_set_volume(&this->mix, p->volume, p->mute,
-			p->n_channel_volumes, p->channel_volumes);
+		update_volumes(this, 0, 0, SPA_PROP_VOLUME_RAMP_NONE);
 	return 1;
 }
 
@@ -989,63 +1170,60 @@ static int channelmix_process_control(struct impl *this, struct port *ctrlport,
 				      uint32_t n_src, const void * SPA_RESTRICT src[n_src],
 				      uint32_t n_samples)
 {
-	struct spa_pod_control *c, *prev = NULL;
+	struct spa_pod_control *c;
 	uint32_t avail_samples = n_samples;
-	uint32_t i;
+	uint32_t i, index = 0;
 	const float **s = (const float **)src;
 	float **d = (float **)dst;
 
 	SPA_POD_SEQUENCE_FOREACH(ctrlport->ctrl, c) {
 		uint32_t chunk;
 
-		if (avail_samples == 0)
-			return 0;
-
-		/* ignore old control offsets */
-		if (c->offset <= ctrlport->ctrl_offset) {
-			prev = c;
+		/* skip the controls we applied in a previous cycle */
+		if (index++ < ctrlport->ctrl_applied)
 			continue;
+
+		/* render up to the offset of the control */
+		if (c->offset > ctrlport->ctrl_offset) {
+			if (avail_samples == 0)
+				return 0;
+
+			chunk = SPA_MIN(avail_samples, c->offset - ctrlport->ctrl_offset);
+
+			spa_log_trace_fp(this->log, NAME " %p: process %d %d", this,
+					c->offset, chunk);
+
+			mix_process(this, n_dst, dst, n_src, src, chunk);
+			for (i = 0; i < n_src; i++)
+				s[i] += chunk;
+			for (i = 0; i < n_dst; i++)
+				d[i] += chunk;
+
+			avail_samples -= chunk;
+			ctrlport->ctrl_offset += chunk;
+
+			if (c->offset > ctrlport->ctrl_offset)
+				return 0;
 		}
 
 		switch (c->type) {
 		case SPA_CONTROL_Midi:
-		{
-			if (prev)
-				apply_midi(this, &prev->value);
+			apply_midi(this, &c->value);
 			break;
-		}
 		case SPA_CONTROL_Properties:
-		{
-			if (prev)
-				apply_props(this, &prev->value);
+			apply_props(this, &c->value);
 			break;
-		}
 		default:
-			continue;
+			break;
 		}
-
-		chunk = SPA_MIN(avail_samples, c->offset - ctrlport->ctrl_offset);
-
-		spa_log_trace_fp(this->log, NAME " %p: process %d %d", this,
-				c->offset, chunk);
-
-		channelmix_process(&this->mix, n_dst, dst, n_src, src, chunk);
-		for (i = 0; i < n_src; i++)
-			s[i] += chunk;
-		for (i = 0; i < n_dst; i++)
-			d[i] += chunk;
-
-		avail_samples -= chunk;
-		ctrlport->ctrl_offset += chunk;
-
-		prev = c;
+		ctrlport->ctrl_applied++;
 	}
 
 	/* when we get here we run out of control points but still have some
 	 * remaining samples */
 	spa_log_trace_fp(this->log, NAME " %p: remain %d", this, avail_samples);
 	if (avail_samples > 0)
-		channelmix_process(&this->mix, n_dst, dst, n_src, src, avail_samples);
+		mix_process(this, n_dst, dst, n_src, src, avail_samples);
 
 	return 1;
 }
@@ -1105,6 +1283,7 @@ static int impl_node_process(void *object)
 		if (ctrl != ctrlport->ctrl) {
 			ctrlport->ctrl = ctrl;
 			ctrlport->ctrl_offset = 0;
+			ctrlport->ctrl_applied = 0;
 		}
 	}
 
@@ -1119,7 +1298,8 @@ static int impl_node_process(void *object)
 
 		is_passthrough = this->is_passthrough &&
 			SPA_FLAG_IS_SET(this->mix.flags, CHANNELMIX_FLAG_IDENTITY) &&
-			ctrlport->ctrl == NULL;
+			ctrlport->ctrl == NULL &&
+			this->ramp.pos >= this->ramp.samples;
 
 		n_samples = sb->datas[0].chunk->size / inport->stride;
 
@@ -1143,7 +1323,7 @@ static int impl_node_process(void *object)
 					ctrlport->ctrl = NULL;
 				}
 			} else {
-				channelmix_process(&this->mix, n_dst_datas, dst_datas,
+				mix_process(this, n_dst_datas, dst_datas,
 						n_src_datas, src_datas, n_samples);
 			}
 		}
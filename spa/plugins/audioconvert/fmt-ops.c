@@ -27,6 +27,7 @@
 #include <math.h>
 
 #include <spa/support/cpu.h>
+#include <spa/support/parallel.h>
 #include <spa/utils/defs.h>
 #include <spa/param/audio/format-utils.h>
 
@@ -233,3 +234,65 @@ int convert_init(struct convert *conv)
 
 	return 0;
 }
+
+/* a conversion split in blocks of samples that can be processed
+ * independently */
+struct convert_block {
+	struct convert *conv;
+	void **dst;
+	const void **src;
+	uint32_t n_dst;
+	uint32_t n_src;
+	uint32_t dst_stride;
+	uint32_t src_stride;
+	uint32_t n_samples;
+	uint32_t block_size;
+};
+
+#define CONVERT_BLOCK_ALIGN	16
+
+static void convert_block_process(void *data, uint32_t index)
+{
+	struct convert_block *b = data;
+	uint32_t i, offset = index * b->block_size;
+	uint32_t n_samples = SPA_MIN(b->block_size, b->n_samples - offset);
+	void *dst[b->n_dst];
+	const void *src[b->n_src];
+
+	for (i = 0; i < b->n_dst; i++)
+		dst[i] = SPA_MEMBER(b->dst[i], offset * b->dst_stride, void);
+	for (i = 0; i < b->n_src; i++)
+		src[i] = SPA_MEMBER(b->src[i], offset * b->src_stride, void);
+
+	convert_process(b->conv, dst, src, n_samples);
+}
+
+void convert_process_parallel(struct convert *conv, struct spa_parallel *parallel,
+		void *dst[], uint32_t n_dst, uint32_t dst_stride,
+		const void *src[], uint32_t n_src, uint32_t src_stride,
+		uint32_t n_samples)
+{
+	struct convert_block block;
+	uint32_t n_blocks;
+
+	if (parallel == NULL ||
+	    n_samples * conv->n_channels < CONVERT_PARALLEL_MIN_SAMPLES) {
+		convert_process(conv, dst, src, n_samples);
+		return;
+	}
+
+	block.conv = conv;
+	block.dst = dst;
+	block.n_dst = n_dst;
+	block.dst_stride = dst_stride;
+	block.src = src;
+	block.n_src = n_src;
+	block.src_stride = src_stride;
+	block.n_samples = n_samples;
+	n_blocks = spa_parallel_get_n_threads(parallel);
+	block.block_size = SPA_ROUND_UP_N((n_samples + n_blocks - 1) / n_blocks,
+			CONVERT_BLOCK_ALIGN);
+	n_blocks = (n_samples + block.block_size - 1) / block.block_size;
+
+	spa_parallel_run(parallel, n_blocks, convert_block_process, &block);
+}
@@ -124,6 +124,19 @@ int convert_init(struct convert *conv);
 #define convert_process(conv,...)	(conv)->process(conv, __VA_ARGS__)
 #define convert_free(conv)		(conv)->free(conv)
 
+/* minimum number of samples, over all channels, before the conversion
+ * is split over the parallel threads */
+#define CONVERT_PARALLEL_MIN_SAMPLES	8192
+
+struct spa_parallel;
+
+/* like convert_process() but split in blocks of samples over the threads
+ * of \a parallel when there is enough work, \a parallel can be NULL */
+void convert_process_parallel(struct convert *conv, struct spa_parallel *parallel,
+		void *dst[], uint32_t n_dst, uint32_t dst_stride,
+		const void *src[], uint32_t n_src, uint32_t src_stride,
+		uint32_t n_samples);
+
 #define DEFINE_FUNCTION(name,arch) \
 void conv_##name##_##arch(struct convert *conv, void * SPA_RESTRICT dst[],	\
 		const void * SPA_RESTRICT src[], uint32_t n_samples)		\
@@ -30,6 +30,7 @@
 #include <spa/support/plugin.h>
 #include <spa/support/cpu.h>
 #include <spa/support/log.h>
+#include <spa/support/parallel.h>
 #include <spa/utils/result.h>
 #include <spa/utils/list.h>
 #include <spa/utils/names.h>
@@ -127,6 +128,7 @@ struct impl {
 
 	struct spa_log *log;
 	struct spa_cpu *cpu;
+	struct spa_parallel *parallel;
 
 	struct spa_io_position *io_position;
 
@@ -1267,7 +1269,9 @@ static int impl_node_process(void *object)
 			n_src_datas, n_dst_datas, n_samples, maxsize, this->is_passthrough);
 
 	if (!this->is_passthrough)
-		convert_process(&this->conv, dst_datas, src_datas, n_samples);
+		convert_process_parallel(&this->conv, this->parallel,
+				dst_datas, n_dst_datas, outport->stride,
+				src_datas, n_src_datas, sizeof(float), n_samples);
 
 	return SPA_STATUS_NEED_DATA | SPA_STATUS_HAVE_DATA;
 }
@@ -1340,6 +1344,7 @@ impl_init(const struct spa_handle_factory *factory,
 
 	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
 	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+	this->parallel = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Parallel);
 
 	if (this->cpu)
 		this->cpu_flags = spa_cpu_get_flags(this->cpu);
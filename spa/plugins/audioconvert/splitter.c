@@ -30,6 +30,7 @@
 #include <spa/support/plugin.h>
 #include <spa/support/cpu.h>
 #include <spa/support/log.h>
+#include <spa/support/parallel.h>
 #include <spa/utils/list.h>
 #include <spa/utils/names.h>
 #include <spa/node/node.h>
@@ -95,6 +96,7 @@ struct impl {
 
 	struct spa_log *log;
 	struct spa_cpu *cpu;
+	struct spa_parallel *parallel;
 
 	struct spa_io_position *io_position;
 
@@ -978,7 +980,9 @@ static int impl_node_process(void *object)
 			this->is_passthrough);
 
 	if (!this->is_passthrough)
-		convert_process(&this->conv, dst_datas, src_datas, n_samples);
+		convert_process_parallel(&this->conv, this->parallel,
+				dst_datas, n_dst_datas, sizeof(float),
+				src_datas, n_src_datas, inport->stride, n_samples);
 
 	inio->status = SPA_STATUS_NEED_DATA;
 	res |= SPA_STATUS_NEED_DATA;
@@ -1053,6 +1057,7 @@ impl_init(const struct spa_handle_factory *factory,
 
 	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
 	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+	this->parallel = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Parallel);
 
 	if (this->cpu)
 		this->cpu_flags = spa_cpu_get_flags(this->cpu);
@@ -199,6 +199,51 @@ static void test_7p1_N(void)
 			       0.0, 1.0, 0.707107, 0.0, 0.0, 0.707107, 0.0, 0.707107));
 }
 
+static void test_gain(void)
+{
+	struct channelmix mix;
+	float src[2][8], dst[2][8], gains[2], deltas[2];
+	const void *s[2] = { src[0], src[1] };
+	void *d[2] = { dst[0], dst[1] };
+	uint32_t i;
+
+	spa_zero(mix);
+	mix.src_chan = 2;
+	mix.dst_chan = 2;
+	mix.src_mask = _M(FL)|_M(FR);
+	mix.dst_mask = _M(FL)|_M(FR);
+	mix.log = &logger.log;
+	channelmix_init(&mix);
+
+	for (i = 0; i < 8; i++) {
+		src[0][i] = 1.0f;
+		src[1][i] = -0.5f;
+	}
+	/* one gain per channel, moving every sample */
+	gains[0] = 0.0f;
+	gains[1] = 1.0f;
+	deltas[0] = 0.125f;
+	deltas[1] = -0.125f;
+	channelmix_process_gain(&mix, 2, d, 2, s, 8, 2, gains, deltas);
+	for (i = 0; i < 8; i++) {
+		spa_assert(fabs(dst[0][i] - 0.125f * i) < 0.000001);
+		spa_assert(fabs(dst[1][i] - -0.5f * (1.0f - 0.125f * i)) < 0.000001);
+	}
+	spa_assert(fabs(gains[0] - 1.0f) < 0.000001);
+	spa_assert(fabs(gains[1] - 0.0f) < 0.000001);
+
+	/* to mono, the gain is on the dst channel */
+	mix.dst_chan = 1;
+	mix.dst_mask = _M(MONO);
+	channelmix_init(&mix);
+
+	gains[0] = 1.0f;
+	deltas[0] = -0.125f;
+	channelmix_process_gain(&mix, 1, d, 2, s, 8, 1, gains, deltas);
+	for (i = 0; i < 8; i++)
+		spa_assert(fabs(dst[0][i] - 0.5f * 0.707107f * (1.0f - 0.125f * i)) < 0.000001);
+}
+
 int main(int argc, char *argv[])
 {
 	logger.log.level = SPA_LOG_LEVEL_TRACE;
@@ -209,6 +254,7 @@ int main(int argc, char *argv[])
 	test_4_N();
 	test_5p1_N();
 	test_7p1_N();
+	test_gain();
 
 	return 0;
 }
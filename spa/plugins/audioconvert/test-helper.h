@@ -27,7 +27,8 @@ static inline const struct spa_handle_factory *get_factory(spa_handle_factory_en
 }
 
 static inline struct spa_handle *load_handle(const struct spa_support *support,
-		uint32_t n_support, const char *lib, const char *name)
+		uint32_t n_support, const char *lib, const char *name,
+		const struct spa_dict *info)
 {
 	int res, len;
 	void *hnd;
@@ -60,9 +61,9 @@ static inline struct spa_handle *load_handle(const struct spa_support *support,
 		res = -ENOENT;
 		goto error_close;
 	}
-	handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+	handle = calloc(1, spa_handle_factory_get_size(factory, info));
 	if ((res = spa_handle_factory_init(factory, handle,
-					NULL, support, n_support)) < 0) {
+					info, support, n_support)) < 0) {
 		fprintf(stderr, "can't make factory instance: %d\n", res);
 		goto error_close;
 	}
@@ -82,7 +83,7 @@ static inline uint32_t get_cpu_flags(void)
 	void *iface;
 	int res;
 
-	handle = load_handle(NULL, 0, "support/libspa-support.so", SPA_NAME_SUPPORT_CPU);
+	handle = load_handle(NULL, 0, "support/libspa-support.so", SPA_NAME_SUPPORT_CPU, NULL);
 	if (handle == NULL)
 		return 0;
 	if ((res = spa_handle_get_interface(handle, SPA_TYPE_INTERFACE_CPU, &iface)) < 0) {
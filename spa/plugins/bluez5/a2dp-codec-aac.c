@@ -442,6 +442,7 @@ const struct a2dp_codec a2dp_codec_aac = {
 	.codec_id = A2DP_CODEC_MPEG24,
 	.name = "aac",
 	.description = "AAC",
+	.partial_blocks = true,
 	.fill_caps = codec_fill_caps,
 	.select_config = codec_select_config,
 	.enum_config = codec_enum_config,
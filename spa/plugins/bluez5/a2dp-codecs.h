@@ -27,6 +27,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 #include <spa/param/audio/format.h>
 #include <spa/pod/pod.h>
@@ -334,6 +335,17 @@ struct a2dp_codec {
 
 	const size_t send_buf_size;
 
+	/** encode() keeps incomplete blocks internally and accepts input of any
+	 * size in whole audio frames, so it can be fed straight from the ringbuffer
+	 * of a port buffer, one segment before and one after the wraparound.
+	 * Otherwise encode() only gets complete blocks of get_block_size() and a
+	 * block that is split is copied once, so this only pays off for codecs
+	 * with blocks larger than a quantum. AAC sets it, its block is 1024
+	 * frames. LDAC has a block of one frame and is never split. libsbc and
+	 * libopenaptx only encode whole blocks of 128 and 4 frames, for them
+	 * the copy is at most one block per buffer boundary. */
+	const bool partial_blocks;
+
 	const char *feature_flag;
 
 	int (*fill_caps) (const struct a2dp_codec *codec, uint32_t flags,
@@ -141,6 +141,7 @@ struct impl {
 	uint64_t sample_count;
 	uint8_t tmp_buffer[4096];
 	uint32_t tmp_buffer_used;
+	uint32_t block_used;
 	uint32_t fd_buffer_size;
 };
 
@@ -437,7 +438,10 @@ static int encode_buffer(struct impl *this, const void *data, uint32_t size)
 	if (this->buffer_used >= sizeof(this->buffer))
 		return -ENOSPC;
 
-	if (size < this->block_size - this->tmp_buffer_used) {
+	/* codecs with partial_blocks collect the blocks themselves, for the
+	 * others only a block that is split between buffers is staged */
+	if (!this->codec->partial_blocks &&
+	    size < this->block_size - this->tmp_buffer_used) {
 		memcpy(this->tmp_buffer + this->tmp_buffer_used, data, size);
 		this->tmp_buffer_used += size;
 		return size;
@@ -457,7 +461,9 @@ static int encode_buffer(struct impl *this, const void *data, uint32_t size)
 		return processed;
 
 	this->sample_count += processed / port->frame_size;
-	this->frame_count += processed / this->block_size;
+	this->block_used += processed;
+	this->frame_count += this->block_used / this->block_size;
+	this->block_used %= this->block_size;
 	this->buffer_used += out_encoded;
 
 	spa_log_trace(this->log, NAME " %p: processed %d %zd used %d",
@@ -719,7 +725,8 @@ static int do_start(struct impl *this)
 
 	this->block_size = this->codec->get_block_size(this->codec_data);
 	update_num_blocks(this);
-	if (this->block_size > sizeof(this->tmp_buffer)) {
+	if (!this->codec->partial_blocks &&
+	    this->block_size > sizeof(this->tmp_buffer)) {
 		spa_log_error(this->log, "block-size %d > %zu",
 				this->block_size, sizeof(this->tmp_buffer));
 		return -EIO;
@@ -752,6 +759,8 @@ static int do_start(struct impl *this)
 	if (setsockopt(this->transport->fd, SOL_SOCKET, SO_PRIORITY, &val, sizeof(val)) < 0)
 		spa_log_warn(this->log, "SO_PRIORITY failed: %m");
 
+	this->tmp_buffer_used = 0;
+	this->block_used = 0;
 	reset_buffer(this);
 
 	this->source.data = this;
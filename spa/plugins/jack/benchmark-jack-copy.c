@@ -0,0 +1,97 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+
+#include <spa/utils/defs.h>
+
+/* the jack source and sink copy every port between the JACK port memory and
+ * the buffer memory once per cycle. This measures that copy, without jackd. */
+
+#define MAX_COUNT	2000
+#define RATE		48000
+
+static const uint32_t port_counts[] = { 2, 8, 32, 128 };
+static const uint32_t buffer_sizes[] = { 64, 256, 1024, 2048 };
+
+static void run_test(uint32_t n_ports, uint32_t n_frames)
+{
+	float **jack, **buf;
+	struct timespec ts;
+	uint64_t t1, t2, elapsed, period;
+	uint32_t i, j;
+
+	jack = calloc(n_ports, sizeof(float *));
+	buf = calloc(n_ports, sizeof(float *));
+	spa_assert(jack != NULL && buf != NULL);
+
+	for (i = 0; i < n_ports; i++) {
+		jack[i] = calloc(n_frames, sizeof(float));
+		buf[i] = calloc(n_frames, sizeof(float));
+		spa_assert(jack[i] != NULL && buf[i] != NULL);
+		for (j = 0; j < n_frames; j++)
+			jack[i][j] = (float)j / n_frames;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (j = 0; j < MAX_COUNT; j++) {
+		for (i = 0; i < n_ports; i++)
+			spa_memcpy(buf[i], jack[i], n_frames * sizeof(float));
+		/* and back, like the sink */
+		for (i = 0; i < n_ports; i++)
+			spa_memcpy(jack[i], buf[i], n_frames * sizeof(float));
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+	elapsed = (t2 - t1) / (MAX_COUNT * 2);
+	period = (uint64_t)n_frames * SPA_NSEC_PER_SEC / RATE;
+
+	fprintf(stderr, "ports %3u frames %4u: %8"PRIu64" nsec/cycle, %5.2f%% of the period\n",
+			n_ports, n_frames, elapsed, elapsed * 100.0 / period);
+
+	for (i = 0; i < n_ports; i++) {
+		free(jack[i]);
+		free(buf[i]);
+	}
+	free(jack);
+	free(buf);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i, j;
+
+	for (i = 0; i < SPA_N_ELEMENTS(port_counts); i++)
+		for (j = 0; j < SPA_N_ELEMENTS(buffer_sizes); j++)
+			run_test(port_counts[i], buffer_sizes[j]);
+
+	return 0;
+}
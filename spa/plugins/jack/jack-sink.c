@@ -768,6 +768,9 @@ static int impl_node_process(void *object)
 		b = &port->buffers[io->buffer_id];
 		src = &b->outbuf->datas[0];
 
+		/* JACK owns the port memory and hands out a new pointer every
+		 * cycle, after the peers have already written their buffers, so
+		 * the samples need to be copied */
 		spa_memcpy(dst, src->data, n_frames * port->stride);
 
 		io->status = SPA_STATUS_NEED_DATA;
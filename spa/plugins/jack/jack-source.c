@@ -784,6 +784,10 @@ static int impl_node_process(void *object)
 
 		src = jack_port_get_buffer(port->jack_port, n_frames);
 
+		/* JACK owns the port memory and it is only valid until our
+		 * process callback returns. The graph runs after that, in other
+		 * threads and processes that only see the buffer memory, so the
+		 * samples need to be copied */
 		d = &b->outbuf->datas[0];
 		spa_memcpy(d->data, src, n_frames * port->stride);
 		d->chunk->offset = 0;
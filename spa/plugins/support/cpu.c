@@ -27,7 +27,13 @@
 #include <string.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <limits.h>
 #include <sched.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
 
 #ifdef __FreeBSD__
 #include <sys/sysctl.h>
@@ -39,9 +45,15 @@
 #include <spa/utils/type.h>
 #include <spa/utils/hook.h>
 #include <spa/utils/names.h>
+#include <spa/utils/result.h>
 
 #define NAME "cpu"
 
+#define SYSFS_PATH	"/sys/devices"
+/* read the topology from another sysfs tree, for tests */
+#define KEY_SYSFS_PATH	"cpu.sysfs-path"
+#define MAX_CPUS	4096
+
 struct impl {
 	struct spa_handle handle;
 	struct spa_cpu cpu;
@@ -52,6 +64,13 @@ struct impl {
 	uint32_t force;
 	uint32_t count;
 	uint32_t max_align;
+
+	char *sysfs_path;
+	pthread_mutex_t topology_lock;
+	struct spa_cpu_info *infos;
+	uint32_t n_infos;
+	bool have_topology;		/**< infos and n_infos are set, only
+					  *  read and written atomically */
 };
 
 # if defined (__i386__) || defined (__x86_64__)
@@ -116,12 +135,313 @@ impl_cpu_get_max_align(void *object)
 	return impl->max_align;
 }
 
+/* read a sysfs attribute below root, the trailing newline is removed */
+static int read_attr(const char *root, char *buf, size_t size, const char *fmt, ...)
+{
+	char path[PATH_MAX];
+	int fd, len;
+	ssize_t n;
+	va_list args;
+
+	len = snprintf(path, sizeof(path), "%s/", root);
+	va_start(args, fmt);
+	vsnprintf(path + len, sizeof(path) - len, fmt, args);
+	va_end(args);
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+		return -errno;
+	n = read(fd, buf, size - 1);
+	close(fd);
+	if (n < 0)
+		return -errno;
+	while (n > 0 && (buf[n-1] == '\n' || buf[n-1] == ' '))
+		n--;
+	buf[n] = '\0';
+	return n;
+}
+
+static uint32_t parse_size(const char *str)
+{
+	char *end;
+	unsigned long val = strtoul(str, &end, 10);
+
+	switch (*end) {
+	case 'K': val <<= 10; break;
+	case 'M': val <<= 20; break;
+	case 'G': val <<= 30; break;
+	}
+	return val;
+}
+
+/* parse a list like "0-3,8,10-11" into ids, returns the number of ids.
+ * When ids is NULL, the ids are only counted. */
+static uint32_t parse_cpulist(const char *str, uint32_t *ids, uint32_t max_ids)
+{
+	uint32_t n = 0;
+	unsigned long first, last;
+	char *end;
+
+	while (*str) {
+		first = last = strtoul(str, &end, 10);
+		if (end == str)
+			break;
+		if (*end == '-')
+			last = strtoul(end + 1, &end, 10);
+		for (; first <= last && n < max_ids; first++) {
+			if (ids)
+				ids[n] = first;
+			n++;
+		}
+		if (*end != ',')
+			break;
+		str = end + 1;
+	}
+	return n;
+}
+
+static bool cpulist_contains(const char *str, uint32_t id)
+{
+	unsigned long first, last;
+	char *end;
+
+	while (*str) {
+		first = last = strtoul(str, &end, 10);
+		if (end == str)
+			break;
+		if (*end == '-')
+			last = strtoul(end + 1, &end, 10);
+		if (id >= first && id <= last)
+			return true;
+		if (*end != ',')
+			break;
+		str = end + 1;
+	}
+	return false;
+}
+
+static uint32_t read_uint(const char *root, uint32_t def, const char *fmt, uint32_t id)
+{
+	char buf[64];
+	if (read_attr(root, buf, sizeof(buf), fmt, id) <= 0)
+		return def;
+	return strtoul(buf, NULL, 10);
+}
+
+static uint32_t read_numa_node(const char *root, uint32_t id)
+{
+	char path[PATH_MAX];
+	struct dirent *entry;
+	uint32_t node = 0;
+	DIR *dir;
+
+	snprintf(path, sizeof(path), "%s/system/cpu/cpu%u", root, id);
+	if ((dir = opendir(path)) == NULL)
+		return 0;
+	while ((entry = readdir(dir)) != NULL) {
+		if (strncmp(entry->d_name, "node", 4) == 0 &&
+		    entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+			node = strtoul(entry->d_name + 4, NULL, 10);
+			break;
+		}
+	}
+	closedir(dir);
+	return node;
+}
+
+static void read_caches(const char *root, struct spa_cpu_info *info)
+{
+	char buf[1024];
+	uint32_t i;
+	struct spa_cpu_cache *c;
+
+	for (i = 0; i < SPA_CPU_MAX_CACHES; i++) {
+		c = &info->caches[i];
+
+		if (read_attr(root, buf, sizeof(buf),
+				"system/cpu/cpu%u/cache/index%u/level", info->id, i) <= 0)
+			break;
+		c->level = atoi(buf);
+
+		if (read_attr(root, buf, sizeof(buf),
+				"system/cpu/cpu%u/cache/index%u/type", info->id, i) <= 0)
+			c->type = SPA_CPU_CACHE_UNIFIED;
+		else if (strcmp(buf, "Data") == 0)
+			c->type = SPA_CPU_CACHE_DATA;
+		else if (strcmp(buf, "Instruction") == 0)
+			c->type = SPA_CPU_CACHE_INSTRUCTION;
+		else
+			c->type = SPA_CPU_CACHE_UNIFIED;
+
+		if (read_attr(root, buf, sizeof(buf),
+				"system/cpu/cpu%u/cache/index%u/size", info->id, i) > 0)
+			c->size = parse_size(buf);
+		if (read_attr(root, buf, sizeof(buf),
+				"system/cpu/cpu%u/cache/index%u/coherency_line_size", info->id, i) > 0)
+			c->line_size = atoi(buf);
+		if (read_attr(root, buf, sizeof(buf),
+				"system/cpu/cpu%u/cache/index%u/shared_cpu_list", info->id, i) > 0)
+			c->n_shared = parse_cpulist(buf, NULL, MAX_CPUS);
+		else
+			c->n_shared = 1;
+
+		info->n_caches++;
+	}
+}
+
+/* Hybrid Intel CPUs list their cores in separate PMU devices. Otherwise
+ * fall back to the capacity that the scheduler uses for big.LITTLE. */
+static void assign_core_types(struct impl *this, const char *root)
+{
+	char core[1024], atom[1024];
+	uint32_t i, max_capacity = 0, min_capacity = UINT32_MAX;
+	struct spa_cpu_info *info;
+
+	if (read_attr(root, core, sizeof(core), "cpu_core/cpus") > 0 &&
+	    read_attr(root, atom, sizeof(atom), "cpu_atom/cpus") > 0) {
+		for (i = 0; i < this->n_infos; i++) {
+			info = &this->infos[i];
+			if (cpulist_contains(core, info->id))
+				info->core_type = SPA_CPU_CORE_TYPE_PERFORMANCE;
+			else if (cpulist_contains(atom, info->id))
+				info->core_type = SPA_CPU_CORE_TYPE_EFFICIENCY;
+		}
+		return;
+	}
+
+	for (i = 0; i < this->n_infos; i++) {
+		info = &this->infos[i];
+		if (info->capacity == 0)
+			return;
+		max_capacity = SPA_MAX(max_capacity, info->capacity);
+		min_capacity = SPA_MIN(min_capacity, info->capacity);
+	}
+	if (max_capacity == min_capacity)
+		return;
+
+	for (i = 0; i < this->n_infos; i++) {
+		info = &this->infos[i];
+		info->core_type = info->capacity == max_capacity ?
+			SPA_CPU_CORE_TYPE_PERFORMANCE : SPA_CPU_CORE_TYPE_EFFICIENCY;
+	}
+}
+
+static int topology_init(struct impl *this, const char *root)
+{
+	char buf[1024];
+	uint32_t i, n_ids, *ids;
+	struct spa_cpu_info *info;
+
+	if (read_attr(root, buf, sizeof(buf), "system/cpu/online") <= 0)
+		return -ENOENT;
+
+	if ((ids = calloc(MAX_CPUS, sizeof(uint32_t))) == NULL)
+		return -errno;
+
+	n_ids = parse_cpulist(buf, ids, MAX_CPUS);
+	if (n_ids == 0 ||
+	    (this->infos = calloc(n_ids, sizeof(struct spa_cpu_info))) == NULL) {
+		free(ids);
+		return n_ids == 0 ? -ENOENT : -errno;
+	}
+
+	for (i = 0; i < n_ids; i++) {
+		info = &this->infos[i];
+		info->id = ids[i];
+		info->core_id = read_uint(root, info->id,
+				"system/cpu/cpu%u/topology/core_id", info->id);
+		info->package_id = read_uint(root, 0,
+				"system/cpu/cpu%u/topology/physical_package_id", info->id);
+		info->numa_node = read_numa_node(root, info->id);
+		info->capacity = read_uint(root, 0,
+				"system/cpu/cpu%u/cpu_capacity", info->id);
+		info->max_freq = read_uint(root, 0,
+				"system/cpu/cpu%u/cpufreq/cpuinfo_max_freq", info->id);
+
+		if (read_attr(root, buf, sizeof(buf),
+				"system/cpu/cpu%u/topology/thread_siblings_list", info->id) > 0)
+			info->n_siblings = parse_cpulist(buf, NULL, MAX_CPUS);
+		info->n_siblings = SPA_MAX(info->n_siblings, 1u);
+
+		read_caches(root, info);
+	}
+	this->n_infos = n_ids;
+	free(ids);
+
+	assign_core_types(this, root);
+
+	return 0;
+}
+
+/* walking sysfs takes a few hundred reads, only do it for the users of
+ * the topology and not for every cpu handle. The handle can be used from
+ * more threads, the first user reads the topology under the lock and the
+ * others see have_topology only after the table is complete. */
+static void ensure_topology(struct impl *this)
+{
+	int res;
+
+	if (__atomic_load_n(&this->have_topology, __ATOMIC_ACQUIRE))
+		return;
+
+	pthread_mutex_lock(&this->topology_lock);
+	if (!this->have_topology) {
+		if ((res = topology_init(this, this->sysfs_path ? this->sysfs_path : SYSFS_PATH)) < 0)
+			spa_log_debug(this->log, NAME " %p: no CPU topology: %s",
+					this, spa_strerror(res));
+		else
+			spa_log_debug(this->log, NAME " %p: %u CPUs online", this, this->n_infos);
+		__atomic_store_n(&this->have_topology, true, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&this->topology_lock);
+}
+
+static int
+impl_cpu_get_info(void *object, uint32_t index, struct spa_cpu_info *info)
+{
+	struct impl *impl = object;
+
+	ensure_topology(impl);
+
+	if (index >= impl->n_infos)
+		return -ENOENT;
+	*info = impl->infos[index];
+	return 0;
+}
+
+static uint32_t
+impl_cpu_get_cache_size(void *object, uint32_t cpu, uint32_t level)
+{
+	struct impl *impl = object;
+	struct spa_cpu_info *info = NULL;
+	uint32_t i, size = 0;
+
+	ensure_topology(impl);
+
+	for (i = 0; i < impl->n_infos; i++) {
+		if (impl->infos[i].id == cpu) {
+			info = &impl->infos[i];
+			break;
+		}
+	}
+	if (info == NULL)
+		return 0;
+
+	for (i = 0; i < info->n_caches; i++) {
+		if (info->caches[i].level == level &&
+		    info->caches[i].type != SPA_CPU_CACHE_INSTRUCTION)
+			size = SPA_MAX(size, info->caches[i].size);
+	}
+	return size;
+}
+
 static const struct spa_cpu_methods impl_cpu = {
 	SPA_VERSION_CPU_METHODS,
 	.get_flags = impl_cpu_get_flags,
 	.force_flags = impl_cpu_force_flags,
 	.get_count = impl_cpu_get_count,
 	.get_max_align = impl_cpu_get_max_align,
+	.get_info = impl_cpu_get_info,
+	.get_cache_size = impl_cpu_get_cache_size,
 };
 
 static int impl_get_interface(struct spa_handle *handle, const char *type, void **interface)
@@ -143,6 +463,20 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 static int impl_clear(struct spa_handle *handle)
 {
+	struct impl *this;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	free(this->infos);
+	this->infos = NULL;
+	this->n_infos = 0;
+	this->have_topology = false;
+	pthread_mutex_destroy(&this->topology_lock);
+	free(this->sysfs_path);
+	this->sysfs_path = NULL;
+
 	return 0;
 }
 
@@ -178,6 +512,8 @@ impl_init(const struct spa_handle_factory *factory,
 
 	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
 
+	pthread_mutex_init(&this->topology_lock, NULL);
+
 	this->flags = 0;
 	this->force = SPA_CPU_FORCE_AUTODETECT;
 	this->max_align = 16;
@@ -187,6 +523,8 @@ impl_init(const struct spa_handle_factory *factory,
 	if (info) {
 		if ((str = spa_dict_lookup(info, SPA_KEY_CPU_FORCE)) != NULL)
 			this->flags = atoi(str);
+		if ((str = spa_dict_lookup(info, KEY_SYSFS_PATH)) != NULL)
+			this->sysfs_path = strdup(str);
 	}
 
 	spa_log_debug(this->log, NAME " %p: count:%d align:%d flags:%08x",
@@ -0,0 +1,349 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sched.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include <spa/support/log.h>
+#include <spa/support/cpu.h>
+#include <spa/support/parallel.h>
+#include <spa/support/plugin.h>
+#include <spa/utils/type.h>
+#include <spa/utils/hook.h>
+#include <spa/utils/names.h>
+
+#define NAME "parallel"
+
+#define MAX_THREADS	16
+#define DEFAULT_THREADS	4
+#define DEFAULT_RT_PRIO	88
+
+#define SPIN_COUNT	4096
+
+struct impl {
+	struct spa_handle handle;
+	struct spa_parallel parallel;
+
+	struct spa_log *log;
+
+	uint32_t n_threads;
+	uint32_t n_workers;
+	pthread_t workers[MAX_THREADS];
+	sem_t sem;
+
+	/* current job, only written by the thread that owns busy while no
+	 * worker is active */
+	spa_parallel_func_t func;
+	void *data;
+	uint32_t n_tasks;
+
+	uint32_t next;		/**< next task index to claim */
+	uint32_t done;		/**< finished tasks */
+	uint32_t ready;		/**< the job can be joined */
+	uint32_t active;	/**< workers that look at the job */
+	uint32_t busy;		/**< a job is in progress */
+	uint32_t running;
+};
+
+static inline void run_tasks(struct impl *impl)
+{
+	spa_parallel_func_t func = impl->func;
+	void *data = impl->data;
+	uint32_t idx, n_tasks = impl->n_tasks;
+
+	while ((idx = __atomic_fetch_add(&impl->next, 1, __ATOMIC_ACQ_REL)) < n_tasks) {
+		func(data, idx);
+		__atomic_add_fetch(&impl->done, 1, __ATOMIC_RELEASE);
+	}
+}
+
+static void *worker_thread(void *data)
+{
+	struct impl *impl = data;
+
+	while (true) {
+		while (sem_wait(&impl->sem) < 0 && errno == EINTR);
+
+		if (!__atomic_load_n(&impl->running, __ATOMIC_ACQUIRE))
+			break;
+
+		/* a late wakeup can find the job finished, or a new job that
+		 * is still being set up, only join a job that is ready. The
+		 * caller does not set up a new job while we are active. */
+		__atomic_add_fetch(&impl->active, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&impl->ready, __ATOMIC_SEQ_CST))
+			run_tasks(impl);
+		__atomic_sub_fetch(&impl->active, 1, __ATOMIC_RELEASE);
+	}
+	return NULL;
+}
+
+static uint32_t
+impl_parallel_get_n_threads(void *object)
+{
+	struct impl *impl = object;
+	return impl->n_threads;
+}
+
+static int
+impl_parallel_run(void *object, uint32_t n_tasks,
+		spa_parallel_func_t func, void *data)
+{
+	struct impl *impl = object;
+	uint32_t i, n_wake, spin;
+
+	spa_return_val_if_fail(func != NULL, -EINVAL);
+
+	n_wake = SPA_MIN(impl->n_workers, n_tasks > 0 ? n_tasks - 1 : 0);
+
+	/* nothing to share or the pool is in use by another job, run
+	 * everything in the calling thread */
+	if (n_wake == 0 ||
+	    __atomic_exchange_n(&impl->busy, 1, __ATOMIC_ACQUIRE) != 0)
+		goto run_local;
+
+	/* a worker from a previous job did not leave yet, don't wait for
+	 * it, it would see the job change under it */
+	if (__atomic_load_n(&impl->active, __ATOMIC_SEQ_CST) != 0) {
+		__atomic_store_n(&impl->busy, 0, __ATOMIC_RELEASE);
+		goto run_local;
+	}
+
+	impl->func = func;
+	impl->data = data;
+	impl->n_tasks = n_tasks;
+	__atomic_store_n(&impl->next, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&impl->done, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&impl->ready, 1, __ATOMIC_SEQ_CST);
+
+	for (i = 0; i < n_wake; i++)
+		sem_post(&impl->sem);
+
+	/* we claim tasks until there are none left, the tasks that are not
+	 * claimed by the workers yet are run here */
+	run_tasks(impl);
+
+	/* only wait for the tasks that the workers are still running, at
+	 * most the time of one task */
+	spin = 0;
+	while (__atomic_load_n(&impl->done, __ATOMIC_ACQUIRE) < n_tasks) {
+		if (++spin >= SPIN_COUNT) {
+			sched_yield();
+			spin = 0;
+		}
+	}
+
+	__atomic_store_n(&impl->ready, 0, __ATOMIC_SEQ_CST);
+	__atomic_store_n(&impl->busy, 0, __ATOMIC_RELEASE);
+
+	return 0;
+
+run_local:
+	for (i = 0; i < n_tasks; i++)
+		func(data, i);
+	return 0;
+}
+
+static const struct spa_parallel_methods impl_parallel = {
+	SPA_VERSION_PARALLEL_METHODS,
+	.get_n_threads = impl_parallel_get_n_threads,
+	.run = impl_parallel_run,
+};
+
+static int impl_get_interface(struct spa_handle *handle, const char *type, void **interface)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+	spa_return_val_if_fail(interface != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	if (strcmp(type, SPA_TYPE_INTERFACE_Parallel) == 0)
+		*interface = &this->parallel;
+	else
+		return -ENOENT;
+
+	return 0;
+}
+
+static int make_realtime(pthread_t thread, int prio)
+{
+	struct sched_param sp;
+	int policy = SCHED_FIFO, res;
+
+#ifdef SCHED_RESET_ON_FORK
+	policy |= SCHED_RESET_ON_FORK;
+#endif
+	spa_zero(sp);
+	sp.sched_priority = prio;
+	if ((res = pthread_setschedparam(thread, policy, &sp)) != 0)
+		return -res;
+	return 0;
+}
+
+static void stop_workers(struct impl *this)
+{
+	uint32_t i;
+
+	__atomic_store_n(&this->running, 0, __ATOMIC_RELEASE);
+	for (i = 0; i < this->n_workers; i++)
+		sem_post(&this->sem);
+	for (i = 0; i < this->n_workers; i++)
+		pthread_join(this->workers[i], NULL);
+	this->n_workers = 0;
+}
+
+static int impl_clear(struct spa_handle *handle)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	stop_workers(this);
+	sem_destroy(&this->sem);
+
+	return 0;
+}
+
+static size_t
+impl_get_size(const struct spa_handle_factory *factory,
+	      const struct spa_dict *params)
+{
+	return sizeof(struct impl);
+}
+
+static int
+impl_init(const struct spa_handle_factory *factory,
+	  struct spa_handle *handle,
+	  const struct spa_dict *info,
+	  const struct spa_support *support,
+	  uint32_t n_support)
+{
+	struct impl *this;
+	struct spa_cpu *cpu;
+	const char *str;
+	uint32_t i, n_threads;
+	int res, rt_prio = DEFAULT_RT_PRIO;
+
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	handle->get_interface = impl_get_interface;
+	handle->clear = impl_clear;
+
+	this = (struct impl *) handle;
+
+	this->parallel.iface = SPA_INTERFACE_INIT(
+			SPA_TYPE_INTERFACE_Parallel,
+			SPA_VERSION_PARALLEL,
+			&impl_parallel, this);
+
+	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
+	cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+
+	n_threads = DEFAULT_THREADS;
+	if (cpu)
+		n_threads = SPA_MIN(n_threads, (uint32_t)spa_cpu_get_count(cpu));
+
+	if (info) {
+		if ((str = spa_dict_lookup(info, SPA_KEY_PARALLEL_THREADS)) != NULL)
+			n_threads = atoi(str);
+		if ((str = spa_dict_lookup(info, SPA_KEY_PARALLEL_RT_PRIO)) != NULL)
+			rt_prio = atoi(str);
+	}
+	n_threads = SPA_CLAMP(n_threads, 1u, (uint32_t)MAX_THREADS);
+
+	if (sem_init(&this->sem, 0, 0) < 0)
+		return -errno;
+
+	this->running = 1;
+	for (i = 0; i < n_threads - 1; i++) {
+		if ((res = pthread_create(&this->workers[i], NULL, worker_thread, this)) != 0) {
+			spa_log_warn(this->log, NAME " %p: can't create worker: %s",
+					this, strerror(res));
+			break;
+		}
+		this->n_workers++;
+
+		/* the data thread waits for the workers, they must not be
+		 * preempted by anything it does not preempt itself */
+		if (rt_prio > 0 && (res = make_realtime(this->workers[i], rt_prio)) < 0) {
+			spa_log_warn(this->log, NAME " %p: can't make worker realtime "
+					"prio:%d: %s, not using workers",
+					this, rt_prio, strerror(-res));
+			stop_workers(this);
+			break;
+		}
+	}
+	this->n_threads = this->n_workers + 1;
+
+	spa_log_debug(this->log, NAME " %p: threads:%d rt.prio:%d", this,
+			this->n_threads, rt_prio);
+
+	return 0;
+}
+
+static const struct spa_interface_info impl_interfaces[] = {
+	{SPA_TYPE_INTERFACE_Parallel,},
+};
+
+static int
+impl_enum_interface_info(const struct spa_handle_factory *factory,
+			 const struct spa_interface_info **info,
+			 uint32_t *index)
+{
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(info != NULL, -EINVAL);
+	spa_return_val_if_fail(index != NULL, -EINVAL);
+
+	switch (*index) {
+	case 0:
+		*info = &impl_interfaces[*index];
+		break;
+	default:
+		return 0;
+	}
+	(*index)++;
+
+	return 1;
+}
+
+const struct spa_handle_factory spa_support_parallel_factory = {
+	SPA_VERSION_HANDLE_FACTORY,
+	SPA_NAME_SUPPORT_PARALLEL,
+	NULL,
+	impl_get_size,
+	impl_init,
+	impl_enum_interface_info,
+};
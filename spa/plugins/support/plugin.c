@@ -33,6 +33,7 @@ extern const struct spa_handle_factory spa_support_cpu_factory;
 extern const struct spa_handle_factory spa_support_loop_factory;
 extern const struct spa_handle_factory spa_support_node_driver_factory;
 extern const struct spa_handle_factory spa_support_null_audio_sink_factory;
+extern const struct spa_handle_factory spa_support_parallel_factory;
 
 SPA_EXPORT
 int spa_handle_factory_enum(const struct spa_handle_factory **factory, uint32_t *index)
@@ -59,6 +60,9 @@ int spa_handle_factory_enum(const struct spa_handle_factory **factory, uint32_t
 	case 5:
 		*factory = &spa_support_null_audio_sink_factory;
 		break;
+	case 6:
+		*factory = &spa_support_parallel_factory;
+		break;
 	default:
 		return 0;
 	}
@@ -0,0 +1,299 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <limits.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include <spa/support/plugin.h>
+#include <spa/support/cpu.h>
+#include <spa/utils/names.h>
+#include <spa/utils/type.h>
+
+/* the cpu handle reads the topology from a fake sysfs tree */
+#define KEY_SYSFS_PATH	"cpu.sysfs-path"
+
+static char root[] = "/tmp/spa-test-cpu-XXXXXX";
+
+static void write_attr(const char *value, const char *fmt, ...)
+{
+	char path[PATH_MAX], *p;
+	va_list args;
+	FILE *f;
+	int len;
+
+	len = snprintf(path, sizeof(path), "%s/", root);
+	va_start(args, fmt);
+	vsnprintf(path + len, sizeof(path) - len, fmt, args);
+	va_end(args);
+
+	for (p = path + strlen(root) + 1; (p = strchr(p, '/')) != NULL; p++) {
+		*p = '\0';
+		mkdir(path, 0755);
+		*p = '/';
+	}
+	f = fopen(path, "w");
+	spa_assert(f != NULL);
+	fprintf(f, "%s\n", value);
+	fclose(f);
+}
+
+static void write_cache(uint32_t cpu, uint32_t index, const char *level,
+		const char *type, const char *size, const char *shared)
+{
+	write_attr(level, "system/cpu/cpu%u/cache/index%u/level", cpu, index);
+	write_attr(type, "system/cpu/cpu%u/cache/index%u/type", cpu, index);
+	write_attr(size, "system/cpu/cpu%u/cache/index%u/size", cpu, index);
+	write_attr("64", "system/cpu/cpu%u/cache/index%u/coherency_line_size", cpu, index);
+	write_attr(shared, "system/cpu/cpu%u/cache/index%u/shared_cpu_list", cpu, index);
+}
+
+static struct spa_handle *load_cpu(struct spa_cpu **cpu)
+{
+	const struct spa_handle_factory *factory;
+	struct spa_dict_item items[1];
+	struct spa_handle *handle;
+	uint32_t index = 0;
+	void *iface;
+
+	items[0] = SPA_DICT_ITEM_INIT(KEY_SYSFS_PATH, root);
+
+	while (true) {
+		spa_assert(spa_handle_factory_enum(&factory, &index) == 1);
+		if (strcmp(factory->name, SPA_NAME_SUPPORT_CPU) == 0)
+			break;
+	}
+	handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+	spa_assert(handle != NULL);
+	spa_assert(spa_handle_factory_init(factory, handle,
+				&SPA_DICT_INIT_ARRAY(items), NULL, 0) == 0);
+	spa_assert(spa_handle_get_interface(handle, SPA_TYPE_INTERFACE_CPU, &iface) == 0);
+	*cpu = iface;
+	return handle;
+}
+
+static void unload_cpu(struct spa_handle *handle)
+{
+	spa_handle_clear(handle);
+	free(handle);
+}
+
+static int remove_entry(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+	return remove(path);
+}
+
+static void clear_tree(void)
+{
+	nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+	spa_assert(mkdir(root, 0700) == 0);
+}
+
+/* two hyperthreaded performance cores and two efficiency cores, the last
+ * one on another NUMA node, like a hybrid Intel CPU */
+static void test_hybrid(void)
+{
+	struct spa_handle *handle;
+	struct spa_cpu *cpu;
+	struct spa_cpu_info info;
+	uint32_t i;
+
+	clear_tree();
+	write_attr("0-3", "system/cpu/online");
+	write_attr("0-1", "cpu_core/cpus");
+	write_attr("2-3", "cpu_atom/cpus");
+
+	for (i = 0; i < 4; i++) {
+		write_attr(i < 2 ? "0" : i == 2 ? "4" : "5",
+				"system/cpu/cpu%u/topology/core_id", i);
+		write_attr("0", "system/cpu/cpu%u/topology/physical_package_id", i);
+		write_attr(i < 2 ? "0-1" : i == 2 ? "2" : "3",
+				"system/cpu/cpu%u/topology/thread_siblings_list", i);
+		write_attr(i < 2 ? "4700000" : "3600000",
+				"system/cpu/cpu%u/cpufreq/cpuinfo_max_freq", i);
+		write_attr("", "system/cpu/cpu%u/node%u/.keep", i, i == 3 ? 1 : 0);
+
+		if (i < 2) {
+			write_cache(i, 0, "1", "Data", "48K", "0-1");
+			write_cache(i, 1, "1", "Instruction", "32K", "0-1");
+			write_cache(i, 2, "2", "Unified", "1280K", "0-1");
+		} else {
+			write_cache(i, 0, "1", "Data", "32K", i == 2 ? "2" : "3");
+			write_cache(i, 1, "1", "Instruction", "64K", i == 2 ? "2" : "3");
+			write_cache(i, 2, "2", "Unified", "2048K", "2-3");
+		}
+		write_cache(i, 3, "3", "Unified", "24M", "0-3");
+	}
+
+	handle = load_cpu(&cpu);
+
+	spa_assert(spa_cpu_get_info(cpu, 0, &info) == 0);
+	spa_assert(info.id == 0);
+	spa_assert(info.core_id == 0);
+	spa_assert(info.package_id == 0);
+	spa_assert(info.numa_node == 0);
+	spa_assert(info.core_type == SPA_CPU_CORE_TYPE_PERFORMANCE);
+	spa_assert(info.max_freq == 4700000);
+	spa_assert(info.n_siblings == 2);
+	spa_assert(info.n_caches == 4);
+	spa_assert(info.caches[0].level == 1);
+	spa_assert(info.caches[0].type == SPA_CPU_CACHE_DATA);
+	spa_assert(info.caches[0].size == 48 * 1024);
+	spa_assert(info.caches[0].line_size == 64);
+	spa_assert(info.caches[0].n_shared == 2);
+	spa_assert(info.caches[1].type == SPA_CPU_CACHE_INSTRUCTION);
+	spa_assert(info.caches[3].level == 3);
+	spa_assert(info.caches[3].size == 24 * 1024 * 1024);
+	spa_assert(info.caches[3].n_shared == 4);
+
+	spa_assert(spa_cpu_get_info(cpu, 3, &info) == 0);
+	spa_assert(info.id == 3);
+	spa_assert(info.core_id == 5);
+	spa_assert(info.numa_node == 1);
+	spa_assert(info.core_type == SPA_CPU_CORE_TYPE_EFFICIENCY);
+	spa_assert(info.n_siblings == 1);
+	spa_assert(info.caches[2].n_shared == 2);
+
+	spa_assert(spa_cpu_get_info(cpu, 4, &info) == -ENOENT);
+
+	/* instruction caches are not counted */
+	spa_assert(spa_cpu_get_cache_size(cpu, 0, 1) == 48 * 1024);
+	spa_assert(spa_cpu_get_cache_size(cpu, 2, 1) == 32 * 1024);
+	spa_assert(spa_cpu_get_cache_size(cpu, 1, 2) == 1280 * 1024);
+	spa_assert(spa_cpu_get_cache_size(cpu, 3, 2) == 2048 * 1024);
+	spa_assert(spa_cpu_get_cache_size(cpu, 3, 4) == 0);
+	spa_assert(spa_cpu_get_cache_size(cpu, 7, 1) == 0);
+
+	unload_cpu(handle);
+}
+
+/* big.LITTLE, the core types come from the capacity and a CPU is offline */
+static void test_capacity(void)
+{
+	struct spa_handle *handle;
+	struct spa_cpu *cpu;
+	struct spa_cpu_info info;
+	uint32_t i;
+
+	clear_tree();
+	write_attr("0-2,4", "system/cpu/online");
+	for (i = 0; i < 5; i++)
+		write_attr(i < 4 ? "446" : "1024", "system/cpu/cpu%u/cpu_capacity", i);
+
+	handle = load_cpu(&cpu);
+
+	spa_assert(spa_cpu_get_info(cpu, 2, &info) == 0);
+	spa_assert(info.id == 2);
+	spa_assert(info.core_id == 2);
+	spa_assert(info.capacity == 446);
+	spa_assert(info.core_type == SPA_CPU_CORE_TYPE_EFFICIENCY);
+	spa_assert(info.n_siblings == 1);
+	spa_assert(info.n_caches == 0);
+
+	spa_assert(spa_cpu_get_info(cpu, 3, &info) == 0);
+	spa_assert(info.id == 4);
+	spa_assert(info.capacity == 1024);
+	spa_assert(info.core_type == SPA_CPU_CORE_TYPE_PERFORMANCE);
+	spa_assert(spa_cpu_get_info(cpu, 4, &info) == -ENOENT);
+
+	unload_cpu(handle);
+}
+
+#define N_THREADS	8
+
+static void *get_info_thread(void *data)
+{
+	struct spa_cpu *cpu = data;
+	struct spa_cpu_info info;
+	uint32_t i;
+
+	for (i = 0; i < 64; i++) {
+		spa_assert(spa_cpu_get_info(cpu, i, &info) == 0);
+		spa_assert(info.id == i);
+		spa_assert(info.n_caches == 1);
+	}
+	spa_assert(spa_cpu_get_info(cpu, 64, &info) == -ENOENT);
+	return NULL;
+}
+
+/* the first users of a handle read the topology at the same time, all of
+ * them see the complete table */
+static void test_threads(void)
+{
+	struct spa_handle *handle;
+	struct spa_cpu *cpu;
+	pthread_t threads[N_THREADS];
+	uint32_t i;
+
+	clear_tree();
+	write_attr("0-63", "system/cpu/online");
+	for (i = 0; i < 64; i++)
+		write_cache(i, 0, "1", "Data", "32K", "0");
+
+	handle = load_cpu(&cpu);
+
+	for (i = 0; i < N_THREADS; i++)
+		spa_assert(pthread_create(&threads[i], NULL, get_info_thread, cpu) == 0);
+	for (i = 0; i < N_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	unload_cpu(handle);
+}
+
+/* without sysfs there is no topology but the interface still works */
+static void test_missing(void)
+{
+	struct spa_handle *handle;
+	struct spa_cpu *cpu;
+	struct spa_cpu_info info;
+
+	clear_tree();
+
+	handle = load_cpu(&cpu);
+
+	spa_assert(spa_cpu_get_info(cpu, 0, &info) == -ENOENT);
+	spa_assert(spa_cpu_get_cache_size(cpu, 0, 1) == 0);
+
+	unload_cpu(handle);
+}
+
+int main(int argc, char *argv[])
+{
+	spa_assert(mkdtemp(root) != NULL);
+
+	test_hybrid();
+	test_capacity();
+	test_threads();
+	test_missing();
+
+	nftw(root, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+
+	return 0;
+}
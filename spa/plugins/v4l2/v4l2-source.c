@@ -91,12 +91,12 @@ struct port {
 
 	bool alloc_buffers;
 	bool have_expbuf;
+	bool use_userptr;
 
-	bool next_fmtdesc;
-	struct v4l2_fmtdesc fmtdesc;
-	bool next_frmsize;
-	struct v4l2_frmsizeenum frmsize;
-	struct v4l2_frmivalenum frmival;
+	struct spa_pod **enum_formats;
+	uint32_t n_enum_formats;
+	bool enum_formats_valid;
+	bool have_events;
 
 	bool have_format;
 	struct spa_video_info current_format;
@@ -116,6 +116,10 @@ struct port {
 	uint32_t n_buffers;
 	struct spa_list queue;
 
+	bool use_read;
+	struct spa_list free;
+	uint32_t read_sequence;
+
 	struct spa_source source;
 
 	uint64_t info_all;
@@ -889,6 +893,10 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 static int impl_clear(struct spa_handle *handle)
 {
+	struct impl *this = (struct impl *) handle;
+
+	enum_formats_clear(&this->out_ports[0]);
+
 	return 0;
 }
 
@@ -948,6 +956,7 @@ impl_init(const struct spa_handle_factory *factory,
 	port = GET_OUT_PORT(this, 0);
 	port->impl = this;
 	spa_list_init(&port->queue);
+	spa_list_init(&port->free);
 	port->info_all = SPA_PORT_CHANGE_MASK_FLAGS |
 			SPA_PORT_CHANGE_MASK_PARAMS;
 	port->info = SPA_PORT_INFO_INIT();
@@ -969,6 +978,9 @@ impl_init(const struct spa_handle_factory *factory,
 	port->dev.log = this->log;
 	port->dev.fd = -1;
 
+	if (info && (str = spa_dict_lookup(info, "api.v4l2.use-userptr")))
+		port->use_userptr = strcmp(str, "true") == 0 || atoi(str) == 1;
+
 	if (info && (str = spa_dict_lookup(info, SPA_KEY_API_V4L2_PATH))) {
 		strncpy(this->props.device, str, 63);
 		if ((res = spa_v4l2_open(&port->dev, this->props.device)) < 0)
@@ -28,8 +28,13 @@
 #include <errno.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <poll.h>
 
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC	0x0001U
+#endif
+
 static void v4l2_on_fd_events(struct spa_source *source);
 
 static int xioctl(int fd, int request, void *arg)
@@ -132,6 +137,11 @@ static int spa_v4l2_buffer_recycle(struct impl *this, uint32_t buffer_id)
 	SPA_FLAG_CLEAR(b->flags, BUFFER_FLAG_OUTSTANDING);
 	spa_log_trace(this->log, "v4l2 %p: recycle buffer %d", this, buffer_id);
 
+	if (port->use_read) {
+		spa_list_append(&port->free, &b->link);
+		return 0;
+	}
+
 	if (xioctl(dev->fd, VIDIOC_QBUF, &b->v4l2_buffer) < 0) {
 		err = errno;
 		spa_log_error(this->log, "v4l2: '%s' VIDIOC_QBUF: %m", this->props.device);
@@ -171,15 +181,19 @@ static int spa_v4l2_clear_buffers(struct impl *this)
 		d[0].type = SPA_ID_INVALID;
 	}
 
-	spa_zero(reqbuf);
-	reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-	reqbuf.memory = port->memtype;
-	reqbuf.count = 0;
+	if (!port->use_read) {
+		spa_zero(reqbuf);
+		reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		reqbuf.memory = port->memtype;
+		reqbuf.count = 0;
 
-	if (xioctl(port->dev.fd, VIDIOC_REQBUFS, &reqbuf) < 0) {
-		spa_log_warn(this->log, "VIDIOC_REQBUFS: %m");
+		if (xioctl(port->dev.fd, VIDIOC_REQBUFS, &reqbuf) < 0) {
+			spa_log_warn(this->log, "VIDIOC_REQBUFS: %m");
+		}
 	}
 	port->n_buffers = 0;
+	port->use_read = false;
+	spa_list_init(&port->free);
 
 	return 0;
 }
@@ -389,464 +403,331 @@ static const struct format_info *find_format_info_by_media_type(uint32_t type,
 	return NULL;
 }
 
-static uint32_t
-enum_filter_format(uint32_t media_type, int32_t media_subtype,
-		   const struct spa_pod *filter, uint32_t index)
-{
-	uint32_t video_format = 0;
-
-	switch (media_type) {
-	case SPA_MEDIA_TYPE_video:
-	case SPA_MEDIA_TYPE_image:
-		if (media_subtype == SPA_MEDIA_SUBTYPE_raw) {
-			const struct spa_pod_prop *p;
-			const struct spa_pod *val;
-			uint32_t n_values, choice;
-			const uint32_t *values;
+#define FOURCC_ARGS(f) (f)&0x7f,((f)>>8)&0x7f,((f)>>16)&0x7f,((f)>>24)&0x7f
 
-			if (!(p = spa_pod_find_prop(filter, NULL, SPA_FORMAT_VIDEO_format)))
-				return SPA_VIDEO_FORMAT_UNKNOWN;
+static void enum_formats_clear(struct port *port)
+{
+	uint32_t i;
 
-			val = spa_pod_get_values(&p->value, &n_values, &choice);
+	for (i = 0; i < port->n_enum_formats; i++)
+		free(port->enum_formats[i]);
+	free(port->enum_formats);
+	port->enum_formats = NULL;
+	port->n_enum_formats = 0;
+	port->enum_formats_valid = false;
+}
 
-			if (val->type != SPA_TYPE_Id)
-				return SPA_VIDEO_FORMAT_UNKNOWN;
+static int enum_formats_add(struct port *port, const struct spa_pod *param)
+{
+	struct spa_pod **formats, *copy;
 
-			values = SPA_POD_BODY(val);
+	if ((copy = spa_pod_copy(param)) == NULL)
+		return -errno;
 
-			if (choice == SPA_CHOICE_None) {
-				if (index == 0)
-					video_format = values[0];
-			} else {
-				if (index + 1 < n_values)
-					video_format = values[index + 1];
-			}
-		} else {
-			if (index == 0)
-				video_format = SPA_VIDEO_FORMAT_ENCODED;
-		}
+	formats = realloc(port->enum_formats,
+			(port->n_enum_formats + 1) * sizeof(struct spa_pod *));
+	if (formats == NULL) {
+		free(copy);
+		return -errno;
 	}
-	return video_format;
+	port->enum_formats = formats;
+	port->enum_formats[port->n_enum_formats++] = copy;
+	return 0;
 }
 
-static bool
-filter_framesize(struct v4l2_frmsizeenum *frmsize,
-		 const struct spa_rectangle *min,
-		 const struct spa_rectangle *max,
-		 const struct spa_rectangle *step)
+/* build the EnumFormat param for one frame size, returns NULL when the
+ * size has no frame intervals */
+static struct spa_pod *
+build_format(struct impl *this, struct spa_pod_builder *b, const struct format_info *info,
+		struct v4l2_frmsizeenum *frmsize, int *res)
 {
+	struct port *port = &this->out_ports[0];
+	struct spa_v4l2_device *dev = &port->dev;
+	struct v4l2_frmivalenum frmival;
+	struct spa_pod_choice *choice;
+	struct spa_pod_frame f[2];
+	int n_fractions;
+
+	spa_zero(frmival);
+	frmival.index = 0;
+	frmival.pixel_format = frmsize->pixel_format;
+
 	if (frmsize->type == V4L2_FRMSIZE_TYPE_DISCRETE) {
-		if (frmsize->discrete.width < min->width ||
-		    frmsize->discrete.height < min->height ||
-		    frmsize->discrete.width > max->width ||
-		    frmsize->discrete.height > max->height) {
-			return false;
-		}
+		/* we have a fixed size, use this to get the frame intervals */
+		frmival.width = frmsize->discrete.width;
+		frmival.height = frmsize->discrete.height;
 	} else if (frmsize->type == V4L2_FRMSIZE_TYPE_CONTINUOUS ||
 		   frmsize->type == V4L2_FRMSIZE_TYPE_STEPWISE) {
-		/* FIXME, use LCM */
-		frmsize->stepwise.step_width *= step->width;
-		frmsize->stepwise.step_height *= step->height;
-
-		if (frmsize->stepwise.max_width < min->width ||
-		    frmsize->stepwise.max_height < min->height ||
-		    frmsize->stepwise.min_width > max->width ||
-		    frmsize->stepwise.min_height > max->height)
-			return false;
-
-		frmsize->stepwise.min_width = SPA_MAX(frmsize->stepwise.min_width, min->width);
-		frmsize->stepwise.min_height = SPA_MAX(frmsize->stepwise.min_height, min->height);
-		frmsize->stepwise.max_width = SPA_MIN(frmsize->stepwise.max_width, max->width);
-		frmsize->stepwise.max_height = SPA_MIN(frmsize->stepwise.max_height, max->height);
-	} else
-		return false;
+		/* we have a non fixed size, fix to something sensible to get the
+		 * framerate */
+		frmival.width = frmsize->stepwise.min_width;
+		frmival.height = frmsize->stepwise.min_height;
+	} else {
+		return NULL;
+	}
 
-	return true;
-}
+	spa_pod_builder_push_object(b, &f[0], SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+	spa_pod_builder_add(b,
+			SPA_FORMAT_mediaType,    SPA_POD_Id(info->media_type),
+			SPA_FORMAT_mediaSubtype, SPA_POD_Id(info->media_subtype),
+			0);
 
-static int compare_fraction(struct v4l2_fract *f1, const struct spa_fraction *f2)
-{
-	uint64_t n1, n2;
+	if (info->media_subtype == SPA_MEDIA_SUBTYPE_raw) {
+		spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_format, 0);
+		spa_pod_builder_id(b, info->format);
+	}
+	spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_size, 0);
+	if (frmsize->type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+		spa_pod_builder_rectangle(b, frmsize->discrete.width, frmsize->discrete.height);
+	} else {
+		spa_pod_builder_push_choice(b, &f[1],
+				frmsize->type == V4L2_FRMSIZE_TYPE_CONTINUOUS ?
+					SPA_CHOICE_Range : SPA_CHOICE_Step, 0);
+		spa_pod_builder_rectangle(b, frmsize->stepwise.min_width,
+				frmsize->stepwise.min_height);
+		spa_pod_builder_rectangle(b, frmsize->stepwise.min_width,
+				frmsize->stepwise.min_height);
+		spa_pod_builder_rectangle(b, frmsize->stepwise.max_width,
+				frmsize->stepwise.max_height);
+		if (frmsize->type == V4L2_FRMSIZE_TYPE_STEPWISE)
+			spa_pod_builder_rectangle(b, frmsize->stepwise.step_width,
+					frmsize->stepwise.step_height);
+		spa_pod_builder_pop(b, &f[1]);
+	}
 
-	/* fractions are reduced when set, so we can quickly see if they're equal */
-	if (f1->denominator == f2->num && f1->numerator == f2->denom)
-		return 0;
+	spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_framerate, 0);
 
-	/* extend to 64 bits */
-	n1 = ((int64_t) f1->denominator) * f2->denom;
-	n2 = ((int64_t) f1->numerator) * f2->num;
-	if (n1 < n2)
-		return -1;
-	return 1;
-}
+	n_fractions = 0;
 
-static bool
-filter_framerate(struct v4l2_frmivalenum *frmival,
-		 const struct spa_fraction *min,
-		 const struct spa_fraction *max,
-		 const struct spa_fraction *step)
-{
-	if (frmival->type == V4L2_FRMIVAL_TYPE_DISCRETE) {
-		if (compare_fraction(&frmival->discrete, min) < 0 ||
-		    compare_fraction(&frmival->discrete, max) > 0)
-			return false;
-	} else if (frmival->type == V4L2_FRMIVAL_TYPE_CONTINUOUS ||
-		   frmival->type == V4L2_FRMIVAL_TYPE_STEPWISE) {
-		/* FIXME, use LCM */
-		frmival->stepwise.step.denominator *= step->num;
-		frmival->stepwise.step.numerator *= step->denom;
-
-		if (compare_fraction(&frmival->stepwise.max, min) < 0 ||
-		    compare_fraction(&frmival->stepwise.min, max) > 0)
-			return false;
-
-		if (compare_fraction(&frmival->stepwise.min, min) < 0) {
-			frmival->stepwise.min.denominator = min->num;
-			frmival->stepwise.min.numerator = min->denom;
+	spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_None, 0);
+	choice = (struct spa_pod_choice*)spa_pod_builder_frame(b, &f[1]);
+
+	while (true) {
+		if (xioctl(dev->fd, VIDIOC_ENUM_FRAMEINTERVALS, &frmival) < 0) {
+			if (errno == EINVAL) {
+				if (frmival.index == 0)
+					return NULL;
+				break;
+			}
+			*res = -errno;
+			spa_log_error(this->log, "v4l2: '%s' VIDIOC_ENUM_FRAMEINTERVALS: %m",
+					this->props.device);
+			return NULL;
 		}
-		if (compare_fraction(&frmival->stepwise.max, max) > 0) {
-			frmival->stepwise.max.denominator = max->num;
-			frmival->stepwise.max.numerator = max->denom;
+
+		if (frmival.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
+			choice->body.type = SPA_CHOICE_Enum;
+			if (n_fractions == 0)
+				spa_pod_builder_fraction(b,
+							 frmival.discrete.denominator,
+							 frmival.discrete.numerator);
+			spa_pod_builder_fraction(b,
+						 frmival.discrete.denominator,
+						 frmival.discrete.numerator);
+			frmival.index++;
+		} else if (frmival.type == V4L2_FRMIVAL_TYPE_CONTINUOUS ||
+			   frmival.type == V4L2_FRMIVAL_TYPE_STEPWISE) {
+			if (n_fractions == 0)
+				spa_pod_builder_fraction(b, 25, 1);
+			spa_pod_builder_fraction(b,
+						 frmival.stepwise.min.denominator,
+						 frmival.stepwise.min.numerator);
+			spa_pod_builder_fraction(b,
+						 frmival.stepwise.max.denominator,
+						 frmival.stepwise.max.numerator);
+
+			if (frmival.type == V4L2_FRMIVAL_TYPE_CONTINUOUS) {
+				choice->body.type = SPA_CHOICE_Range;
+			} else {
+				choice->body.type = SPA_CHOICE_Step;
+				spa_pod_builder_fraction(b,
+							 frmival.stepwise.step.denominator,
+							 frmival.stepwise.step.numerator);
+			}
+			break;
 		}
-	} else
-		return false;
+		n_fractions++;
+	}
+	if (n_fractions <= 1)
+		choice->body.type = SPA_CHOICE_None;
 
-	return true;
+	spa_pod_builder_pop(b, &f[1]);
+	return spa_pod_builder_pop(b, &f[0]);
 }
 
-#define FOURCC_ARGS(f) (f)&0x7f,((f)>>8)&0x7f,((f)>>16)&0x7f,((f)>>24)&0x7f
-
-static int
-spa_v4l2_enum_format(struct impl *this, int seq,
-		     uint32_t start, uint32_t num,
-		     const struct spa_pod *filter)
+/* walk all formats, frame sizes and frame intervals of the device once and
+ * keep the resulting EnumFormat params until the driver signals a change */
+static int enum_formats_fill(struct impl *this)
 {
 	struct port *port = &this->out_ports[0];
-	int res, n_fractions;
-	const struct format_info *info;
-	struct spa_pod_choice *choice;
-	uint32_t filter_media_type, filter_media_subtype, video_format;
 	struct spa_v4l2_device *dev = &port->dev;
-	uint8_t buffer[1024];
+	struct v4l2_fmtdesc fmtdesc;
+	struct v4l2_frmsizeenum frmsize;
+	const struct format_info *info;
 	struct spa_pod_builder b = { 0 };
-	struct spa_pod_frame f[2];
-	struct spa_result_node_params result;
-	uint32_t count = 0;
+	struct spa_pod *param;
+	uint8_t buffer[1024];
+	int res = 0;
+
+	enum_formats_clear(port);
 
 	if ((res = spa_v4l2_open(dev, this->props.device)) < 0)
 		return res;
 
-	result.id = SPA_PARAM_EnumFormat;
-	result.next = start;
-
-	if (result.next == 0) {
-		spa_zero(port->fmtdesc);
-		port->fmtdesc.index = 0;
-		port->fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-		port->next_fmtdesc = true;
-		spa_zero(port->frmsize);
-		port->next_frmsize = true;
-		spa_zero(port->frmival);
-	}
+	spa_zero(fmtdesc);
+	fmtdesc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
 
-	if (filter) {
-		if ((res = spa_format_parse(filter, &filter_media_type, &filter_media_subtype)) < 0)
-			return res;
-	}
-
-	if (false) {
-	      next_fmtdesc:
-		port->fmtdesc.index++;
-		port->next_fmtdesc = true;
-	}
-
-      next:
-	result.index = result.next++;
-
-	while (port->next_fmtdesc) {
-		if (filter) {
-			struct v4l2_format fmt;
-
-			video_format = enum_filter_format(filter_media_type,
-					    filter_media_subtype,
-					    filter, port->fmtdesc.index);
-
-			if (video_format == SPA_VIDEO_FORMAT_UNKNOWN)
-				goto enum_end;
+	for (fmtdesc.index = 0;; fmtdesc.index++) {
+		if (xioctl(dev->fd, VIDIOC_ENUM_FMT, &fmtdesc) < 0) {
+			if (errno == EINVAL)
+				break;
+			res = -errno;
+			spa_log_error(this->log, "v4l2: '%s' VIDIOC_ENUM_FMT: %m",
+					this->props.device);
+			goto exit;
+		}
+		if (!(info = fourcc_to_format_info(fmtdesc.pixelformat)))
+			continue;
 
-			info = find_format_info_by_media_type(filter_media_type,
-							      filter_media_subtype,
-							      video_format, 0);
-			if (info == NULL)
-				goto next_fmtdesc;
-
-			port->fmtdesc.pixelformat = info->fourcc;
-
-			spa_zero(fmt);
-			fmt.type = port->fmtdesc.type;
-			fmt.fmt.pix.pixelformat = info->fourcc;
-			fmt.fmt.pix.field = V4L2_FIELD_ANY;
-			fmt.fmt.pix.width = 0;
-			fmt.fmt.pix.height = 0;
-
-			if ((res = xioctl(dev->fd, VIDIOC_TRY_FMT, &fmt)) < 0) {
-				spa_log_debug(this->log, "v4l2: '%s' VIDIOC_TRY_FMT %08x: %m",
-						this->props.device, info->fourcc);
-				goto next_fmtdesc;
-			}
-			if (fmt.fmt.pix.pixelformat != info->fourcc) {
-				spa_log_debug(this->log, "v4l2: '%s' VIDIOC_TRY_FMT wanted %.4s gave %.4s",
-						this->props.device, (char*)&info->fourcc,
-						(char*)&fmt.fmt.pix.pixelformat);
-				goto next_fmtdesc;
-			}
+		spa_zero(frmsize);
+		frmsize.pixel_format = fmtdesc.pixelformat;
 
-		} else {
-			if ((res = xioctl(dev->fd, VIDIOC_ENUM_FMT, &port->fmtdesc)) < 0) {
+		for (frmsize.index = 0;; frmsize.index++) {
+			if (xioctl(dev->fd, VIDIOC_ENUM_FRAMESIZES, &frmsize) < 0) {
 				if (errno == EINVAL)
-					goto enum_end;
-
+					break;
 				res = -errno;
-				spa_log_error(this->log, "v4l2: '%s' VIDIOC_ENUM_FMT: %m",
+				spa_log_error(this->log, "v4l2: '%s' VIDIOC_ENUM_FRAMESIZES: %m",
 						this->props.device);
 				goto exit;
 			}
+			spa_pod_builder_init(&b, buffer, sizeof(buffer));
+			if ((param = build_format(this, &b, info, &frmsize, &res)) == NULL) {
+				if (res < 0)
+					goto exit;
+				continue;
+			}
+			if ((res = enum_formats_add(port, param)) < 0)
+				goto exit;
 		}
-		port->next_fmtdesc = false;
-		port->frmsize.index = 0;
-		port->frmsize.pixel_format = port->fmtdesc.pixelformat;
-		port->next_frmsize = true;
 	}
-	if (!(info = fourcc_to_format_info(port->fmtdesc.pixelformat)))
-		goto next_fmtdesc;
-
-      next_frmsize:
-	while (port->next_frmsize) {
-		if (filter) {
-			const struct spa_pod_prop *p;
-			struct spa_pod *val;
-			uint32_t n_vals, choice;
-
-			/* check if we have a fixed frame size */
-			if (!(p = spa_pod_find_prop(filter, NULL, SPA_FORMAT_VIDEO_size)))
-				goto do_frmsize;
-
-			val = spa_pod_get_values(&p->value, &n_vals, &choice);
-			if (val->type != SPA_TYPE_Rectangle)
-				goto enum_end;
+	port->enum_formats_valid = true;
+	spa_log_debug(this->log, "v4l2: '%s' has %u formats", this->props.device,
+			port->n_enum_formats);
 
-			if (choice == SPA_CHOICE_None) {
-				const struct spa_rectangle *values = SPA_POD_BODY(val);
+      exit:
+	if (res < 0)
+		enum_formats_clear(port);
+	spa_v4l2_close(dev);
+	return res;
+}
 
-				if (port->frmsize.index > 0)
-					goto next_fmtdesc;
+static bool size_in_step(const struct spa_rectangle *size, const struct spa_rectangle *min,
+		const struct spa_rectangle *max, const struct spa_rectangle *step)
+{
+	if (size->width < min->width || size->width > max->width ||
+	    size->height < min->height || size->height > max->height)
+		return false;
+	if (step->width > 0 && (size->width - min->width) % step->width != 0)
+		return false;
+	if (step->height > 0 && (size->height - min->height) % step->height != 0)
+		return false;
+	return true;
+}
 
-				port->frmsize.type = V4L2_FRMSIZE_TYPE_DISCRETE;
-				port->frmsize.discrete.width = values[0].width;
-				port->frmsize.discrete.height = values[0].height;
-				goto have_size;
-			}
-		}
-	      do_frmsize:
-		if ((res = xioctl(dev->fd, VIDIOC_ENUM_FRAMESIZES, &port->frmsize)) < 0) {
-			if (errno == EINVAL)
-				goto next_fmtdesc;
+/* spa_pod_filter() can't intersect a Step choice with fixed values. When
+ * the cached format has a stepwise size and the filter has fixed sizes,
+ * build a copy of the format with the filter sizes that are valid for
+ * the device. Returns NULL when none of them are. */
+static const struct spa_pod *
+filter_step_size(struct spa_pod_builder *b, const struct spa_pod *param,
+		const struct spa_pod *filter)
+{
+	const struct spa_pod_object *obj = (const struct spa_pod_object *)param;
+	const struct spa_pod_prop *p, *fp;
+	const struct spa_pod *val, *fval;
+	const struct spa_rectangle *sizes, *fsizes;
+	uint32_t i, n_vals, n_fvals, choice, fchoice, n_match = 0;
+	struct spa_pod_frame f[2];
 
-			res = -errno;
-			spa_log_error(this->log, "v4l2: '%s' VIDIOC_ENUM_FRAMESIZES: %m",
-					this->props.device);
-			goto exit;
-		}
-		if (filter) {
-			const struct spa_pod_prop *p;
-			struct spa_pod *val;
-			const struct spa_rectangle step = { 1, 1 }, *values;
-			uint32_t choice, i, n_values;
-
-			/* check if we have a fixed frame size */
-			if (!(p = spa_pod_find_prop(filter, NULL, SPA_FORMAT_VIDEO_size)))
-				goto have_size;
-
-			val = spa_pod_get_values(&p->value, &n_values, &choice);
-			if (val->type != SPA_TYPE_Rectangle)
-				goto have_size;
-
-			values = SPA_POD_BODY_CONST(val);
-
-			if (choice == SPA_CHOICE_Range && n_values > 2) {
-				if (filter_framesize(&port->frmsize, &values[1], &values[2], &step))
-					goto have_size;
-			} else if (choice == SPA_CHOICE_Step && n_values > 3) {
-				if (filter_framesize(&port->frmsize, &values[1], &values[2], &values[3]))
-					goto have_size;
-			} else if (choice == SPA_CHOICE_Enum) {
-				for (i = 1; i < n_values; i++) {
-					if (filter_framesize(&port->frmsize, &values[i], &values[i], &step))
-						goto have_size;
-				}
-			}
-			/* nothing matches the filter, get next frame size */
-			port->frmsize.index++;
+	if (filter == NULL ||
+	    (p = spa_pod_find_prop(param, NULL, SPA_FORMAT_VIDEO_size)) == NULL ||
+	    (fp = spa_pod_find_prop(filter, NULL, SPA_FORMAT_VIDEO_size)) == NULL)
+		return param;
+
+	val = spa_pod_get_values(&p->value, &n_vals, &choice);
+	fval = spa_pod_get_values(&fp->value, &n_fvals, &fchoice);
+	if (choice != SPA_CHOICE_Step || n_vals < 4 ||
+	    (fchoice != SPA_CHOICE_None && fchoice != SPA_CHOICE_Enum) ||
+	    fval->type != SPA_TYPE_Rectangle)
+		return param;
+
+	sizes = SPA_POD_BODY_CONST(val);
+	fsizes = SPA_POD_BODY_CONST(fval);
+
+	spa_pod_builder_push_object(b, &f[0], obj->body.type, obj->body.id);
+	SPA_POD_OBJECT_FOREACH(obj, p) {
+		if (p->key != SPA_FORMAT_VIDEO_size) {
+			spa_pod_builder_raw_padded(b, p, SPA_POD_PROP_SIZE(p));
 			continue;
 		}
-
-	      have_size:
-		if (port->frmsize.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
-			/* we have a fixed size, use this to get the frame intervals */
-			port->frmival.index = 0;
-			port->frmival.pixel_format = port->frmsize.pixel_format;
-			port->frmival.width = port->frmsize.discrete.width;
-			port->frmival.height = port->frmsize.discrete.height;
-			port->next_frmsize = false;
-		} else if (port->frmsize.type == V4L2_FRMSIZE_TYPE_CONTINUOUS ||
-			   port->frmsize.type == V4L2_FRMSIZE_TYPE_STEPWISE) {
-			/* we have a non fixed size, fix to something sensible to get the
-			 * framerate */
-			port->frmival.index = 0;
-			port->frmival.pixel_format = port->frmsize.pixel_format;
-			port->frmival.width = port->frmsize.stepwise.min_width;
-			port->frmival.height = port->frmsize.stepwise.min_height;
-			port->next_frmsize = false;
-		} else {
-			port->frmsize.index++;
+		spa_pod_builder_prop(b, p->key, p->flags);
+		spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_Enum, 0);
+		/* for an Enum filter, skip its default, it is also in the list */
+		for (i = fchoice == SPA_CHOICE_Enum ? 1 : 0; i < n_fvals; i++) {
+			if (!size_in_step(&fsizes[i], &sizes[1], &sizes[2], &sizes[3]))
+				continue;
+			if (n_match++ == 0)
+				spa_pod_builder_rectangle(b, fsizes[i].width, fsizes[i].height);
+			spa_pod_builder_rectangle(b, fsizes[i].width, fsizes[i].height);
 		}
+		spa_pod_builder_pop(b, &f[1]);
 	}
+	param = spa_pod_builder_pop(b, &f[0]);
 
-	spa_pod_builder_init(&b, buffer, sizeof(buffer));
-	spa_pod_builder_push_object(&b, &f[0], SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
-	spa_pod_builder_add(&b,
-			SPA_FORMAT_mediaType,    SPA_POD_Id(info->media_type),
-			SPA_FORMAT_mediaSubtype, SPA_POD_Id(info->media_subtype),
-			0);
-
-	if (info->media_subtype == SPA_MEDIA_SUBTYPE_raw) {
-		spa_pod_builder_prop(&b, SPA_FORMAT_VIDEO_format, 0);
-		spa_pod_builder_id(&b, info->format);
-	}
-	spa_pod_builder_prop(&b, SPA_FORMAT_VIDEO_size, 0);
-	spa_pod_builder_rectangle(&b, port->frmsize.discrete.width, port->frmsize.discrete.height);
-
-	spa_pod_builder_prop(&b, SPA_FORMAT_VIDEO_framerate, 0);
-
-	n_fractions = 0;
-
-	spa_pod_builder_push_choice(&b, &f[1], SPA_CHOICE_None, 0);
-	choice = (struct spa_pod_choice*)spa_pod_builder_frame(&b, &f[1]);
-	port->frmival.index = 0;
-
-	while (true) {
-		if ((res = xioctl(dev->fd, VIDIOC_ENUM_FRAMEINTERVALS, &port->frmival)) < 0) {
-			res = -errno;
-			if (errno == EINVAL) {
-				port->frmsize.index++;
-				port->next_frmsize = true;
-				if (port->frmival.index == 0)
-					goto next_frmsize;
-				break;
-			}
-			spa_log_error(this->log, "v4l2: '%s' VIDIOC_ENUM_FRAMEINTERVALS: %m",
-					this->props.device);
-			goto exit;
-		}
-		if (filter) {
-			const struct spa_pod_prop *p;
-			struct spa_pod *val;
-			uint32_t i, n_values, choice;
-			const struct spa_fraction step = { 1, 1 }, *values;
-
-			if (!(p = spa_pod_find_prop(filter, NULL, SPA_FORMAT_VIDEO_framerate)))
-				goto have_framerate;
-
-			val = spa_pod_get_values(&p->value, &n_values, &choice);
-
-			if (val->type != SPA_TYPE_Fraction)
-				goto enum_end;
-
-			values = SPA_POD_BODY(val);
-
-			switch (choice) {
-			case SPA_CHOICE_None:
-				if (filter_framerate(&port->frmival, &values[0], &values[0], &step))
-					goto have_framerate;
-				break;
+	return n_match > 0 ? param : NULL;
+}
 
-			case SPA_CHOICE_Range:
-				if (n_values > 2 && filter_framerate(&port->frmival, &values[1], &values[2], &step))
-					goto have_framerate;
-				break;
+static int
+spa_v4l2_enum_format(struct impl *this, int seq,
+		     uint32_t start, uint32_t num,
+		     const struct spa_pod *filter)
+{
+	struct port *port = &this->out_ports[0];
+	struct spa_pod_builder b = { 0 }, sb = { 0 };
+	struct spa_result_node_params result;
+	const struct spa_pod *param;
+	uint8_t buffer[1024], sbuffer[1024];
+	uint32_t count = 0;
+	int res;
 
-			case SPA_CHOICE_Step:
-				if (n_values > 3 && filter_framerate(&port->frmival, &values[1], &values[2], &values[3]))
-					goto have_framerate;
-				break;
+	if (!port->enum_formats_valid &&
+	    (res = enum_formats_fill(this)) < 0)
+		return res;
 
-			case SPA_CHOICE_Enum:
-				for (i = 1; i < n_values; i++) {
-					if (filter_framerate(&port->frmival, &values[i], &values[i], &step))
-						goto have_framerate;
-				}
-				break;
-			default:
-				break;
-			}
-			port->frmival.index++;
-			continue;
-		}
+	result.id = SPA_PARAM_EnumFormat;
+	result.next = start;
 
-	      have_framerate:
+      next:
+	result.index = result.next++;
 
-		if (port->frmival.type == V4L2_FRMIVAL_TYPE_DISCRETE) {
-			choice->body.type = SPA_CHOICE_Enum;
-			if (n_fractions == 0)
-				spa_pod_builder_fraction(&b,
-							 port->frmival.discrete.denominator,
-							 port->frmival.discrete.numerator);
-			spa_pod_builder_fraction(&b,
-						 port->frmival.discrete.denominator,
-						 port->frmival.discrete.numerator);
-			port->frmival.index++;
-		} else if (port->frmival.type == V4L2_FRMIVAL_TYPE_CONTINUOUS ||
-			   port->frmival.type == V4L2_FRMIVAL_TYPE_STEPWISE) {
-			if (n_fractions == 0)
-				spa_pod_builder_fraction(&b, 25, 1);
-			spa_pod_builder_fraction(&b,
-						 port->frmival.stepwise.min.denominator,
-						 port->frmival.stepwise.min.numerator);
-			spa_pod_builder_fraction(&b,
-						 port->frmival.stepwise.max.denominator,
-						 port->frmival.stepwise.max.numerator);
-
-			if (port->frmival.type == V4L2_FRMIVAL_TYPE_CONTINUOUS) {
-				choice->body.type = SPA_CHOICE_Range;
-			} else {
-				choice->body.type = SPA_CHOICE_Step;
-				spa_pod_builder_fraction(&b,
-							 port->frmival.stepwise.step.denominator,
-							 port->frmival.stepwise.step.numerator);
-			}
+	if (result.index >= port->n_enum_formats)
+		return 0;
 
-			port->frmsize.index++;
-			port->next_frmsize = true;
-			break;
-		}
-		n_fractions++;
-	}
-	if (n_fractions <= 1)
-		choice->body.type = SPA_CHOICE_None;
+	spa_pod_builder_init(&sb, sbuffer, sizeof(sbuffer));
+	if ((param = filter_step_size(&sb, port->enum_formats[result.index], filter)) == NULL)
+		goto next;
 
-	spa_pod_builder_pop(&b, &f[1]);
-	result.param = spa_pod_builder_pop(&b, &f[0]);
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		goto next;
 
 	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
 
 	if (++count != num)
 		goto next;
 
-      enum_end:
-	res = 0;
-      exit:
-	spa_v4l2_close(dev);
-	return res;
+	return 0;
 }
 
 static int spa_v4l2_set_format(struct impl *this, struct spa_video_info *format, uint32_t flags)
@@ -1248,6 +1129,84 @@ static int mmap_read(struct impl *this)
 	return 0;
 }
 
+static int read_frame(struct impl *this)
+{
+	struct port *port = &this->out_ports[0];
+	struct spa_v4l2_device *dev = &port->dev;
+	struct buffer *b;
+	struct spa_data *d;
+	struct timespec now;
+	int64_t pts;
+	ssize_t len;
+
+	if (!spa_list_is_empty(&port->free)) {
+		b = spa_list_first(&port->free, struct buffer, link);
+	} else if (!spa_list_is_empty(&port->queue)) {
+		/* drop the oldest frame that was not consumed yet */
+		b = spa_list_first(&port->queue, struct buffer, link);
+	} else {
+		spa_log_trace(this->log, "v4l2 %p: out of buffers", this);
+		return -EPIPE;
+	}
+	d = b->outbuf->datas;
+
+	if ((len = read(dev->fd, b->ptr, d[0].maxsize)) < 0) {
+		if (errno != EAGAIN && errno != EINTR)
+			spa_log_error(this->log, "v4l2: '%s' read: %m", this->props.device);
+		return -errno;
+	}
+	spa_list_remove(&b->link);
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	pts = SPA_TIMESPEC_TO_NSEC(&now);
+	spa_log_trace(this->log, "v4l2 %p: have output %d", this, b->id);
+
+	if (this->clock) {
+		this->clock->nsec = pts;
+		this->clock->rate = port->rate;
+		this->clock->position = port->read_sequence;
+		this->clock->duration = 1;
+		this->clock->delay = 0;
+		this->clock->rate_diff = 1.0;
+		this->clock->next_nsec = pts + 1000000000LL / port->rate.denom;
+	}
+
+	if (b->h) {
+		b->h->flags = 0;
+		b->h->offset = 0;
+		b->h->seq = port->read_sequence;
+		b->h->pts = pts;
+		b->h->dts_offset = 0;
+	}
+	port->read_sequence++;
+
+	d[0].chunk->offset = 0;
+	d[0].chunk->size = len;
+	d[0].chunk->stride = port->fmt.fmt.pix.bytesperline;
+	d[0].chunk->flags = 0;
+
+	spa_list_append(&port->queue, &b->link);
+	return 0;
+}
+
+static void dequeue_events(struct impl *this)
+{
+	struct port *port = &this->out_ports[0];
+	struct v4l2_event ev;
+
+	while (true) {
+		spa_zero(ev);
+		if (xioctl(port->dev.fd, VIDIOC_DQEVENT, &ev) < 0)
+			break;
+		if (ev.type == V4L2_EVENT_SOURCE_CHANGE) {
+			spa_log_info(this->log, "v4l2: '%s' source changed",
+					this->props.device);
+			/* enumerate the formats again on the next EnumFormat */
+			port->enum_formats_valid = false;
+		}
+	}
+}
+
 static void v4l2_on_fd_events(struct spa_source *source)
 {
 	struct impl *this = source->data;
@@ -1263,12 +1222,16 @@ static void v4l2_on_fd_events(struct spa_source *source)
 		return;
 	}
 
+	if (source->rmask & SPA_IO_PRI)
+		dequeue_events(this);
+
 	if (!(source->rmask & SPA_IO_IN)) {
-		spa_log_warn(this->log, "v4l2 %p: spurious wakeup %d", this, source->rmask);
+		if (!(source->rmask & SPA_IO_PRI))
+			spa_log_warn(this->log, "v4l2 %p: spurious wakeup %d", this, source->rmask);
 		return;
 	}
 
-	if (mmap_read(this) < 0)
+	if ((port->use_read ? read_frame(this) : mmap_read(this)) < 0)
 		return;
 
 	if (spa_list_is_empty(&port->queue))
@@ -1511,14 +1474,176 @@ fallback:
 	return 0;
 }
 
-static int userptr_init(struct impl *this)
+static int memfd_buffer_init(struct impl *this, struct buffer *b, uint32_t size)
+{
+	struct port *port = &this->out_ports[0];
+	struct spa_data *d = b->outbuf->datas;
+	int fd;
+
+	fd = syscall(SYS_memfd_create, "v4l2-memfd", MFD_CLOEXEC);
+	if (fd < 0) {
+		spa_log_error(this->log, "v4l2: memfd_create: %m");
+		return -errno;
+	}
+	if (ftruncate(fd, size) < 0) {
+		spa_log_error(this->log, "v4l2: ftruncate: %m");
+		close(fd);
+		return -errno;
+	}
+	b->ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (b->ptr == MAP_FAILED) {
+		spa_log_error(this->log, "v4l2: mmap: %m");
+		close(fd);
+		return -errno;
+	}
+	SPA_FLAG_SET(b->flags, BUFFER_FLAG_ALLOCATED | BUFFER_FLAG_MAPPED);
+
+	d[0].type = SPA_DATA_MemFd;
+	d[0].flags = SPA_DATA_FLAG_READABLE;
+	d[0].fd = fd;
+	d[0].mapoffset = 0;
+	d[0].maxsize = size;
+	d[0].data = b->ptr;
+	d[0].chunk->offset = 0;
+	d[0].chunk->size = 0;
+	d[0].chunk->stride = port->fmt.fmt.pix.bytesperline;
+	d[0].chunk->flags = 0;
+
+	return 0;
+}
+
+static void buffer_init(struct buffer *b, uint32_t id, struct spa_buffer *buffer)
+{
+	b->id = id;
+	b->outbuf = buffer;
+	b->flags = BUFFER_FLAG_OUTSTANDING;
+	b->h = spa_buffer_find_meta_data(buffer, SPA_META_Header, sizeof(*b->h));
+}
+
+/* capture into memfd memory that we allocate and hand to the driver, the
+ * buffers can then be passed on without copying or mapping the device */
+static int userptr_init(struct impl *this,
+		struct spa_buffer **buffers, uint32_t n_buffers)
+{
+	struct port *port = &this->out_ports[0];
+	struct spa_v4l2_device *dev = &port->dev;
+	struct v4l2_requestbuffers reqbuf;
+	uint32_t i, size;
+	int res;
+
+	port->memtype = V4L2_MEMORY_USERPTR;
+
+	spa_zero(reqbuf);
+	reqbuf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	reqbuf.memory = port->memtype;
+	reqbuf.count = n_buffers;
+
+	if (xioctl(dev->fd, VIDIOC_REQBUFS, &reqbuf) < 0) {
+		spa_log_debug(this->log, "v4l2: '%s' VIDIOC_REQBUFS USERPTR: %m", this->props.device);
+		return -errno;
+	}
+
+	spa_log_debug(this->log, "v4l2: got %d buffers", reqbuf.count);
+	n_buffers = SPA_MIN(n_buffers, reqbuf.count);
+
+	if (n_buffers < 2) {
+		spa_log_error(this->log, "v4l2: '%s' can't allocate enough buffers (%d)",
+				this->props.device, n_buffers);
+		res = -ENOMEM;
+		goto error;
+	}
+
+	size = SPA_ROUND_UP_N(port->fmt.fmt.pix.sizeimage, 4096);
+
+	for (i = 0; i < n_buffers; i++) {
+		struct buffer *b = &port->buffers[i];
+
+		if (buffers[i]->n_datas < 1) {
+			spa_log_error(this->log, "v4l2: invalid buffer data");
+			res = -EINVAL;
+			goto error;
+		}
+		buffer_init(b, i, buffers[i]);
+
+		if ((res = memfd_buffer_init(this, b, size)) < 0)
+			goto error;
+		port->n_buffers = i + 1;
+
+		spa_zero(b->v4l2_buffer);
+		b->v4l2_buffer.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+		b->v4l2_buffer.memory = port->memtype;
+		b->v4l2_buffer.index = i;
+		b->v4l2_buffer.m.userptr = (unsigned long) b->ptr;
+		b->v4l2_buffer.length = size;
+
+		if ((res = spa_v4l2_buffer_recycle(this, i)) < 0)
+			goto error;
+	}
+	spa_log_info(this->log, "v4l2: have %u buffers using USERPTR", n_buffers);
+
+	return 0;
+
+error:
+	spa_v4l2_clear_buffers(this);
+	return res;
+}
+
+/* devices without streaming I/O, read() each frame into a memfd buffer */
+static int read_init(struct impl *this,
+		struct spa_buffer **buffers, uint32_t n_buffers)
 {
-	return -ENOTSUP;
+	struct port *port = &this->out_ports[0];
+	uint32_t i, size;
+	int res;
+
+	port->use_read = true;
+	port->read_sequence = 0;
+	spa_list_init(&port->free);
+
+	size = SPA_ROUND_UP_N(port->fmt.fmt.pix.sizeimage, 4096);
+
+	for (i = 0; i < n_buffers; i++) {
+		struct buffer *b = &port->buffers[i];
+
+		if (buffers[i]->n_datas < 1) {
+			spa_log_error(this->log, "v4l2: invalid buffer data");
+			res = -EINVAL;
+			goto error;
+		}
+		buffer_init(b, i, buffers[i]);
+
+		if ((res = memfd_buffer_init(this, b, size)) < 0)
+			goto error;
+		port->n_buffers = i + 1;
+
+		spa_v4l2_buffer_recycle(this, i);
+	}
+	spa_log_info(this->log, "v4l2: have %u buffers using read()", n_buffers);
+
+	return 0;
+
+error:
+	spa_v4l2_clear_buffers(this);
+	port->use_read = false;
+	return res;
 }
 
-static int read_init(struct impl *this)
+/* when the buffers can be passed on as memfd but not as dmabuf, capture
+ * into our own memfd with USERPTR instead of exposing the device mmap.
+ * Drivers can accept USERPTR buffers and still fail to stream into them,
+ * so this is only done when enabled for the device. */
+static bool prefer_userptr(struct port *port, struct spa_buffer **buffers, uint32_t n_buffers)
 {
-	return -ENOTSUP;
+	uint32_t types;
+
+	if (!port->use_userptr || n_buffers == 0 || buffers[0]->n_datas < 1)
+		return false;
+
+	types = buffers[0]->datas[0].type;
+	if (port->have_expbuf && (types & (1u << SPA_DATA_DmaBuf)))
+		return false;
+
+	return (types & (1u << SPA_DATA_MemFd)) != 0;
 }
 
 static int
@@ -1533,12 +1658,18 @@ spa_v4l2_alloc_buffers(struct impl *this,
 	if (port->n_buffers > 0)
 		return -EIO;
 
+	if (n_buffers > MAX_BUFFERS)
+		return -EINVAL;
+
 	if (dev->cap.capabilities & V4L2_CAP_STREAMING) {
+		if (prefer_userptr(port, buffers, n_buffers) &&
+		    userptr_init(this, buffers, n_buffers) == 0)
+			return 0;
 		if ((res = mmap_init(this, buffers, n_buffers)) < 0)
-			if ((res = userptr_init(this)) < 0)
+			if ((res = userptr_init(this, buffers, n_buffers)) < 0)
 				return res;
 	} else if (dev->cap.capabilities & V4L2_CAP_READWRITE) {
-		if ((res = read_init(this)) < 0)
+		if ((res = read_init(this, buffers, n_buffers)) < 0)
 			return res;
 	} else
 		return -EIO;
@@ -1564,15 +1695,26 @@ static int spa_v4l2_stream_on(struct impl *this)
 	spa_log_debug(this->log, "starting");
 
 	type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-	if (xioctl(dev->fd, VIDIOC_STREAMON, &type) < 0) {
+	if (!port->use_read &&
+	    xioctl(dev->fd, VIDIOC_STREAMON, &type) < 0) {
 		spa_log_error(this->log, "v4l2: '%s' VIDIOC_STREAMON: %m", this->props.device);
 		return -errno;
 	}
 
+	if (!port->use_read) {
+		struct v4l2_event_subscription sub;
+
+		spa_zero(sub);
+		sub.type = V4L2_EVENT_SOURCE_CHANGE;
+		port->have_events = xioctl(dev->fd, VIDIOC_SUBSCRIBE_EVENT, &sub) == 0;
+	}
+
 	port->source.func = v4l2_on_fd_events;
 	port->source.data = this;
 	port->source.fd = dev->fd;
 	port->source.mask = SPA_IO_IN | SPA_IO_ERR;
+	if (port->have_events)
+		port->source.mask |= SPA_IO_PRI;
 	port->source.rmask = 0;
 	spa_loop_add_source(this->data_loop, &port->source);
 
@@ -1612,18 +1754,22 @@ static int spa_v4l2_stream_off(struct impl *this)
 	spa_loop_invoke(this->data_loop, do_remove_source, 0, NULL, 0, true, port);
 
 	type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-	if (xioctl(dev->fd, VIDIOC_STREAMOFF, &type) < 0) {
+	if (!port->use_read &&
+	    xioctl(dev->fd, VIDIOC_STREAMOFF, &type) < 0) {
 		spa_log_error(this->log, "v4l2: '%s' VIDIOC_STREAMOFF: %m", this->props.device);
 		return -errno;
 	}
+	spa_list_init(&port->free);
 	for (i = 0; i < port->n_buffers; i++) {
 		struct buffer *b;
 
 		b = &port->buffers[i];
-		if (!SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_OUTSTANDING)) {
-			if (xioctl(dev->fd, VIDIOC_QBUF, &b->v4l2_buffer) < 0)
-				spa_log_warn(this->log, "VIDIOC_QBUF: %s", strerror(errno));
-		}
+		if (SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_OUTSTANDING))
+			continue;
+		if (port->use_read)
+			spa_list_append(&port->free, &b->link);
+		else if (xioctl(dev->fd, VIDIOC_QBUF, &b->v4l2_buffer) < 0)
+			spa_log_warn(this->log, "VIDIOC_QBUF: %s", strerror(errno));
 	}
 	spa_list_init(&port->queue);
 	dev->active = false;
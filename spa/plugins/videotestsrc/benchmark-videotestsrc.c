@@ -0,0 +1,132 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "config.h"
+
+#include <time.h>
+
+/* render frames directly, the timer and the graph are not measured */
+#include "videotestsrc.c"
+
+#define MAX_COUNT	200
+
+static const struct {
+	const char *name;
+	uint32_t width, height;
+} sizes[] = {
+	{ "720p", 1280, 720 },
+	{ "1080p", 1920, 1080 },
+	{ "4K", 3840, 2160 },
+};
+
+static const struct {
+	const char *name;
+	uint32_t format;
+} formats[] = {
+	{ "RGB", SPA_VIDEO_FORMAT_RGB },
+	{ "UYVY", SPA_VIDEO_FORMAT_UYVY },
+};
+
+static const struct {
+	const char *name;
+	uint32_t pattern;
+} patterns[] = {
+	{ "smpte-snow", PATTERN_SMPTE_SNOW },
+	{ "snow", PATTERN_SNOW },
+};
+
+static void run_test(struct impl *this, uint32_t width, uint32_t height, uint32_t format,
+		uint32_t pattern, const char *label)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_pod *param;
+	struct timespec ts;
+	uint64_t t1, t2, elapsed;
+	uint32_t i;
+	char *data;
+	int res;
+
+	param = spa_format_video_raw_build(&b, SPA_PARAM_Format,
+			&SPA_VIDEO_INFO_RAW_INIT(
+				.format = format,
+				.size = SPA_RECTANGLE(width, height),
+				.framerate = SPA_FRACTION(60, 1)));
+	res = port_set_format(this, &this->port, 0, param);
+	spa_assert(res >= 0);
+	this->props.pattern = pattern;
+
+	data = malloc(this->port.stride * height);
+	spa_assert(data != NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		res = draw(this, data);
+		spa_assert(res == 0);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+	elapsed = t2 - t1;
+
+	fprintf(stderr, "%s: elapsed %"PRIu64" count %u = %"PRIu64" nsec/frame %"PRIu64" fps\n",
+			label, elapsed, MAX_COUNT, elapsed / MAX_COUNT,
+			(uint64_t)(MAX_COUNT * SPA_NSEC_PER_SEC / SPA_MAX(elapsed, 1u)));
+
+	port_set_format(this, &this->port, 0, NULL);
+	free(data);
+}
+
+int main(int argc, char *argv[])
+{
+	struct impl *this;
+	uint32_t i, j, k;
+	char label[128];
+
+	this = calloc(1, sizeof(struct impl));
+	spa_assert(this != NULL);
+
+	spa_hook_list_init(&this->hooks);
+	reset_props(&this->props);
+	this->noise = 0x9e3779b97f4a7c15ULL;
+	this->port.info = SPA_PORT_INFO_INIT();
+	spa_list_init(&this->port.empty);
+
+	for (i = 0; i < SPA_N_ELEMENTS(sizes); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(formats); j++) {
+			for (k = 0; k < SPA_N_ELEMENTS(patterns); k++) {
+				snprintf(label, sizeof(label), "%s %s %s",
+						sizes[i].name, formats[j].name, patterns[k].name);
+				run_test(this, sizes[i].width, sizes[i].height,
+						formats[j].format, patterns[k].pattern, label);
+			}
+		}
+	}
+	free(this);
+
+	return 0;
+}
@@ -23,6 +23,9 @@
  */
 
 #include <errno.h>
+#include <endian.h>
+#include <stdlib.h>
+#include <string.h>
 
 typedef enum {
 	GRAY = 0,
@@ -73,6 +76,7 @@ static Pixel colors[N_COLORS] = {
 typedef struct _DrawingData DrawingData;
 
 typedef void (*DrawPixelFunc) (DrawingData * dd, int x, Pixel * pixel);
+typedef void (*DrawNoiseFunc) (DrawingData * dd, int x, int length);
 
 struct _DrawingData {
 	char *line;
@@ -80,6 +84,8 @@ struct _DrawingData {
 	int height;
 	int stride;
 	DrawPixelFunc draw_pixel;
+	DrawNoiseFunc draw_noise;
+	uint64_t *noise;
 };
 
 static inline void update_yuv(Pixel * pixel)
@@ -135,6 +141,86 @@ static void draw_pixel_uyvy(DrawingData * dd, int x, Pixel * color)
 	}
 }
 
+/* xorshift64, 8 random gray levels per call */
+static inline uint64_t noise_next(uint64_t *state)
+{
+	uint64_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return *state = x;
+}
+
+static void draw_noise_rgb(DrawingData * dd, int x, int length)
+{
+	uint8_t *p = (uint8_t *) dd->line + 3 * x;
+	uint64_t r, w[3];
+
+	/* 8 pixels at a time, assembled in 3 words of 8 bytes */
+	for (; length >= 8; length -= 8) {
+		r = noise_next(dd->noise);
+#define G(i)	((r >> (8 * (i))) & 0xff)
+		w[0] = G(0) * 0x010101ULL | G(1) * (0x010101ULL << 24) | G(2) * (0x0101ULL << 48);
+		w[1] = G(2) | G(3) * (0x010101ULL << 8) | G(4) * (0x010101ULL << 32) | G(5) << 56;
+		w[2] = G(5) * 0x0101ULL | G(6) * (0x010101ULL << 16) | G(7) * (0x010101ULL << 40);
+#undef G
+		w[0] = htole64(w[0]);
+		w[1] = htole64(w[1]);
+		w[2] = htole64(w[2]);
+		memcpy(p, w, sizeof(w));
+		p += sizeof(w);
+	}
+	if (length > 0) {
+		r = noise_next(dd->noise);
+		for (; length > 0; length--, r >>= 8) {
+			p[0] = p[1] = p[2] = r;
+			p += 3;
+		}
+	}
+}
+
+static void draw_noise_uyvy(DrawingData * dd, int x, int length)
+{
+	uint8_t *p;
+	uint64_t r, v;
+
+	if (length > 0 && (x & 1)) {
+		/* odd pixel, keep the chroma of the even pixel */
+		dd->line[2 * x + 1] = noise_next(dd->noise);
+		x++;
+		length--;
+	}
+	p = (uint8_t *) dd->line + 2 * x;
+
+	/* gray has U and V at 128, spread 4 random Y values over the
+	 * odd bytes of a 64 bit word for 4 pixels at a time */
+	for (; length >= 8; length -= 8) {
+		r = noise_next(dd->noise);
+
+		v = r & 0xffffffffu;
+		v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+		v = (v | (v << 8)) & 0x00ff00ff00ff00ffULL;
+		v = htole64((v << 8) | 0x0080008000800080ULL);
+		memcpy(p, &v, sizeof(v));
+
+		v = r >> 32;
+		v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+		v = (v | (v << 8)) & 0x00ff00ff00ff00ffULL;
+		v = htole64((v << 8) | 0x0080008000800080ULL);
+		memcpy(p + 8, &v, sizeof(v));
+
+		p += 16;
+	}
+	if (length > 0) {
+		r = noise_next(dd->noise);
+		for (; length > 0; length--, r >>= 8) {
+			p[0] = 128;
+			p[1] = r;
+			p += 2;
+		}
+	}
+}
+
 static int drawing_data_init(DrawingData * dd, struct impl *this, char *data)
 {
 	struct port *port = &this->port;
@@ -147,8 +233,10 @@ static int drawing_data_init(DrawingData * dd, struct impl *this, char *data)
 
 	if (format->info.raw.format == SPA_VIDEO_FORMAT_RGB) {
 		dd->draw_pixel = draw_pixel_rgb;
+		dd->draw_noise = draw_noise_rgb;
 	} else if (format->info.raw.format == SPA_VIDEO_FORMAT_UYVY) {
 		dd->draw_pixel = draw_pixel_uyvy;
+		dd->draw_noise = draw_noise_uyvy;
 	} else
 		return -ENOTSUP;
 
@@ -156,6 +244,7 @@ static int drawing_data_init(DrawingData * dd, struct impl *this, char *data)
 	dd->width = size->width;
 	dd->height = size->height;
 	dd->stride = port->stride;
+	dd->noise = &this->noise;
 
 	return 0;
 }
@@ -174,92 +263,109 @@ static inline void next_line(DrawingData * dd)
 	dd->line += dd->stride;
 }
 
-static void draw_smpte_snow(DrawingData * dd)
+/* the three kinds of lines of the SMPTE pattern only depend on the
+ * format, render them once into port->rows and copy them for each frame */
+static int smpte_rows_init(struct impl *this)
+{
+	struct port *port = &this->port;
+	DrawingData dd;
+	int res, w, x, j;
+
+	free(port->rows);
+	port->rows = NULL;
+
+	init_colors();
+
+	if ((res = drawing_data_init(&dd, this, NULL)) < 0)
+		return res;
+
+	w = dd.width;
+	if ((port->rows = calloc(3, dd.stride)) == NULL)
+		return -errno;
+	dd.line = port->rows;
+
+	/* bars */
+	for (j = 0; j < 7; j++) {
+		int x1 = j * w / 7;
+		int x2 = (j + 1) * w / 7;
+		draw_pixels(&dd, x1, j, x2 - x1);
+	}
+	next_line(&dd);
+
+	/* castellations */
+	for (j = 0; j < 7; j++) {
+		int x1 = j * w / 7;
+		int x2 = (j + 1) * w / 7;
+		Color c = (j & 1) ? BLACK : BLUE - j;
+
+		draw_pixels(&dd, x1, c, x2 - x1);
+	}
+	next_line(&dd);
+
+	x = 0;
+
+	/* negative I */
+	draw_pixels(&dd, x, NEG_I, w / 6);
+	x += w / 6;
+
+	/* white */
+	draw_pixels(&dd, x, WHITE, w / 6);
+	x += w / 6;
+
+	/* positive Q */
+	draw_pixels(&dd, x, POS_Q, w / 6);
+	x += w / 6;
+
+	/* pluge */
+	draw_pixels(&dd, x, DARK_BLACK, w / 12);
+	x += w / 12;
+	draw_pixels(&dd, x, BLACK, w / 12);
+	x += w / 12;
+	draw_pixels(&dd, x, LIGHT_BLACK, w / 12);
+	x += w / 12;
+
+	port->snow_x = x;
+
+	return 0;
+}
+
+static void draw_smpte_snow(DrawingData * dd, struct port *port)
 {
 	int h, w;
 	int y1, y2;
-	int i, j;
+	int i, size;
+	char *rows = port->rows;
 
 	w = dd->width;
 	h = dd->height;
 	y1 = 2 * h / 3;
 	y2 = 3 * h / 4;
+	size = dd->stride;
 
 	for (i = 0; i < y1; i++) {
-		for (j = 0; j < 7; j++) {
-			int x1 = j * w / 7;
-			int x2 = (j + 1) * w / 7;
-			draw_pixels(dd, x1, j, x2 - x1);
-		}
+		memcpy(dd->line, &rows[0], size);
 		next_line(dd);
 	}
 
 	for (i = y1; i < y2; i++) {
-		for (j = 0; j < 7; j++) {
-			int x1 = j * w / 7;
-			int x2 = (j + 1) * w / 7;
-			Color c = (j & 1) ? BLACK : BLUE - j;
-
-			draw_pixels(dd, x1, c, x2 - x1);
-		}
+		memcpy(dd->line, &rows[size], size);
 		next_line(dd);
 	}
 
 	for (i = y2; i < h; i++) {
-		int x = 0;
-
-		/* negative I */
-		draw_pixels(dd, x, NEG_I, w / 6);
-		x += w / 6;
-
-		/* white */
-		draw_pixels(dd, x, WHITE, w / 6);
-		x += w / 6;
-
-		/* positive Q */
-		draw_pixels(dd, x, POS_Q, w / 6);
-		x += w / 6;
-
-		/* pluge */
-		draw_pixels(dd, x, DARK_BLACK, w / 12);
-		x += w / 12;
-		draw_pixels(dd, x, BLACK, w / 12);
-		x += w / 12;
-		draw_pixels(dd, x, LIGHT_BLACK, w / 12);
-		x += w / 12;
-
 		/* war of the ants (a.k.a. snow) */
-		for (j = x; j < w; j++) {
-			Pixel p;
-			unsigned char r = rand();
-
-			p.R = r;
-			p.G = r;
-			p.B = r;
-			update_yuv(&p);
-			dd->draw_pixel(dd, j, &p);
-		}
-
+		memcpy(dd->line, &rows[2 * size], size);
+		dd->draw_noise(dd, port->snow_x, w - port->snow_x);
 		next_line(dd);
 	}
 }
 
 static void draw_snow(DrawingData * dd)
 {
-	int x, y;
+	int y;
 
 	for (y = 0; y < dd->height; y++) {
-		for (x = 0; x < dd->width; x++) {
-			Pixel p;
-			unsigned char r = rand();
-
-			p.R = r;
-			p.G = r;
-			p.B = r;
-			update_yuv(&p);
-			dd->draw_pixel(dd, x, &p);
-		}
-
+		dd->draw_noise(dd, 0, dd->width);
 		next_line(dd);
 	}
 }
@@ -276,7 +382,9 @@ static int draw(struct impl *this, char *data)
 
 	switch (this->props.pattern) {
 	case PATTERN_SMPTE_SNOW:
-		draw_smpte_snow(&dd);
+		if (this->port.rows == NULL)
+			return -EIO;
+		draw_smpte_snow(&dd, &this->port);
 		break;
 	case PATTERN_SNOW:
 		draw_snow(&dd);
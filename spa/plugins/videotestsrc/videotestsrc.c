@@ -87,6 +87,8 @@ struct port {
 	struct spa_video_info current_format;
 	size_t bpp;
 	int stride;
+	char *rows;
+	int snow_x;
 
 	struct buffer buffers[MAX_BUFFERS];
 	uint32_t n_buffers;
@@ -119,6 +121,7 @@ struct impl {
 	uint64_t elapsed_time;
 
 	uint64_t frame_count;
+	uint64_t noise;
 
 	struct port port;
 };
@@ -620,6 +623,8 @@ static int port_set_format(struct impl *this, struct port *port,
 	if (format == NULL) {
 		port->have_format = false;
 		clear_buffers(this, port);
+		free(port->rows);
+		port->rows = NULL;
 	} else {
 		struct spa_video_info info = { 0 };
 
@@ -648,6 +653,8 @@ static int port_set_format(struct impl *this, struct port *port,
 	if (port->have_format) {
 		struct spa_video_info_raw *raw_info = &port->current_format.info.raw;
 		port->stride = SPA_ROUND_UP_N(port->bpp * raw_info->size.width, 4);
+		if ((res = smpte_rows_init(this)) < 0)
+			return res;
 		port->params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_READWRITE);
 		port->params[4] = SPA_PARAM_INFO(SPA_PARAM_Buffers, SPA_PARAM_INFO_READ);
 	} else {
@@ -844,6 +851,8 @@ static int impl_clear(struct spa_handle *handle)
 
 	this = (struct impl *) handle;
 
+	free(this->port.rows);
+
 	if (this->data_loop)
 		spa_loop_remove_source(this->data_loop, &this->timer_source);
 	spa_system_close(this->data_system, this->timer_source.fd);
@@ -898,6 +907,7 @@ impl_init(const struct spa_handle_factory *factory,
 	this->info.params = this->params;
 	this->info.n_params = 2;
 	reset_props(&this->props);
+	this->noise = 0x9e3779b97f4a7c15ULL;
 
 	this->timer_source.func = on_output;
 	this->timer_source.data = this;
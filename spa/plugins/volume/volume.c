@@ -25,6 +25,7 @@
 #include <errno.h>
 #include <string.h>
 #include <stddef.h>
+#include <math.h>
 
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
@@ -40,6 +41,7 @@
 
 #define DEFAULT_VOLUME 1.0
 #define DEFAULT_MUTE false
+#define MIN_RAMP_VOLUME 0.00001
 
 struct props {
 	double volume;
@@ -100,6 +102,15 @@ struct impl {
 	struct spa_audio_info current_format;
 	int bpf;
 
+	struct {
+		uint32_t scale;
+		uint32_t samples;
+		uint32_t pos;
+		double start;
+		double end;
+		double gain;		/* gain of the next frame */
+	} ramp;
+
 	struct port in_ports[1];
 	struct port out_ports[1];
 
@@ -201,15 +212,36 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 	case SPA_PARAM_Props:
 	{
 		struct props *p = &this->props;
+		float volume = p->volume;
+		int32_t ramp_samples = 0;
+		uint32_t ramp_scale = SPA_PROP_VOLUME_RAMP_LINEAR;
 
 		if (param == NULL) {
 			reset_props(p);
+			this->ramp.samples = 0;
 			return 0;
 		}
 		spa_pod_parse_object(param,
 			SPA_TYPE_OBJECT_Props, NULL,
-			SPA_PROP_volume, SPA_POD_OPT_Float(&p->volume),
-			SPA_PROP_mute,   SPA_POD_OPT_Bool(&p->mute));
+			SPA_PROP_volume, SPA_POD_OPT_Float(&volume),
+			SPA_PROP_mute,   SPA_POD_OPT_Bool(&p->mute),
+			SPA_PROP_volumeRampSamples, SPA_POD_OPT_Int(&ramp_samples),
+			SPA_PROP_volumeRampScale, SPA_POD_OPT_Id(&ramp_scale));
+
+		if (ramp_samples > 0 && ramp_scale != SPA_PROP_VOLUME_RAMP_NONE &&
+		    volume != p->volume) {
+			/* continue from the current gain when a ramp is running */
+			this->ramp.start = this->ramp.pos < this->ramp.samples ?
+				this->ramp.gain : p->volume;
+			this->ramp.end = volume;
+			this->ramp.gain = this->ramp.start;
+			this->ramp.samples = ramp_samples;
+			this->ramp.scale = ramp_scale;
+			this->ramp.pos = 0;
+		} else {
+			this->ramp.samples = 0;
+		}
+		p->volume = volume;
 		break;
 	}
 	default:
@@ -621,6 +653,36 @@ static struct buffer *find_free_buffer(struct impl *this, struct port *port)
 	return b;
 }
 
+/* render a part of the volume ramp, one gain per frame */
+static uint32_t do_ramp(struct impl *this, int16_t *dst, const int16_t *src, uint32_t n_samples)
+{
+	uint32_t i, j, n_frames, channels = this->bpf / sizeof(int16_t);
+	double gain = this->ramp.gain, step, s, e;
+
+	n_frames = SPA_MIN(n_samples / channels, this->ramp.samples - this->ramp.pos);
+
+	s = this->ramp.start;
+	e = this->ramp.end;
+	if (this->ramp.scale == SPA_PROP_VOLUME_RAMP_EXPONENTIAL) {
+		s = SPA_MAX(s, MIN_RAMP_VOLUME);
+		e = SPA_MAX(e, MIN_RAMP_VOLUME);
+		step = pow(e / s, 1.0 / this->ramp.samples);
+		gain = SPA_MAX(gain, MIN_RAMP_VOLUME);
+		for (i = 0; i < n_frames; i++, gain *= step)
+			for (j = 0; j < channels; j++)
+				*dst++ = *src++ * gain;
+	} else {
+		step = (e - s) / this->ramp.samples;
+		for (i = 0; i < n_frames; i++, gain += step)
+			for (j = 0; j < channels; j++)
+				*dst++ = *src++ * gain;
+	}
+	this->ramp.pos += n_frames;
+	this->ramp.gain = this->ramp.pos < this->ramp.samples ? gain : this->ramp.end;
+
+	return n_frames * channels;
+}
+
 static void do_volume(struct impl *this, struct spa_buffer *dbuf, struct spa_buffer *sbuf)
 {
 	uint32_t i, n_samples, n_bytes;
@@ -655,7 +717,10 @@ static void do_volume(struct impl *this, struct spa_buffer *dbuf, struct spa_buf
 		n_bytes = SPA_MIN(n_bytes, dd[0].maxsize - doffset);
 
 		n_samples = n_bytes / sizeof(int16_t);
-		for (i = 0; i < n_samples; i++)
+		i = 0;
+		if (this->ramp.pos < this->ramp.samples)
+			i = do_ramp(this, dst, src, n_samples);
+		for (; i < n_samples; i++)
 			dst[i] = src[i] * volume;
 
 		sindex += n_bytes;
@@ -0,0 +1,242 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+
+#include <spa/utils/json.h>
+
+#define MAX_COUNT	20
+#define CONF_MODULES	2000
+#define DUMP_OBJECTS	2000
+
+struct counts {
+	uint32_t tokens;
+	uint32_t numbers;
+	double sum;
+};
+
+typedef int (*parse_float_t) (const char *val, int len, float *result);
+typedef int (*parse_int_t) (const char *val, int len, int *result);
+
+/* what the number parsing used to be */
+static int strtof_parse_float(const char *val, int len, float *result)
+{
+	char *end;
+	*result = strtof(val, &end);
+	return end == val + len;
+}
+
+static int strtol_parse_int(const char *val, int len, int *result)
+{
+	char *end;
+	*result = strtol(val, &end, 0);
+	return end == val + len;
+}
+
+static char *gen_conf(uint32_t n_modules)
+{
+	size_t size = 1024 + n_modules * 512, used = 0;
+	char *str = malloc(size);
+	uint32_t i;
+
+	assert(str != NULL);
+	used += snprintf(str + used, size - used,
+			"context.properties = {\n"
+			"    default.clock.rate = 48000\n"
+			"    default.clock.quantum = 1024\n"
+			"    default.clock.min-quantum = 32\n"
+			"    default.clock.max-quantum = 8192\n"
+			"    default.video.width = 640\n"
+			"    default.video.height = 480\n"
+			"}\n"
+			"context.modules = [\n");
+	for (i = 0; i < n_modules; i++) {
+		used += snprintf(str + used, size - used,
+			"    # module %u\n"
+			"    { name = libpipewire-module-filter-chain-%u\n"
+			"        args = {\n"
+			"            node.latency = %u/48000 audio.rate = 48000\n"
+			"            filter.graph = { nodes = [ { type = builtin label = bq_peaking\n"
+			"                control = { \"Freq\" = %u.5 \"Q\" = 0.707 \"Gain\" = -%u.25 } } ] }\n"
+			"            capture.props = { audio.position = [ FL FR ] }\n"
+			"        }\n"
+			"        flags = [ ifexists nofail ]\n"
+			"    }\n", i, i, 256 << (i % 3), 100 + i, i % 12);
+	}
+	snprintf(str + used, size - used, "]\n");
+	return str;
+}
+
+static char *gen_dump(uint32_t n_objects)
+{
+	size_t size = 16 + n_objects * 1024, used = 0;
+	char *str = malloc(size);
+	uint32_t i;
+
+	assert(str != NULL);
+	used += snprintf(str + used, size - used, "[\n");
+	for (i = 0; i < n_objects; i++) {
+		used += snprintf(str + used, size - used,
+			"  {\n"
+			"    \"id\": %u,\n"
+			"    \"type\": \"PipeWire:Interface:Node\",\n"
+			"    \"version\": 3,\n"
+			"    \"permissions\": [ \"r\", \"w\", \"x\", \"m\" ],\n"
+			"    \"info\": {\n"
+			"      \"max-input-ports\": 64,\n"
+			"      \"max-output-ports\": 64,\n"
+			"      \"state\": \"suspended\",\n"
+			"      \"props\": {\n"
+			"        \"node.name\": \"node-%u\",\n"
+			"        \"object.id\": %u,\n"
+			"        \"priority.session\": %u,\n"
+			"        \"node.latency\": \"1024/48000\"\n"
+			"      },\n"
+			"      \"params\": {\n"
+			"        \"Props\": [ { \"volume\": %u.%02u, \"mute\": false,\n"
+			"          \"channelVolumes\": [ 0.5, 0.75, 1.0, 0.25 ],\n"
+			"          \"softVolumes\": [ 1.000000, 1.000000 ] } ],\n"
+			"        \"EnumFormat\": [ { \"mediaType\": \"audio\", \"rate\": 48000,\n"
+			"          \"channels\": 2, \"position\": [ \"FL\", \"FR\" ] } ]\n"
+			"      }\n"
+			"    }\n"
+			"  },\n", i + 30, i, i + 30, 1000 + i, i % 2, i % 100);
+	}
+	snprintf(str + used, size - used, "]\n");
+	return str;
+}
+
+static void walk(struct spa_json *iter, struct counts *c,
+		parse_float_t parse_float, parse_int_t parse_int)
+{
+	struct spa_json sub;
+	const char *value;
+	float f;
+	int len, v;
+
+	while ((len = spa_json_next(iter, &value)) > 0) {
+		c->tokens++;
+		if (spa_json_is_container(value, len)) {
+			spa_json_enter(iter, &sub);
+			walk(&sub, c, parse_float, parse_int);
+		} else if (memchr(value, '.', len) != NULL) {
+			if (parse_float(value, len, &f) > 0) {
+				c->numbers++;
+				c->sum += f;
+			}
+		} else if (parse_int(value, len, &v) > 0) {
+			c->numbers++;
+			c->sum += v;
+		}
+	}
+}
+
+/* find the end of all the values at the top level without looking into
+ * the containers, as a lookup of a config section would */
+static uint32_t skip(struct spa_json *iter,
+		int (*container_len) (struct spa_json *iter, const char *value, int len))
+{
+	const char *value;
+	uint32_t total = 0;
+	int len;
+
+	while ((len = spa_json_next(iter, &value)) > 0) {
+		if (spa_json_is_container(value, len))
+			len = container_len(iter, value, len);
+		total += len;
+	}
+	return total;
+}
+
+static uint64_t now_nsec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void test_walk(const char *name, const char *str,
+		const char *method, parse_float_t parse_float, parse_int_t parse_int)
+{
+	struct spa_json it;
+	struct counts c;
+	uint64_t t1, t2;
+	uint32_t i;
+
+	t1 = now_nsec();
+	for (i = 0; i < MAX_COUNT; i++) {
+		spa_zero(c);
+		spa_json_init(&it, str, strlen(str));
+		walk(&it, &c, parse_float, parse_int);
+	}
+	t2 = now_nsec();
+
+	fprintf(stderr, "%s walk %s: tokens %u numbers %u (sum %.2f) elapsed %"PRIu64" = %"PRIu64" nsec/walk\n",
+			name, method, c.tokens, c.numbers, c.sum, t2 - t1, (t2 - t1) / MAX_COUNT);
+}
+
+static void test_skip(const char *name, const char *str, const char *method,
+		int (*container_len) (struct spa_json *iter, const char *value, int len))
+{
+	struct spa_json it;
+	uint64_t t1, t2;
+	uint32_t i, total = 0;
+
+	t1 = now_nsec();
+	for (i = 0; i < MAX_COUNT; i++) {
+		spa_json_init(&it, str, strlen(str));
+		total = skip(&it, container_len);
+	}
+	t2 = now_nsec();
+
+	fprintf(stderr, "%s skip %s: bytes %u elapsed %"PRIu64" = %"PRIu64" nsec/skip\n",
+			name, method, total, t2 - t1, (t2 - t1) / MAX_COUNT);
+}
+
+static void run(const char *name, const char *str)
+{
+	test_walk(name, str, "strtof", strtof_parse_float, strtol_parse_int);
+	test_walk(name, str, "spa_json", spa_json_parse_float, spa_json_parse_int);
+	test_skip(name, str, "spa_json", spa_json_container_len);
+}
+
+int main(int argc, char *argv[])
+{
+	char *conf, *dump;
+
+	conf = gen_conf(CONF_MODULES);
+	dump = gen_dump(DUMP_OBJECTS);
+
+	run("config", conf);
+	run("dump", dump);
+
+	free(conf);
+	free(dump);
+
+	return 0;
+}
@@ -22,6 +22,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <locale.h>
+
 #include <spa/utils/defs.h>
 #include <spa/utils/json.h>
 
@@ -149,6 +151,92 @@ static void test_parse(void)
 	expect_float(&it[3], 1.9f);
 }
 
+static void test_numbers(void)
+{
+	static const char *floats[] = {
+		"0", "-0", "1", "+2.8", "-1.8", "1.9", "5.", ".5", "-.25", "3.14159",
+		"16777216", "16777217", "123456789", "1e10", "1.5e-7", "2E+3",
+		"0.1e-10", "1234567890123456789012", "1e40", "0x10", "inf", "nan",
+	};
+	static const char *bad_floats[] = { "-", ".", "1e", "1e+", "1.2.3", "abc", "1,5" };
+	static const char *ints[] = {
+		"0", "-0", "7", "+5", "-12", "123456789", "1234567890", "-2147483648",
+		"0x10", "010", "007",
+	};
+	static const char *bad_ints[] = { "-", "1.5", "1e3", "12a", "0x" };
+	uint32_t i;
+	float f;
+	int v;
+	char *end;
+
+	/* the fast path must give the same result as strtof/strtol */
+	for (i = 0; i < SPA_N_ELEMENTS(floats); i++) {
+		float expected = strtof(floats[i], &end);
+		spa_assert(spa_json_parse_float(floats[i], strlen(floats[i]), &f) == 1);
+		spa_assert(memcmp(&f, &expected, sizeof(f)) == 0);
+	}
+	for (i = 0; i < SPA_N_ELEMENTS(bad_floats); i++)
+		spa_assert(spa_json_parse_float(bad_floats[i], strlen(bad_floats[i]), &f) == 0);
+
+	for (i = 0; i < SPA_N_ELEMENTS(ints); i++) {
+		spa_assert(spa_json_parse_int(ints[i], strlen(ints[i]), &v) == 1);
+		spa_assert(v == (int)strtol(ints[i], &end, 0));
+	}
+	for (i = 0; i < SPA_N_ELEMENTS(bad_ints); i++)
+		spa_assert(spa_json_parse_int(bad_ints[i], strlen(bad_ints[i]), &v) == 0);
+
+	/* only the token is parsed, not what follows it */
+	spa_assert(spa_json_parse_float("1.5,2", 3, &f) == 1);
+	spa_assert(f == 1.5f);
+	spa_assert(spa_json_parse_int("42}", 2, &v) == 1);
+	spa_assert(v == 42);
+
+	/* a ',' decimal point in the locale does not change the result */
+	if (setlocale(LC_NUMERIC, "de_DE.UTF-8") != NULL) {
+		spa_assert(spa_json_parse_float("1.5", 3, &f) == 1);
+		spa_assert(f == 1.5f);
+		spa_assert(spa_json_parse_float("1.00000001e-20", 14, &f) == 1);
+		spa_assert(f == 1.00000001e-20f);
+		spa_assert(spa_json_parse_float("1,5", 3, &f) == 0);
+		setlocale(LC_NUMERIC, "C");
+	}
+}
+
+static void test_container_len(void)
+{
+	struct spa_json it[2];
+	const char *arr = "[ 1, \"]}\\\"\", # ] }\n { \"b\": [] }, a#b, c\"d ]";
+	const char *json, *value;
+	char buf[256];
+	int len;
+
+	snprintf(buf, sizeof(buf), "{ \"a\": %s, \"c\": { \"d\": 2 } }", arr);
+	json = buf;
+
+	spa_json_init(&it[0], json, strlen(json));
+	spa_assert(spa_json_enter_object(&it[0], &it[1]) > 0);
+	expect_string(&it[1], "a");
+	spa_assert((len = spa_json_next(&it[1], &value)) > 0);
+	spa_assert(spa_json_is_array(value, len));
+	len = spa_json_container_len(&it[1], value, len);
+	spa_assert(len == (int)strlen(arr));
+	spa_assert(strncmp(value, arr, len) == 0);
+
+	/* the iterator continues after the container */
+	expect_string(&it[1], "c");
+	spa_assert((len = spa_json_next(&it[1], &value)) > 0);
+	len = spa_json_container_len(&it[1], value, len);
+	spa_assert(strncmp(value, "{ \"d\": 2 }", len) == 0);
+	spa_assert(spa_json_next(&it[1], &value) == 0);
+
+	/* a container that is not closed goes up to the end */
+	json = "[ 1, [ 2, \"]\" ";
+	spa_json_init(&it[0], json, strlen(json));
+	spa_assert((len = spa_json_next(&it[0], &value)) > 0);
+	len = spa_json_container_len(&it[0], value, len);
+	spa_assert(len == (int)strlen(json));
+}
+
 static void test_encode(void)
 {
 	char dst[1024];
@@ -168,6 +256,8 @@ int main(int argc, char *argv[])
 {
 	test_abi();
 	test_parse();
+	test_numbers();
+	test_container_len();
 	test_encode();
 	return 0;
 }
@@ -65,6 +65,14 @@ GST_DEBUG_CATEGORY_STATIC (pipewire_src_debug);
 #define DEFAULT_RESEND_LAST     false
 #define DEFAULT_KEEPALIVE_TIME  0
 
+/* the status word, the stream state is stored + 1 because the error state
+ * is -1 */
+#define STATUS_STATE_MASK       0xff
+#define STATUS_EOS              (1 << 8)
+#define STATUS_FLUSHING         (1 << 9)
+#define STATUS_MAKE(state,flags) (((state) + 1) | (flags))
+#define STATUS_STATE(status)    ((enum pw_stream_state) (((status) & STATUS_STATE_MASK) - 1))
+
 enum
 {
   PROP_0,
@@ -248,6 +256,8 @@ gst_pipewire_src_finalize (GObject * object)
   g_free (pwsrc->path);
   g_free (pwsrc->client_name);
   g_object_unref(pwsrc->pool);
+  gst_poll_free (pwsrc->handoff);
+  g_mutex_clear (&pwsrc->ready_lock);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -394,6 +404,61 @@ gst_pipewire_src_init (GstPipeWireSrc * src)
   src->client_name = g_strdup(pw_get_client_name ());
 
   src->pool =  gst_pipewire_pool_new ();
+
+  src->status = STATUS_MAKE (PW_STREAM_STATE_UNCONNECTED, 0);
+  spa_ringbuffer_init (&src->ready);
+  g_mutex_init (&src->ready_lock);
+  src->handoff = gst_poll_new_timer ();
+}
+
+/* wake up the streaming thread after changing the state it waits on */
+static void
+handoff_signal (GstPipeWireSrc *pwsrc)
+{
+  gst_poll_write_control (pwsrc->handoff);
+}
+
+static void
+status_set_flag (GstPipeWireSrc *pwsrc, gint flag, gboolean set)
+{
+  if (set)
+    g_atomic_int_or ((guint *) &pwsrc->status, flag);
+  else
+    g_atomic_int_and ((guint *) &pwsrc->status, ~flag);
+  handoff_signal (pwsrc);
+}
+
+static void
+status_set_state (GstPipeWireSrc *pwsrc, enum pw_stream_state state)
+{
+  gint old;
+
+  do {
+    old = g_atomic_int_get (&pwsrc->status);
+  } while (!g_atomic_int_compare_and_exchange (&pwsrc->status, old,
+          STATUS_MAKE (state, old & ~STATUS_STATE_MASK)));
+  handoff_signal (pwsrc);
+}
+
+/* drop the buffers that were handed over but not picked up, optionally
+ * giving them back to the stream, which needs the thread loop lock */
+static void
+handoff_clear (GstPipeWireSrc *pwsrc, gboolean requeue)
+{
+  uint32_t index;
+  int32_t i, avail;
+
+  g_mutex_lock (&pwsrc->ready_lock);
+  avail = spa_ringbuffer_get_read_index (&pwsrc->ready, &index);
+  if (avail > 0) {
+    if (requeue && pwsrc->stream) {
+      for (i = 0; i < avail; i++)
+        pw_stream_queue_buffer (pwsrc->stream,
+            pwsrc->ready_buffers[(index + i) & (GST_PIPEWIRE_SRC_MAX_READY - 1)]);
+    }
+    spa_ringbuffer_read_update (&pwsrc->ready, index + avail);
+  }
+  g_mutex_unlock (&pwsrc->ready_lock);
 }
 
 static gboolean
@@ -441,11 +506,18 @@ on_remove_buffer (void *_data, struct pw_buffer *b)
 
   GST_DEBUG_OBJECT (pwsrc, "remove buffer %p", buf);
 
+  /* the stream removes all buffers at once, drop the ones that were
+   * not picked up yet */
+  handoff_clear (pwsrc, FALSE);
+
   GST_MINI_OBJECT_CAST (buf)->dispose = NULL;
 
   gst_buffer_unref (buf);
 }
 
+/* called from the streaming thread without the thread loop lock, take
+ * the next buffer that the data thread handed over. The stream can only
+ * remove its buffers while ready_lock is not held. */
 static GstBuffer *dequeue_buffer(GstPipeWireSrc *pwsrc)
 {
   struct pw_buffer *b;
@@ -453,11 +525,16 @@ static GstBuffer *dequeue_buffer(GstPipeWireSrc *pwsrc)
   GstPipeWirePoolData *data;
   struct spa_meta_header *h;
   struct spa_meta_region *crop;
+  uint32_t index;
   guint i;
 
-  b = pw_stream_dequeue_buffer (pwsrc->stream);
-  if (b == NULL)
-          return NULL;
+  g_mutex_lock (&pwsrc->ready_lock);
+  if (spa_ringbuffer_get_read_index (&pwsrc->ready, &index) <= 0) {
+    g_mutex_unlock (&pwsrc->ready_lock);
+    return NULL;
+  }
+  b = pwsrc->ready_buffers[index & (GST_PIPEWIRE_SRC_MAX_READY - 1)];
+  spa_ringbuffer_read_update (&pwsrc->ready, index + 1);
 
   data = b->user_data;
   buf = data->buf;
@@ -502,14 +579,32 @@ static GstBuffer *dequeue_buffer(GstPipeWireSrc *pwsrc)
     if (d->chunk->flags & SPA_CHUNK_FLAG_CORRUPTED)
       GST_BUFFER_FLAG_SET (buf, GST_BUFFER_FLAG_CORRUPTED);
   }
+  g_mutex_unlock (&pwsrc->ready_lock);
   return buf;
 }
 
+/* called from the data thread, only take the buffers from the stream and
+ * hand them to the streaming thread without locking */
 static void
 on_process (void *_data)
 {
   GstPipeWireSrc *pwsrc = _data;
-  pw_thread_loop_signal (pwsrc->core->loop, FALSE);
+  struct pw_buffer *b;
+  uint32_t index;
+  gboolean wakeup = FALSE;
+
+  while ((b = pw_stream_dequeue_buffer (pwsrc->stream)) != NULL) {
+    if (spa_ringbuffer_get_write_index (&pwsrc->ready, &index) >=
+        GST_PIPEWIRE_SRC_MAX_READY) {
+      pw_stream_queue_buffer (pwsrc->stream, b);
+      break;
+    }
+    pwsrc->ready_buffers[index & (GST_PIPEWIRE_SRC_MAX_READY - 1)] = b;
+    spa_ringbuffer_write_update (&pwsrc->ready, index + 1);
+    wakeup = TRUE;
+  }
+  if (wakeup)
+    handoff_signal (pwsrc);
 }
 
 static void
@@ -532,6 +627,7 @@ on_state_changed (void *data,
           ("stream error: %s", error), (NULL));
       break;
   }
+  status_set_state (pwsrc, state);
   pw_thread_loop_signal (pwsrc->core->loop, FALSE);
 }
 
@@ -687,7 +783,8 @@ gst_pipewire_src_negotiate (GstBaseSrc * basesrc)
   pw_stream_connect (pwsrc->stream,
                      PW_DIRECTION_INPUT,
                      pwsrc->path ? (uint32_t)atoi(pwsrc->path) : PW_ID_ANY,
-                     PW_STREAM_FLAG_AUTOCONNECT,
+                     PW_STREAM_FLAG_AUTOCONNECT |
+                     PW_STREAM_FLAG_RT_PROCESS,
                      (const struct spa_pod **)possible->pdata,
                      possible->len);
   g_ptr_array_free (possible, TRUE);
@@ -812,11 +909,8 @@ gst_pipewire_src_unlock (GstBaseSrc * basesrc)
 {
   GstPipeWireSrc *pwsrc = GST_PIPEWIRE_SRC (basesrc);
 
-  pw_thread_loop_lock (pwsrc->core->loop);
   GST_DEBUG_OBJECT (pwsrc, "setting flushing");
-  pwsrc->flushing = TRUE;
-  pw_thread_loop_signal (pwsrc->core->loop, FALSE);
-  pw_thread_loop_unlock (pwsrc->core->loop);
+  status_set_flag (pwsrc, STATUS_FLUSHING, TRUE);
 
   return TRUE;
 }
@@ -826,10 +920,8 @@ gst_pipewire_src_unlock_stop (GstBaseSrc * basesrc)
 {
   GstPipeWireSrc *pwsrc = GST_PIPEWIRE_SRC (basesrc);
 
-  pw_thread_loop_lock (pwsrc->core->loop);
   GST_DEBUG_OBJECT (pwsrc, "unsetting flushing");
-  pwsrc->flushing = FALSE;
-  pw_thread_loop_unlock (pwsrc->core->loop);
+  status_set_flag (pwsrc, STATUS_FLUSHING, FALSE);
 
   return TRUE;
 }
@@ -890,7 +982,6 @@ gst_pipewire_src_create (GstPushSrc * psrc, GstBuffer ** buffer)
 {
   GstPipeWireSrc *pwsrc;
   GstClockTime pts, dts, base_time;
-  const char *error = NULL;
   GstBuffer *buf;
   gboolean update_time = FALSE, timeout = FALSE;
 
@@ -899,24 +990,21 @@ gst_pipewire_src_create (GstPushSrc * psrc, GstBuffer ** buffer)
   if (!pwsrc->negotiated)
     goto not_negotiated;
 
-  pw_thread_loop_lock (pwsrc->core->loop);
+  /* last_buffer is only used by this thread while streaming */
   while (TRUE) {
-    enum pw_stream_state state;
+    gint status = g_atomic_int_get (&pwsrc->status);
+    enum pw_stream_state state = STATUS_STATE (status);
 
-    if (pwsrc->flushing)
+    if (status & STATUS_FLUSHING)
       goto streaming_stopped;
 
-    if (pwsrc->stream == NULL)
-      goto streaming_error;
-
-    state = pw_stream_get_state (pwsrc->stream, &error);
     if (state == PW_STREAM_STATE_ERROR)
       goto streaming_error;
 
     if (state != PW_STREAM_STATE_STREAMING)
       goto streaming_stopped;
 
-    if (pwsrc->eos) {
+    if (status & STATUS_EOS) {
       if (pwsrc->last_buffer == NULL)
         goto streaming_eos;
       buf = pwsrc->last_buffer;
@@ -941,17 +1029,15 @@ gst_pipewire_src_create (GstPushSrc * psrc, GstBuffer ** buffer)
       }
     }
     timeout = FALSE;
-    if (pwsrc->keepalive_time > 0) {
-      struct timespec abstime;
-      pw_thread_loop_get_time(pwsrc->core->loop, &abstime,
-		      pwsrc->keepalive_time * SPA_NSEC_PER_MSEC);
-      if (pw_thread_loop_timed_wait_full (pwsrc->core->loop, &abstime) == -ETIMEDOUT)
-        timeout = TRUE;
-    } else {
-      pw_thread_loop_wait (pwsrc->core->loop);
-    }
+
+    /* the data thread and all status changes write to the handoff
+     * control */
+    if (gst_poll_wait (pwsrc->handoff, pwsrc->keepalive_time > 0 ?
+            pwsrc->keepalive_time * GST_MSECOND : GST_CLOCK_TIME_NONE) == 0)
+      timeout = TRUE;
+    else
+      gst_poll_read_control (pwsrc->handoff);
   }
-  pw_thread_loop_unlock (pwsrc->core->loop);
 
   if (pwsrc->always_copy) {
     *buffer = gst_buffer_copy_deep (buf);
@@ -1000,17 +1086,14 @@ not_negotiated:
   }
 streaming_eos:
   {
-    pw_thread_loop_unlock (pwsrc->core->loop);
     return GST_FLOW_EOS;
   }
 streaming_error:
   {
-    pw_thread_loop_unlock (pwsrc->core->loop);
     return GST_FLOW_ERROR;
   }
 streaming_stopped:
   {
-    pw_thread_loop_unlock (pwsrc->core->loop);
     return GST_FLOW_FLUSHING;
   }
 }
@@ -1028,8 +1111,9 @@ gst_pipewire_src_stop (GstBaseSrc * basesrc)
 
   pwsrc = GST_PIPEWIRE_SRC (basesrc);
 
+  status_set_flag (pwsrc, STATUS_EOS, FALSE);
   pw_thread_loop_lock (pwsrc->core->loop);
-  pwsrc->eos = false;
+  handoff_clear (pwsrc, TRUE);
   gst_buffer_replace (&pwsrc->last_buffer, NULL);
   gst_caps_replace(&pwsrc->caps, NULL);
   pw_thread_loop_unlock (pwsrc->core->loop);
@@ -1135,6 +1219,7 @@ gst_pipewire_src_close (GstPipeWireSrc * pwsrc)
     pw_stream_destroy (pwsrc->stream);
     pwsrc->stream = NULL;
   }
+  status_set_state (pwsrc, PW_STREAM_STATE_UNCONNECTED);
   pw_thread_loop_unlock (pwsrc->core->loop);
 
   if (pwsrc->core) {
@@ -1152,10 +1237,7 @@ gst_pipewire_src_send_event (GstElement * elem, GstEvent * event)
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_EOS:
       GST_DEBUG_OBJECT (this, "got EOS");
-      pw_thread_loop_lock (this->core->loop);
-      this->eos = true;
-      pw_thread_loop_signal (this->core->loop, FALSE);
-      pw_thread_loop_unlock (this->core->loop);
+      status_set_flag (this, STATUS_EOS, TRUE);
       ret = TRUE;
       break;
     default:
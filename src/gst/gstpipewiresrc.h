@@ -28,6 +28,7 @@
 #include <gst/gst.h>
 #include <gst/base/gstpushsrc.h>
 
+#include <spa/utils/ringbuffer.h>
 #include <pipewire/pipewire.h>
 #include <gst/gstpipewirepool.h>
 #include <gst/gstpipewirecore.h>
@@ -47,6 +48,9 @@ G_BEGIN_DECLS
 #define GST_PIPEWIRE_SRC_CAST(obj) \
   ((GstPipeWireSrc *) (obj))
 
+/* a power of 2, at least the max number of buffers of a stream */
+#define GST_PIPEWIRE_SRC_MAX_READY 64
+
 typedef struct _GstPipeWireSrc GstPipeWireSrc;
 typedef struct _GstPipeWireSrcClass GstPipeWireSrcClass;
 
@@ -71,9 +75,11 @@ struct _GstPipeWireSrc {
   GstCaps *caps;
 
   gboolean negotiated;
-  gboolean flushing;
   gboolean started;
-  gboolean eos;
+
+  /* the stream state and the EOS and flushing flags in one word, so that
+   * the streaming thread can read them together without the loop lock */
+  gint status;
 
   gboolean is_live;
   GstClockTime min_latency;
@@ -87,6 +93,15 @@ struct _GstPipeWireSrc {
   struct pw_stream *stream;
   struct spa_hook stream_listener;
 
+  /* buffers from the process callback to the streaming thread, written
+   * by the data thread without locking. ready_lock is only taken by the
+   * readers: the streaming thread, and the main loop when the buffers
+   * are removed */
+  struct spa_ringbuffer ready;
+  struct pw_buffer *ready_buffers[GST_PIPEWIRE_SRC_MAX_READY];
+  GMutex ready_lock;
+  GstPoll *handoff;
+
   GstBuffer *last_buffer;
   GstStructure *properties;
 
@@ -49,11 +49,9 @@
 #define MAX_INPUTS	1024
 #define MAX_OUTPUTS	1024
 
-#define MAX_BUFFERS	64
 #define MAX_METAS	16u
 #define MAX_DATAS	64u
-#define MAX_AREAS	2048
-#define MAX_MIX		128
+#define AREAS_PER_BLOCK	512u
 
 #define CHECK_IN_PORT_ID(this,d,p)       ((d) == SPA_DIRECTION_INPUT && (p) < MAX_INPUTS)
 #define CHECK_OUT_PORT_ID(this,d,p)      ((d) == SPA_DIRECTION_OUTPUT && (p) < MAX_OUTPUTS)
@@ -84,7 +82,8 @@ struct mix {
 	uint32_t id;
 	struct port *port;
 	uint32_t n_buffers;
-	struct buffer buffers[MAX_BUFFERS];
+	uint32_t max_buffers;
+	struct buffer *buffers;
 };
 
 struct port {
@@ -146,7 +145,7 @@ struct impl {
 	struct node node;
 
 	struct pw_map io_map;
-	struct pw_memblock *io_areas;
+	struct pw_array io_areas;
 
 	struct pw_memblock *activation;
 
@@ -202,23 +201,13 @@ do_port_use_buffers(struct impl *impl,
 
 static struct mix *find_mix(struct port *p, uint32_t mix_id)
 {
-	struct mix *mix;
-	size_t len;
-
 	if (mix_id == SPA_ID_INVALID)
 		mix_id = 0;
 	else
 		mix_id++;
-	if (mix_id >= MAX_MIX)
+	if (mix_id >= pw_array_get_len(&p->mix, struct mix))
 		return NULL;
-	len = pw_array_get_len(&p->mix, struct mix);
-	if (mix_id >= len) {
-		size_t need = sizeof(struct mix) * (mix_id + 1 - len);
-		void *ptr = pw_array_add(&p->mix, need);
-		memset(ptr, 0, need);
-	}
-	mix = pw_array_get_unchecked(&p->mix, mix_id, struct mix);
-	return mix;
+	return pw_array_get_unchecked(&p->mix, mix_id, struct mix);
 }
 
 static void mix_init(struct mix *mix, struct port *p, uint32_t id)
@@ -232,9 +221,19 @@ static void mix_init(struct mix *mix, struct port *p, uint32_t id)
 static struct mix *ensure_mix(struct impl *impl, struct port *p, uint32_t mix_id)
 {
 	struct mix *mix;
+	size_t len;
+	uint32_t idx = mix_id == SPA_ID_INVALID ? 0 : mix_id + 1;
 
-	if ((mix = find_mix(p, mix_id)) == NULL)
-		return NULL;
+	/* the mix ids are allocated by the port, grow the array on demand */
+	len = pw_array_get_len(&p->mix, struct mix);
+	if (idx >= len) {
+		size_t need = sizeof(struct mix) * (idx + 1 - len);
+		void *ptr = pw_array_add(&p->mix, need);
+		if (ptr == NULL)
+			return NULL;
+		memset(ptr, 0, need);
+	}
+	mix = pw_array_get_unchecked(&p->mix, idx, struct mix);
 	if (mix->valid)
 		return mix;
 	mix_init(mix, p, mix_id);
@@ -292,11 +291,43 @@ static void mix_clear(struct node *this, struct mix *mix)
 {
 	struct port *port = mix->port;
 
-	if (!mix->valid)
-		return;
-	do_port_use_buffers(this->impl, port->direction, port->id,
-			mix->id, 0, NULL, 0);
+	if (mix->valid)
+		do_port_use_buffers(this->impl, port->direction, port->id,
+				mix->id, 0, NULL, 0);
 	mix->valid = false;
+	free(mix->buffers);
+	mix->buffers = NULL;
+	mix->max_buffers = 0;
+}
+
+static struct spa_io_buffers *ensure_io_area(struct impl *impl, uint32_t id)
+{
+	uint32_t index = id / AREAS_PER_BLOCK;
+	struct pw_memblock *mem, **blocks;
+
+	/* io areas are allocated one block at a time as mixes are added */
+	while (pw_array_get_len(&impl->io_areas, struct pw_memblock *) <= index) {
+		mem = pw_mempool_alloc(impl->context->pool,
+				PW_MEMBLOCK_FLAG_READWRITE |
+				PW_MEMBLOCK_FLAG_MAP |
+				PW_MEMBLOCK_FLAG_SEAL,
+				SPA_DATA_MemFd,
+				sizeof(struct spa_io_buffers) * AREAS_PER_BLOCK);
+		if (mem == NULL)
+			return NULL;
+
+		if ((blocks = pw_array_add(&impl->io_areas, sizeof(mem))) == NULL) {
+			pw_memblock_unref(mem);
+			return NULL;
+		}
+		*blocks = mem;
+		pw_log_debug(NAME " %p: io areas %d %p", impl, index, mem->map->ptr);
+	}
+	mem = *pw_array_get_unchecked(&impl->io_areas, index, struct pw_memblock *);
+
+	return SPA_MEMBER(mem->map->ptr,
+			(id % AREAS_PER_BLOCK) * sizeof(struct spa_io_buffers),
+			struct spa_io_buffers);
 }
 
 static int impl_node_enum_params(void *object, int seq,
@@ -748,6 +779,7 @@ do_port_use_buffers(struct impl *impl,
 	struct mix *mix;
 	uint32_t i, j;
 	struct pw_client_node_buffer *mb;
+	struct pw_memblock *mem = NULL;
 
 	if (!CHECK_PORT(this, direction, port_id))
 		return n_buffers == 0 ? 0 : -EINVAL;
@@ -766,6 +798,16 @@ do_port_use_buffers(struct impl *impl,
 
 	clear_buffers(this, mix);
 
+	if (n_buffers > mix->max_buffers) {
+		struct buffer *b;
+
+		b = reallocarray(mix->buffers, n_buffers, sizeof(struct buffer));
+		if (b == NULL)
+			return -errno;
+		mix->buffers = b;
+		mix->max_buffers = n_buffers;
+	}
+
 	if (n_buffers > 0) {
 		mb = alloca(n_buffers * sizeof(struct pw_client_node_buffer));
 	} else {
@@ -780,7 +822,7 @@ do_port_use_buffers(struct impl *impl,
 
 	for (i = 0; i < n_buffers; i++) {
 		struct buffer *b = &mix->buffers[i];
-		struct pw_memblock *mem, *m;
+		struct pw_memblock *m;
 		void *baseptr, *endptr;
 
 		b->outbuf = buffers[i];
@@ -795,7 +837,13 @@ do_port_use_buffers(struct impl *impl,
 		else
 			return -EINVAL;
 
-		if ((mem = pw_mempool_find_ptr(impl->context->pool, baseptr)) == NULL)
+		/* the buffers of a port are usually allocated in one block, only
+		 * look up the block when the buffer is not in the previous one */
+		if (mem == NULL || mem->map == NULL ||
+		    baseptr < mem->map->ptr ||
+		    baseptr >= SPA_MEMBER(mem->map->ptr, mem->map->size, void))
+			mem = pw_mempool_find_ptr(impl->context->pool, baseptr);
+		if (mem == NULL)
 			return -EINVAL;
 
 		endptr = SPA_MEMBER(baseptr, buffers[i]->n_datas * sizeof(struct spa_chunk), void);
@@ -803,9 +851,9 @@ do_port_use_buffers(struct impl *impl,
 			endptr = SPA_MEMBER(endptr, SPA_ROUND_UP_N(buffers[i]->metas[j].size, 8), void);
 		}
 		for (j = 0; j < buffers[i]->n_datas; j++) {
-			struct spa_data *d = buffers[i]->datas;
+			struct spa_data *d = &buffers[i]->datas[j];
 			if (d->type == SPA_DATA_MemPtr)
-				endptr = SPA_MEMBER(d->data, d->maxsize, void);
+				endptr = SPA_MAX(endptr, SPA_MEMBER(d->data, d->maxsize, void));
 		}
 
 		m = pw_mempool_import_block(this->client->pool, mem);
@@ -1298,7 +1346,6 @@ static void node_initialized(void *data)
 	struct node *node = &impl->node;
 	struct pw_global *global;
 	struct spa_system *data_system = impl->node.data_system;
-	size_t size;
 
 	impl->fds[0] = spa_system_eventfd_create(data_system, SPA_FD_CLOEXEC | SPA_FD_NONBLOCK);
 	impl->fds[1] = spa_system_eventfd_create(data_system, SPA_FD_CLOEXEC | SPA_FD_NONBLOCK);
@@ -1310,18 +1357,6 @@ static void node_initialized(void *data)
 	spa_loop_add_source(node->data_loop, &node->data_source);
 	pw_log_debug(NAME " %p: transport read-fd:%d write-fd:%d", node, impl->fds[0], impl->fds[1]);
 
-	size = sizeof(struct spa_io_buffers) * MAX_AREAS;
-
-	impl->io_areas = pw_mempool_alloc(impl->context->pool,
-			PW_MEMBLOCK_FLAG_READWRITE |
-			PW_MEMBLOCK_FLAG_MAP |
-			PW_MEMBLOCK_FLAG_SEAL,
-			SPA_DATA_MemFd, size);
-	if (impl->io_areas == NULL)
-                return;
-
-	pw_log_debug(NAME " %p: io areas %p", node, impl->io_areas->map->ptr);
-
 	if ((global = pw_impl_node_get_global(this->node)) != NULL)
 		pw_impl_client_node_registered(this, global);
 }
@@ -1334,6 +1369,7 @@ static void node_free(void *data)
 	struct spa_system *data_system = node->data_system;
 	uint32_t tag[5] = { impl->node_id, };
 	struct pw_memmap *mm;
+	struct pw_memblock **mem;
 
 	this->node = NULL;
 
@@ -1350,8 +1386,9 @@ static void node_free(void *data)
 
 	if (impl->activation)
 		pw_memblock_unref(impl->activation);
-	if (impl->io_areas)
-		pw_memblock_unref(impl->io_areas);
+	pw_array_for_each(mem, &impl->io_areas)
+		pw_memblock_unref(*mem);
+	pw_array_clear(&impl->io_areas);
 
 	pw_map_clear(&impl->io_map);
 
@@ -1375,12 +1412,14 @@ static int port_init_mix(void *data, struct pw_impl_port_mix *mix)
 	if (mix->id == SPA_ID_INVALID)
 		return -errno;
 
-	mix->io = SPA_MEMBER(impl->io_areas->map->ptr,
-			mix->id * sizeof(struct spa_io_buffers), void);
+	if ((mix->io = ensure_io_area(impl, mix->id)) == NULL) {
+		pw_map_remove(&impl->io_map, mix->id);
+		return -errno;
+	}
 	*mix->io = SPA_IO_BUFFERS_INIT;
 
-	pw_log_debug(NAME " %p: init mix id:%d io:%p base:%p", impl,
-			mix->id, mix->io, impl->io_areas->map->ptr);
+	pw_log_debug(NAME " %p: init mix id:%d io:%p", impl,
+			mix->id, mix->io);
 
 	return 0;
 }
@@ -1392,8 +1431,8 @@ static int port_release_mix(void *data, struct pw_impl_port_mix *mix)
 	struct node *this = &impl->node;
 	struct mix *m;
 
-	pw_log_debug(NAME " %p: remove mix id:%d io:%p base:%p",
-			this, mix->id, mix->io, impl->io_areas->map->ptr);
+	pw_log_debug(NAME " %p: remove mix id:%d io:%p",
+			this, mix->id, mix->io);
 
 	if ((m = find_mix(port, mix->port.port_id)) == NULL || !m->valid)
 		return -EINVAL;
@@ -1720,6 +1759,7 @@ struct pw_impl_client_node *pw_impl_client_node_new(struct pw_resource *resource
 	this->flags = do_register ? 0 : 1;
 
 	pw_map_init(&impl->io_map, 64, 64);
+	pw_array_init(&impl->io_areas, 64);
 
 	this->resource = resource;
 	this->node = pw_spa_node_new(context,
@@ -0,0 +1,93 @@
+/* PipeWire
+ *
+ * Copyright © 2018 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PIPEWIRE_REMOTE_NODE_MIX_H
+#define PIPEWIRE_REMOTE_NODE_MIX_H
+
+#include <spa/utils/list.h>
+
+#include "pipewire/array.h"
+#include "pipewire/private.h"
+
+#define MAX_MIX	4096
+#define MIX_HASH_SIZE	1024
+
+struct mix {
+	struct spa_list link;
+	struct spa_list hash_link;
+	struct pw_impl_port *port;
+	uint32_t mix_id;
+	struct pw_impl_port_mix mix;
+	struct pw_array buffers;
+	struct pw_array maps;
+	bool active;
+};
+
+/** the mixes of a node by direction, port and mix id */
+struct mix_hash {
+	struct spa_list buckets[MIX_HASH_SIZE];
+};
+
+static inline void mix_hash_init(struct mix_hash *h)
+{
+	uint32_t i;
+	for (i = 0; i < MIX_HASH_SIZE; i++)
+		spa_list_init(&h->buckets[i]);
+}
+
+static inline struct spa_list *mix_hash_bucket(struct mix_hash *h,
+		enum spa_direction direction, uint32_t port_id, uint32_t mix_id)
+{
+	uint32_t hash = (port_id * 2 + direction) * 31 + mix_id;
+	return &h->buckets[hash & (MIX_HASH_SIZE - 1)];
+}
+
+static inline struct mix *mix_hash_find(struct mix_hash *h,
+		enum spa_direction direction, uint32_t port_id, uint32_t mix_id)
+{
+	struct mix *mix;
+
+	spa_list_for_each(mix, mix_hash_bucket(h, direction, port_id, mix_id), hash_link) {
+		if (mix->port->port_id == port_id &&
+		    mix->port->direction == (enum pw_direction)direction &&
+		    mix->mix_id == mix_id)
+			return mix;
+	}
+	return NULL;
+}
+
+/** add \a mix, its port and mix_id are set */
+static inline void mix_hash_insert(struct mix_hash *h, struct mix *mix,
+		enum spa_direction direction)
+{
+	spa_list_append(mix_hash_bucket(h, direction, mix->port->port_id, mix->mix_id),
+			&mix->hash_link);
+}
+
+static inline void mix_hash_remove(struct mix_hash *h, struct mix *mix)
+{
+	spa_list_remove(&mix->hash_link);
+}
+
+#endif /* PIPEWIRE_REMOTE_NODE_MIX_H */
@@ -41,7 +41,7 @@
 #include "extensions/protocol-native.h"
 #include "extensions/client-node.h"
 
-#define MAX_MIX	4096
+#include "remote-node-mix.h"
 
 /** \cond */
 static bool mlock_warned = false;
@@ -49,16 +49,14 @@ static bool mlock_warned = false;
 struct buffer {
 	uint32_t id;
 	struct spa_buffer *buf;
-	struct pw_memmap *mem;
+	struct pw_memmap *mem;		/**< the map of the block, owned by the mix */
 };
 
-struct mix {
-	struct spa_list link;
-	struct pw_impl_port *port;
-	uint32_t mix_id;
-	struct pw_impl_port_mix mix;
-	struct pw_array buffers;
-	bool active;
+struct buffer_range {
+	uint32_t mem_id;
+	uint32_t offset;
+	uint32_t end;
+	struct pw_memmap *mem;
 };
 
 struct node_data {
@@ -73,6 +71,7 @@ struct node_data {
 	struct mix mix_pool[MAX_MIX];
 	struct spa_list mix[2];
 	struct spa_list free_mix;
+	struct mix_hash mix_hash;
 
 	struct pw_impl_node *node;
 	struct spa_hook node_listener;
@@ -162,6 +161,7 @@ static void mix_init(struct mix *mix, struct pw_impl_port *port, uint32_t mix_id
 	mix->active = false;
 	pw_array_init(&mix->buffers, 32);
 	pw_array_ensure_size(&mix->buffers, sizeof(struct buffer) * 64);
+	pw_array_init(&mix->maps, 4 * sizeof(struct pw_memmap *));
 }
 
 static int
@@ -210,14 +210,19 @@ activate_mix(struct node_data *data, struct mix *mix)
 static struct mix *find_mix(struct node_data *data,
 		enum spa_direction direction, uint32_t port_id, uint32_t mix_id)
 {
-	struct mix *mix;
+	return mix_hash_find(&data->mix_hash, direction, port_id, mix_id);
+}
 
-	spa_list_for_each(mix, &data->mix[direction], link) {
-		if (mix->port->port_id == port_id &&
-		    mix->mix_id == mix_id)
-			return mix;
-	}
-	return NULL;
+static void insert_mix(struct node_data *data, struct mix *mix, enum spa_direction direction)
+{
+	spa_list_append(&data->mix[direction], &mix->link);
+	mix_hash_insert(&data->mix_hash, mix, direction);
+}
+
+static void remove_mix(struct node_data *data, struct mix *mix)
+{
+	spa_list_remove(&mix->link);
+	mix_hash_remove(&data->mix_hash, mix);
 }
 
 static struct mix *ensure_mix(struct node_data *data,
@@ -240,7 +245,7 @@ static struct mix *ensure_mix(struct node_data *data,
 	spa_list_remove(&mix->link);
 
 	mix_init(mix, port, mix_id);
-	spa_list_append(&data->mix[direction], &mix->link);
+	insert_mix(data, mix, direction);
 
 	return mix;
 }
@@ -535,6 +540,7 @@ static int clear_buffers(struct node_data *data, struct mix *mix)
 {
 	struct pw_impl_port *port = mix->port;
         struct buffer *b;
+	struct pw_memmap **mm;
 	int res;
 
         pw_log_debug("port %p: clear %zd buffers mix:%d", port,
@@ -549,10 +555,13 @@ static int clear_buffers(struct node_data *data, struct mix *mix)
         pw_array_for_each(b, &mix->buffers) {
 		pw_log_debug("port %p: clear buffer %d map %p %p",
 			port, b->id, b->mem, b->buf);
-		pw_memmap_free(b->mem);
 		free(b->buf);
         }
 	mix->buffers.size = 0;
+
+	pw_array_for_each(mm, &mix->maps)
+		pw_memmap_free(*mm);
+	mix->maps.size = 0;
 	return 0;
 }
 
@@ -606,8 +615,9 @@ client_node_port_use_buffers(void *object,
 	struct node_data *data = object;
 	struct pw_proxy *proxy = (struct pw_proxy*)data->client_node;
 	struct buffer *bid;
-	uint32_t i, j;
+	uint32_t i, j, n_ranges;
 	struct spa_buffer *b, **bufs;
+	struct buffer_range *ranges, *r;
 	struct mix *mix;
 	int res, prot;
 
@@ -623,26 +633,42 @@ client_node_port_use_buffers(void *object,
 	clear_buffers(data, mix);
 
 	bufs = alloca(n_buffers * sizeof(struct spa_buffer *));
+	ranges = alloca(n_buffers * sizeof(struct buffer_range));
+
+	/* the buffers of a port are usually allocated in one block, collect
+	 * the range of each block so that it is mapped once for all the
+	 * buffers. Mixes with the same buffers then share the mapping. */
+	for (i = 0, n_ranges = 0; i < n_buffers; i++) {
+		for (j = 0; j < n_ranges; j++)
+			if (ranges[j].mem_id == buffers[i].mem_id)
+				break;
+		r = &ranges[j];
+		if (j == n_ranges) {
+			r->mem_id = buffers[i].mem_id;
+			r->offset = buffers[i].offset;
+			r->end = buffers[i].offset + buffers[i].size;
+			n_ranges++;
+		} else {
+			r->offset = SPA_MIN(r->offset, buffers[i].offset);
+			r->end = SPA_MAX(r->end, buffers[i].offset + buffers[i].size);
+		}
+	}
+	for (i = 0; i < n_ranges; i++) {
+		struct pw_memmap *mm, **maps;
 
-	for (i = 0; i < n_buffers; i++) {
-		size_t size;
-		off_t offset;
-		struct pw_memmap *mm;
-
-		mm = pw_mempool_map_id(data->pool, buffers[i].mem_id,
-				prot, buffers[i].offset, buffers[i].size, NULL);
-		if (mm == NULL) {
+		r = &ranges[i];
+		if ((maps = pw_array_add(&mix->maps, sizeof(struct pw_memmap *))) == NULL) {
 			res = -errno;
 			goto error_exit_cleanup;
 		}
-
-		bid = pw_array_add(&mix->buffers, sizeof(struct buffer));
-		if (bid == NULL) {
+		mm = pw_mempool_map_id(data->pool, r->mem_id,
+				prot, r->offset, r->end - r->offset, NULL);
+		if (mm == NULL) {
 			res = -errno;
+			mix->maps.size -= sizeof(struct pw_memmap *);
 			goto error_exit_cleanup;
 		}
-		bid->id = i;
-		bid->mem = mm;
+		*maps = r->mem = mm;
 
 		if (data->allow_mlock && mlock(mm->ptr, mm->size) < 0)
 			if (errno != ENOMEM || !mlock_warned) {
@@ -654,6 +680,27 @@ client_node_port_use_buffers(void *object,
 						"consider increasing RLIMIT_MEMLOCK" : strerror(errno));
 				mlock_warned |= errno == ENOMEM;
 			}
+	}
+
+	for (i = 0; i < n_buffers; i++) {
+		size_t size;
+		off_t offset;
+		struct pw_memmap *mm;
+		void *ptr;
+
+		for (j = 0; j < n_ranges; j++)
+			if (ranges[j].mem_id == buffers[i].mem_id)
+				break;
+		mm = ranges[j].mem;
+		ptr = SPA_MEMBER(mm->ptr, buffers[i].offset - mm->offset, void);
+
+		bid = pw_array_add(&mix->buffers, sizeof(struct buffer));
+		if (bid == NULL) {
+			res = -errno;
+			goto error_exit_cleanup;
+		}
+		bid->id = i;
+		bid->mem = mm;
 
 		size = sizeof(struct spa_buffer);
 		for (j = 0; j < buffers[i].buffer->n_metas; j++)
@@ -679,7 +726,7 @@ client_node_port_use_buffers(void *object,
 		for (j = 0; j < b->n_metas; j++) {
 			struct spa_meta *m = &b->metas[j];
 			memcpy(m, &buffers[i].buffer->metas[j], sizeof(struct spa_meta));
-			m->data = SPA_MEMBER(mm->ptr, offset, void);
+			m->data = SPA_MEMBER(ptr, offset, void);
 			offset += SPA_ROUND_UP_N(m->size, 8);
 		}
 
@@ -688,7 +735,7 @@ client_node_port_use_buffers(void *object,
 
 			memcpy(d, &buffers[i].buffer->datas[j], sizeof(struct spa_data));
 			d->chunk =
-			    SPA_MEMBER(mm->ptr, offset + sizeof(struct spa_chunk) * j,
+			    SPA_MEMBER(ptr, offset + sizeof(struct spa_chunk) * j,
 				       struct spa_chunk);
 
 			if (flags & SPA_NODE_BUFFERS_FLAG_ALLOC)
@@ -713,7 +760,7 @@ client_node_port_use_buffers(void *object,
 						j, bm->id, bm->fd, d->maxsize);
 			} else if (d->type == SPA_DATA_MemPtr) {
 				int offs = SPA_PTR_TO_INT(d->data);
-				d->data = SPA_MEMBER(mm->ptr, offs, void);
+				d->data = SPA_MEMBER(ptr, offs, void);
 				d->fd = -1;
 				pw_log_debug(" data %d id:%u -> mem:%p offs:%d maxsize:%d",
 						j, bid->id, d->data, offs, d->maxsize);
@@ -964,10 +1011,11 @@ static void clear_mix(struct node_data *data, struct mix *mix)
 {
 	deactivate_mix(data, mix);
 
-	spa_list_remove(&mix->link);
+	remove_mix(data, mix);
 
 	clear_buffers(data, mix);
 	pw_array_clear(&mix->buffers);
+	pw_array_clear(&mix->maps);
 
 	spa_list_remove(&mix->mix.link);
 	spa_list_append(&data->free_mix, &mix->link);
@@ -1229,6 +1277,7 @@ static struct pw_proxy *node_export(struct pw_core *core, void *object, bool do_
 	spa_list_init(&data->mix[1]);
 	for (i = 0; i < MAX_MIX; i++)
 		spa_list_append(&data->free_mix, &data->mix_pool[i].link);
+	mix_hash_init(&data->mix_hash);
 
 	spa_list_init(&data->links);
 
@@ -0,0 +1,156 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <time.h>
+
+#include <pipewire/pipewire.h>
+
+/* unit test of the hash the remote node uses to find its mixes by
+ * direction, port and mix id, it does not create a remote node */
+#include "remote-node-mix.h"
+
+#define N_PORTS		512
+#define N_ROUNDS	16
+
+static const uint32_t mix_counts[] = { 64, 512, 4096 };
+
+static struct mix_hash hash;
+static struct mix mix_pool[MAX_MIX];
+static struct spa_list free_mix;
+static struct pw_impl_port ports[2][N_PORTS];
+
+static void init_data(void)
+{
+	uint32_t i;
+
+	mix_hash_init(&hash);
+	spa_list_init(&free_mix);
+	for (i = 0; i < MAX_MIX; i++)
+		spa_list_append(&free_mix, &mix_pool[i].link);
+
+	for (i = 0; i < N_PORTS; i++) {
+		ports[SPA_DIRECTION_INPUT][i].port_id = i;
+		ports[SPA_DIRECTION_INPUT][i].direction = PW_DIRECTION_INPUT;
+		ports[SPA_DIRECTION_OUTPUT][i].port_id = i;
+		ports[SPA_DIRECTION_OUTPUT][i].direction = PW_DIRECTION_OUTPUT;
+	}
+}
+
+/* spread the mixes over the ports and directions like a client with many
+ * ports, each with a couple of links, would */
+static void mix_location(uint32_t i, enum spa_direction *direction,
+		uint32_t *port_id, uint32_t *mix_id)
+{
+	*direction = i & 1;
+	*port_id = (i >> 1) % N_PORTS;
+	*mix_id = (i >> 1) / N_PORTS;
+}
+
+static void add_mixes(uint32_t n_mix)
+{
+	enum spa_direction direction;
+	uint32_t i, port_id, mix_id;
+	struct mix *mix;
+
+	for (i = 0; i < n_mix; i++) {
+		mix_location(i, &direction, &port_id, &mix_id);
+		spa_assert(mix_hash_find(&hash, direction, port_id, mix_id) == NULL);
+
+		spa_assert(!spa_list_is_empty(&free_mix));
+		mix = spa_list_first(&free_mix, struct mix, link);
+		spa_list_remove(&mix->link);
+
+		mix->port = &ports[direction][port_id];
+		mix->mix_id = mix_id;
+		mix_hash_insert(&hash, mix, direction);
+	}
+}
+
+static void remove_mixes(uint32_t n_mix)
+{
+	enum spa_direction direction;
+	uint32_t i, port_id, mix_id;
+	struct mix *mix;
+
+	for (i = 0; i < n_mix; i++) {
+		mix_location(i, &direction, &port_id, &mix_id);
+		mix = mix_hash_find(&hash, direction, port_id, mix_id);
+		spa_assert(mix != NULL);
+		mix_hash_remove(&hash, mix);
+		spa_list_append(&free_mix, &mix->link);
+	}
+	for (i = 0; i < MIX_HASH_SIZE; i++)
+		spa_assert(spa_list_is_empty(&hash.buckets[i]));
+}
+
+static void test_lookup(uint32_t n_mix)
+{
+	enum spa_direction direction;
+	uint32_t i, j, port_id, mix_id;
+	struct timespec ts;
+	uint64_t t1, t2;
+	struct mix *mix;
+
+	init_data();
+	add_mixes(n_mix);
+
+	/* look up every mix, like a reconfiguration of all ports does */
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (j = 0; j < N_ROUNDS; j++) {
+		for (i = 0; i < n_mix; i++) {
+			mix_location(i, &direction, &port_id, &mix_id);
+			mix = mix_hash_find(&hash, direction, port_id, mix_id);
+			spa_assert(mix != NULL);
+			spa_assert(mix->port->port_id == port_id);
+			spa_assert(mix->port->direction == (enum pw_direction)direction);
+			spa_assert(mix->mix_id == mix_id);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	fprintf(stderr, "mixes %u: reconfigure %"PRIu64" ns, %"PRIu64" ns/lookup\n",
+			n_mix, (t2 - t1) / N_ROUNDS, (t2 - t1) / (N_ROUNDS * n_mix));
+
+	/* a mix on another port or in the other direction is not found */
+	spa_assert(mix_hash_find(&hash, SPA_DIRECTION_INPUT, N_PORTS, 0) == NULL);
+	spa_assert(mix_hash_find(&hash, SPA_DIRECTION_OUTPUT, 0, n_mix) == NULL);
+
+	remove_mixes(n_mix);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	pw_init(&argc, &argv);
+
+	for (i = 0; i < SPA_N_ELEMENTS(mix_counts); i++)
+		test_lookup(mix_counts[i]);
+
+	return 0;
+}
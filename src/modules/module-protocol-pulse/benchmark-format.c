@@ -0,0 +1,120 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <pipewire/pipewire.h>
+
+#include "benchmark.h"
+
+/* the format and channel map conversions of a list of the sinks, with
+ * sinks of different layouts */
+
+#define MAX_COUNT	2000
+#define N_DEVICES	32
+
+struct layout {
+	const char *name;
+	struct spa_audio_info_raw info;
+};
+
+static const struct layout layouts[] = {
+	{ "stereo",
+		{ .format = SPA_AUDIO_FORMAT_F32P, .rate = 48000, .channels = 2,
+		  .position = { SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR, } } },
+	{ "surround-51",
+		{ .format = SPA_AUDIO_FORMAT_S16, .rate = 44100, .channels = 6,
+		  .position = { SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR,
+			SPA_AUDIO_CHANNEL_RL, SPA_AUDIO_CHANNEL_RR,
+			SPA_AUDIO_CHANNEL_FC, SPA_AUDIO_CHANNEL_LFE, } } },
+	{ "surround-71",
+		{ .format = SPA_AUDIO_FORMAT_S32, .rate = 96000, .channels = 8,
+		  .position = { SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR,
+			SPA_AUDIO_CHANNEL_RL, SPA_AUDIO_CHANNEL_RR,
+			SPA_AUDIO_CHANNEL_FC, SPA_AUDIO_CHANNEL_LFE,
+			SPA_AUDIO_CHANNEL_SL, SPA_AUDIO_CHANNEL_SR, } } },
+};
+
+static void run_list(struct bench *b)
+{
+	struct bench_reply r;
+	uint64_t t1, t2;
+	uint32_t i, j;
+	uint8_t channels;
+
+	t1 = bench_now();
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		bench_start(b, COMMAND_GET_SINK_INFO_LIST);
+		bench_request(b, &r);
+
+		for (j = 0; r.offset < r.length; j++) {
+			/* index, name, description and sample spec, the channel
+			 * map and the 10 other fields of protocol version 13 */
+			spa_assert(bench_skip_n(&r, 4) == 0);
+			spa_assert(bench_get_channel_map(&r, &channels) == 0);
+			spa_assert(bench_skip_n(&r, 10) == 0);
+			spa_assert(channels == layouts[j % SPA_N_ELEMENTS(layouts)].info.channels);
+		}
+		spa_assert(j == N_DEVICES);
+	}
+
+	t2 = bench_now();
+
+	fprintf(stderr, "sinks: devices %u, elapsed %"PRIu64" count %u = %"PRIu64" ns/list\n",
+			N_DEVICES, t2 - t1, MAX_COUNT, (t2 - t1) / MAX_COUNT);
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench b;
+	struct bench_node *devices[N_DEVICES];
+	struct pw_properties *props;
+	const struct layout *l;
+	uint32_t i;
+
+	pw_init(&argc, &argv);
+
+	bench_init(&b, NULL);
+
+	pw_thread_loop_lock(b.loop);
+	for (i = 0; i < N_DEVICES; i++) {
+		l = &layouts[i % SPA_N_ELEMENTS(layouts)];
+		props = pw_properties_new(PW_KEY_MEDIA_CLASS, "Audio/Sink", NULL);
+		pw_properties_setf(props, PW_KEY_NODE_NAME, "%s-%u", l->name, i);
+		devices[i] = bench_node_new(&b, SPA_DIRECTION_INPUT, &l->info, props);
+	}
+	pw_thread_loop_unlock(b.loop);
+
+	bench_connect(&b, NULL);
+	run_list(&b);
+	bench_disconnect(&b);
+
+	pw_thread_loop_lock(b.loop);
+	for (i = 0; i < N_DEVICES; i++)
+		bench_node_free(devices[i]);
+	pw_thread_loop_unlock(b.loop);
+
+	bench_clear(&b);
+	return 0;
+}
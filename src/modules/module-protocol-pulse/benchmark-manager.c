@@ -0,0 +1,252 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <pipewire/pipewire.h>
+
+#include "benchmark.h"
+
+/* the lookups of the manager as a client sees them: lists of the
+ * sink-inputs that find the sink each stream is linked to, the default
+ * sink in the server info and the volume steps of a slider that come back
+ * as change events */
+
+#define MAX_COUNT	20
+#define N_SINKS		8
+#define VOLUME_STEPS	2000
+
+static const uint32_t n_streams[] = { 100, 500, 2000 };
+
+struct graph {
+	struct bench_node *sinks[N_SINKS];
+	struct bench_node *sources[N_SINKS];
+	struct bench_node **streams;
+	uint32_t n_streams;
+	uint32_t *expected;	/* the sink of a stream, by stream id */
+	uint32_t max_id;
+};
+
+static const struct spa_audio_info_raw stereo = {
+	.format = SPA_AUDIO_FORMAT_F32P,
+	.rate = 48000,
+	.channels = 2,
+	.position = { SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR, },
+};
+
+static struct bench_node *add_node(struct bench *b, enum spa_direction direction,
+		const char *media_class, uint32_t index)
+{
+	struct pw_properties *props;
+
+	props = pw_properties_new(PW_KEY_MEDIA_CLASS, media_class, NULL);
+	pw_properties_setf(props, PW_KEY_NODE_NAME, "%s-%u", media_class, index);
+	pw_properties_setf(props, PW_KEY_PRIORITY_DRIVER, "%u", 1000 + index);
+	return bench_node_new(b, direction, &stereo, props);
+}
+
+/* a few sinks and sources, and streams with a stereo link to one of the
+ * sinks each */
+static void fill(struct bench *b, struct graph *g, uint32_t streams)
+{
+	uint32_t i;
+
+	pw_thread_loop_lock(b->loop);
+	for (i = 0; i < N_SINKS; i++) {
+		g->sinks[i] = add_node(b, SPA_DIRECTION_INPUT, "Audio/Sink", i);
+		g->sources[i] = add_node(b, SPA_DIRECTION_OUTPUT, "Audio/Source", i);
+	}
+	g->n_streams = streams;
+	g->streams = calloc(streams, sizeof(struct bench_node *));
+	spa_assert(g->streams != NULL);
+	for (i = 0; i < streams; i++) {
+		g->streams[i] = add_node(b, SPA_DIRECTION_OUTPUT, "Stream/Output/Audio", i);
+		bench_link(b, g->streams[i], g->sinks[i % N_SINKS]);
+		g->max_id = SPA_MAX(g->max_id, g->streams[i]->id);
+	}
+	pw_thread_loop_unlock(b->loop);
+
+	g->expected = calloc(g->max_id + 1, sizeof(uint32_t));
+	spa_assert(g->expected != NULL);
+	for (i = 0; i < streams; i++)
+		g->expected[g->streams[i]->id] = g->sinks[i % N_SINKS]->id;
+}
+
+static void clear(struct bench *b, struct graph *g)
+{
+	uint32_t i;
+
+	pw_thread_loop_lock(b->loop);
+	for (i = 0; i < g->n_streams; i++)
+		bench_node_free(g->streams[i]);
+	for (i = 0; i < N_SINKS; i++) {
+		bench_node_free(g->sinks[i]);
+		bench_node_free(g->sources[i]);
+	}
+	pw_thread_loop_unlock(b->loop);
+	free(g->streams);
+	free(g->expected);
+}
+
+static void run_list(struct bench *b, struct graph *g)
+{
+	struct bench_reply r;
+	uint64_t t1, t2;
+	uint32_t i, j, id, sink;
+
+	t1 = bench_now();
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		bench_start(b, COMMAND_GET_SINK_INPUT_INFO_LIST);
+		bench_request(b, &r);
+
+		for (j = 0; r.offset < r.length; j++) {
+			/* index, name, module, client, sink and the 9 other
+			 * fields of protocol version 13 */
+			spa_assert(bench_get_u32(&r, &id) == 0);
+			spa_assert(bench_skip_n(&r, 3) == 0);
+			spa_assert(bench_get_u32(&r, &sink) == 0);
+			spa_assert(bench_skip_n(&r, 9) == 0);
+			spa_assert(id <= g->max_id && g->expected[id] == sink);
+		}
+		spa_assert(j == g->n_streams);
+	}
+
+	t2 = bench_now();
+
+	fprintf(stderr, "sink-inputs: streams %u, elapsed %"PRIu64" count %u = %"PRIu64" ns/list\n",
+			g->n_streams, t2 - t1, MAX_COUNT, (t2 - t1) / MAX_COUNT);
+}
+
+static void run_default(struct bench *b, struct graph *g)
+{
+	struct bench_reply r;
+	uint64_t t1, t2;
+	const char *name;
+	char expected[64];
+	uint32_t i;
+
+	snprintf(expected, sizeof(expected), "Audio/Sink-%u", N_SINKS - 1);
+
+	t1 = bench_now();
+
+	for (i = 0; i < MAX_COUNT * 100; i++) {
+		bench_start(b, COMMAND_GET_SERVER_INFO);
+		bench_request(b, &r);
+
+		/* the default sink comes after the names, versions and the
+		 * sample spec */
+		spa_assert(bench_skip_n(&r, 5) == 0);
+		spa_assert(bench_get_string(&r, &name) == 0);
+		spa_assert(name != NULL && strcmp(name, expected) == 0);
+	}
+
+	t2 = bench_now();
+
+	fprintf(stderr, "server-info: streams %u, elapsed %"PRIu64" count %u = %"PRIu64" ns/request\n",
+			g->n_streams, t2 - t1, MAX_COUNT * 100, (t2 - t1) / (MAX_COUNT * 100));
+}
+
+struct volume_step {
+	uint32_t sink;
+	bool changed;
+};
+
+static void on_event(void *data, uint32_t command, struct bench_reply *r)
+{
+	struct volume_step *s = data;
+	uint32_t event, index;
+
+	if (command != COMMAND_SUBSCRIBE_EVENT)
+		return;
+	spa_assert(bench_get_u32(r, &event) == 0);
+	spa_assert(bench_get_u32(r, &index) == 0);
+	if (event == (SUBSCRIPTION_EVENT_SINK | SUBSCRIPTION_EVENT_CHANGE) &&
+	    index == s->sink)
+		s->changed = true;
+}
+
+/* a step of a volume slider, until the change of the sink is seen */
+static void run_volume(struct bench *b, struct graph *g)
+{
+	struct volume_step s = { .sink = g->sinks[0]->id };
+	struct bench_reply r;
+	uint64_t t1, t2;
+	uint32_t i, tag, t, command;
+	bool replied;
+
+	bench_start(b, COMMAND_SUBSCRIBE);
+	bench_put_u32(b, SUBSCRIPTION_MASK_SINK);
+	bench_request(b, &r);
+
+	t1 = bench_now();
+
+	for (i = 0; i < VOLUME_STEPS; i++) {
+		tag = bench_start(b, COMMAND_SET_SINK_VOLUME);
+		bench_put_u32(b, s.sink);
+		bench_put_string(b, NULL);
+		bench_put_cvolume(b, 2, (i & 1) ? 0x8000 : 0x9000);
+		bench_send(b);
+
+		/* the event can come before or after the reply */
+		for (s.changed = replied = false; !s.changed || !replied; ) {
+			bench_next(b, &r, &command, &t);
+			if (t == tag) {
+				bench_check_reply(tag, command, &r);
+				replied = true;
+			} else {
+				on_event(&s, command, &r);
+			}
+		}
+	}
+
+	t2 = bench_now();
+
+	fprintf(stderr, "volume: streams %u, elapsed %"PRIu64" count %u = %"PRIu64" ns/step\n",
+			g->n_streams, t2 - t1, VOLUME_STEPS, (t2 - t1) / VOLUME_STEPS);
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench b;
+	struct graph g;
+	uint32_t i;
+
+	pw_init(&argc, &argv);
+
+	for (i = 0; i < SPA_N_ELEMENTS(n_streams); i++) {
+		spa_zero(g);
+		bench_init(&b, NULL);
+		fill(&b, &g, n_streams[i]);
+		bench_connect(&b, NULL);
+
+		run_list(&b, &g);
+		run_default(&b, &g);
+		run_volume(&b, &g);
+
+		bench_disconnect(&b);
+		clear(&b, &g);
+		bench_clear(&b);
+	}
+	return 0;
+}
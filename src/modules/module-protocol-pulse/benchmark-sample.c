@@ -0,0 +1,229 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <pipewire/pipewire.h>
+
+#include "benchmark.h"
+
+/* play samples on a dummy sink like an event sound client does. A play
+ * request is answered when the sample is added to the mixer stream of the
+ * sink, the first one also makes the mixer. The graph runs, the samples
+ * are mixed in the data thread while the next ones are requested. */
+
+#define RATE		48000
+#define CHANNELS	2
+#define SAMPLE_FRAMES	1024
+#define MAX_TRIGGERS	2000
+
+static const uint8_t channel_map[CHANNELS] = { 1, 2 };	/* front-left, front-right */
+
+struct data {
+	struct bench b;
+	struct spa_hook context_listener;
+	struct pw_impl_node *sink;
+	struct spa_source *link_event;
+	struct pw_impl_port *ports[16];
+	uint32_t n_ports;
+};
+
+/* there is no session manager, link the output ports of the mixer streams
+ * to the sink like it would */
+static void do_link(void *user_data, uint64_t count)
+{
+	struct data *d = user_data;
+	struct pw_impl_port *in;
+	struct pw_impl_link *link;
+	struct pw_properties *props;
+	uint32_t i;
+
+	in = pw_impl_node_find_port(d->sink, PW_DIRECTION_INPUT, PW_ID_ANY);
+	spa_assert(in != NULL);
+
+	for (i = 0; i < d->n_ports; i++) {
+		struct pw_impl_node *node = pw_impl_port_get_node(d->ports[i]);
+
+		props = pw_properties_new(NULL, NULL);
+		pw_properties_setf(props, PW_KEY_LINK_OUTPUT_NODE, "%u",
+				pw_global_get_id(pw_impl_node_get_global(node)));
+		pw_properties_setf(props, PW_KEY_LINK_INPUT_NODE, "%u",
+				pw_global_get_id(pw_impl_node_get_global(d->sink)));
+
+		link = pw_context_create_link(d->b.context, d->ports[i], in, NULL, props, 0);
+		spa_assert(link != NULL);
+		spa_assert(pw_impl_link_register(link, NULL) >= 0);
+	}
+	d->n_ports = 0;
+}
+
+static void context_global_added(void *user_data, struct pw_global *global)
+{
+	struct data *d = user_data;
+	struct pw_impl_port *port;
+	const struct pw_properties *props;
+	const char *str;
+
+	if (!pw_global_is_type(global, PW_TYPE_INTERFACE_Port))
+		return;
+
+	port = pw_global_get_object(global);
+	if (pw_impl_port_get_direction(port) != PW_DIRECTION_OUTPUT)
+		return;
+
+	props = pw_impl_node_get_properties(pw_impl_port_get_node(port));
+	if ((str = pw_properties_get(props, PW_KEY_MEDIA_CLASS)) == NULL ||
+	    strcmp(str, "Stream/Output/Audio") != 0)
+		return;
+
+	spa_assert(d->n_ports < SPA_N_ELEMENTS(d->ports));
+	d->ports[d->n_ports++] = port;
+	pw_loop_signal_event(pw_thread_loop_get_loop(d->b.loop), d->link_event);
+}
+
+static const struct pw_context_events context_events = {
+	PW_VERSION_CONTEXT_EVENTS,
+	.global_added = context_global_added,
+};
+
+static void make_sink(struct data *d)
+{
+	struct pw_impl_factory *factory;
+	struct pw_properties *props;
+
+	/* the libraries of the sink and of the converter of the streams, the
+	 * context has no config */
+	pw_context_add_spa_lib(d->b.context, "support.*", "support/libspa-support");
+	pw_context_add_spa_lib(d->b.context, "audio.convert.*", "audioconvert/libspa-audioconvert");
+
+	factory = pw_context_find_factory(d->b.context, "spa-node-factory");
+	spa_assert(factory != NULL);
+
+	props = pw_properties_new(
+			SPA_KEY_FACTORY_NAME, "support.null-audio-sink",
+			PW_KEY_NODE_NAME, "bench-sink",
+			PW_KEY_MEDIA_CLASS, "Audio/Sink",
+			"audio.position", "FL,FR",
+			NULL);
+	d->sink = pw_impl_factory_create_object(factory, NULL,
+			PW_TYPE_INTERFACE_Node, PW_VERSION_NODE, props, 0);
+	spa_assert(d->sink != NULL);
+
+	d->link_event = pw_loop_add_event(pw_thread_loop_get_loop(d->b.loop), do_link, d);
+	spa_assert(d->link_event != NULL);
+	pw_context_add_listener(d->b.context, &d->context_listener, &context_events, d);
+}
+
+static void upload_sample(struct bench *b, const char *name)
+{
+	struct bench_reply r;
+	uint32_t channel, length = SAMPLE_FRAMES * CHANNELS * sizeof(int16_t), i;
+	int16_t samples[SAMPLE_FRAMES * CHANNELS];
+
+	for (i = 0; i < SPA_N_ELEMENTS(samples); i++)
+		samples[i] = i * 7;
+
+	bench_start(b, COMMAND_CREATE_UPLOAD_STREAM);
+	bench_put_string(b, name);
+	bench_put_sample_spec(b, 3, CHANNELS, RATE);	/* s16le */
+	bench_put_channel_map(b, CHANNELS, channel_map);
+	bench_put_u32(b, length);
+	bench_put_proplist(b, &SPA_DICT_INIT_ARRAY(((struct spa_dict_item[]) {
+			{ PW_KEY_MEDIA_NAME, name } })));
+	bench_request(b, &r);
+	spa_assert(bench_get_u32(&r, &channel) == 0);
+
+	bench_send_packet(b, channel, samples, length);
+
+	bench_start(b, COMMAND_FINISH_UPLOAD_STREAM);
+	bench_put_u32(b, channel);
+	bench_request(b, &r);
+}
+
+static uint64_t play_sample(struct bench *b, const char *name)
+{
+	struct bench_reply r;
+	uint64_t t1;
+
+	t1 = bench_now();
+	bench_start(b, COMMAND_PLAY_SAMPLE);
+	bench_put_u32(b, SPA_ID_INVALID);
+	bench_put_string(b, "bench-sink");
+	bench_put_u32(b, 0x10000);
+	bench_put_string(b, name);
+	bench_put_proplist(b, &SPA_DICT_INIT(NULL, 0));
+	bench_request(b, &r);
+	return bench_now() - t1;
+}
+
+static void run_play(struct bench *b)
+{
+	uint64_t latency, min = UINT64_MAX, max = 0, sum = 0;
+	uint32_t i;
+
+	latency = play_sample(b, "bench");
+	fprintf(stderr, "first play: %"PRIu64" us\n", latency / 1000);
+
+	for (i = 0; i < MAX_TRIGGERS; i++) {
+		latency = play_sample(b, "bench");
+		min = SPA_MIN(min, latency);
+		max = SPA_MAX(max, latency);
+		sum += latency;
+	}
+	fprintf(stderr, "play: triggers %u, latency min %"PRIu64" max %"PRIu64" avg %"PRIu64" us\n",
+			MAX_TRIGGERS, min / 1000, max / 1000, sum / MAX_TRIGGERS / 1000);
+}
+
+int main(int argc, char *argv[])
+{
+	static const char * const modules[] = {
+		"libpipewire-module-spa-node-factory",
+		"libpipewire-module-client-node",
+		"libpipewire-module-adapter",
+		NULL
+	};
+	struct data d;
+
+	pw_init(&argc, &argv);
+
+	spa_zero(d);
+	bench_init(&d.b, modules);
+
+	pw_thread_loop_lock(d.b.loop);
+	make_sink(&d);
+	pw_thread_loop_unlock(d.b.loop);
+
+	bench_connect(&d.b, NULL);
+	upload_sample(&d.b, "bench");
+	run_play(&d.b);
+	bench_disconnect(&d.b);
+
+	pw_thread_loop_lock(d.b.loop);
+	spa_hook_remove(&d.context_listener);
+	pw_loop_destroy_source(pw_thread_loop_get_loop(d.b.loop), d.link_event);
+	pw_impl_node_destroy(d.sink);
+	pw_thread_loop_unlock(d.b.loop);
+
+	bench_clear(&d.b);
+	return 0;
+}
@@ -0,0 +1,770 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PULSE_BENCHMARK_H
+#define PULSE_BENCHMARK_H
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <spa/node/node.h>
+#include <spa/node/utils.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/param/props.h>
+#include <spa/pod/filter.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
+
+#include "defs.h"
+
+/* The benchmarks load the pulse module in a context of their own and talk
+ * to it over its socket like a pulseaudio client does. The server runs in
+ * a thread loop, the client is the main thread with a blocking socket. The
+ * graph is made of nodes that only announce their params and ports. */
+
+#define BENCH_VERSION		13
+#define BENCH_MAX_PORTS		2
+#define BENCH_MAX_MESSAGE	(64 * 1024)
+
+struct bench_node {
+	struct spa_node node;
+	struct spa_hook_list hooks;
+	struct pw_impl_node *impl;
+	uint32_t id;
+
+	enum spa_direction direction;
+	struct spa_audio_info_raw info;
+	float volumes[SPA_AUDIO_MAX_CHANNELS];
+	bool mute;
+
+	struct spa_node_info node_info;
+	struct spa_param_info params[3];
+	struct spa_port_info port_info;
+};
+
+struct bench {
+	struct pw_thread_loop *loop;
+	struct pw_context *context;
+	char dir[64];
+
+	int fd;
+	uint32_t tag;
+
+	uint8_t message[BENCH_MAX_MESSAGE];
+	uint32_t length;
+
+	/* the last packet that was read */
+	uint8_t *packet;
+	uint32_t packet_size;
+	uint32_t packet_length;
+	uint32_t channel;
+};
+
+/* a reply or event, walked one tag at a time */
+struct bench_reply {
+	const uint8_t *data;
+	uint32_t length;
+	uint32_t offset;
+};
+
+static inline uint64_t bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static int bench_node_add_listener(void *object, struct spa_hook *listener,
+		const struct spa_node_events *events, void *data)
+{
+	struct bench_node *n = object;
+	struct spa_hook_list save;
+	uint32_t i;
+
+	spa_hook_list_isolate(&n->hooks, &save, listener, events, data);
+
+	n->node_info.change_mask = SPA_NODE_CHANGE_MASK_FLAGS |
+		SPA_NODE_CHANGE_MASK_PARAMS;
+	spa_node_emit_info(&n->hooks, &n->node_info);
+	n->node_info.change_mask = 0;
+
+	n->port_info.change_mask = SPA_PORT_CHANGE_MASK_FLAGS;
+	for (i = 0; i < BENCH_MAX_PORTS; i++)
+		spa_node_emit_port_info(&n->hooks, n->direction, i, &n->port_info);
+	n->port_info.change_mask = 0;
+
+	spa_hook_list_join(&n->hooks, &save);
+	return 0;
+}
+
+static int bench_node_enum_params(void *object, int seq, uint32_t id,
+		uint32_t start, uint32_t num, const struct spa_pod *filter)
+{
+	struct bench_node *n = object;
+	struct spa_result_node_params result;
+	uint8_t buffer[1024];
+	struct spa_pod_builder b;
+	struct spa_pod *param;
+
+	if (start > 0 || num == 0)
+		return 0;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+	switch (id) {
+	case SPA_PARAM_EnumFormat:
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
+			SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_audio),
+			SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+			SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Id(4,
+							n->info.format,
+							SPA_AUDIO_FORMAT_F32P,
+							SPA_AUDIO_FORMAT_S16,
+							SPA_AUDIO_FORMAT_S32),
+			SPA_FORMAT_AUDIO_rate,     SPA_POD_CHOICE_RANGE_Int(n->info.rate, 1, INT32_MAX),
+			SPA_FORMAT_AUDIO_channels, SPA_POD_Int(n->info.channels),
+			SPA_FORMAT_AUDIO_position, SPA_POD_Array(sizeof(uint32_t),
+							SPA_TYPE_Id, n->info.channels, n->info.position));
+		break;
+	case SPA_PARAM_Format:
+		param = spa_format_audio_raw_build(&b, id, &n->info);
+		break;
+	case SPA_PARAM_Props:
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Props, id,
+			SPA_PROP_volume, SPA_POD_Float(1.0f),
+			SPA_PROP_mute, SPA_POD_Bool(n->mute),
+			SPA_PROP_channelVolumes, SPA_POD_Array(sizeof(float),
+							SPA_TYPE_Float, n->info.channels, n->volumes));
+		break;
+	default:
+		return -ENOENT;
+	}
+
+	result.id = id;
+	result.index = 0;
+	result.next = 1;
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		return 0;
+
+	spa_node_emit_result(&n->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+	return 0;
+}
+
+static int bench_node_set_param(void *object, uint32_t id, uint32_t flags,
+		const struct spa_pod *param)
+{
+	struct bench_node *n = object;
+	struct spa_pod_prop *prop;
+
+	if (id != SPA_PARAM_Props || param == NULL)
+		return -ENOTSUP;
+
+	SPA_POD_OBJECT_FOREACH((struct spa_pod_object*)param, prop) {
+		switch (prop->key) {
+		case SPA_PROP_mute:
+			spa_pod_get_bool(&prop->value, &n->mute);
+			break;
+		case SPA_PROP_channelVolumes:
+			spa_pod_copy_array(&prop->value, SPA_TYPE_Float,
+					n->volumes, SPA_AUDIO_MAX_CHANNELS);
+			break;
+		}
+	}
+
+	/* like the nodes of the server, a change of the props is announced
+	 * with the serial bit of the param info */
+	n->params[2].flags ^= SPA_PARAM_INFO_SERIAL;
+	n->node_info.change_mask = SPA_NODE_CHANGE_MASK_PARAMS;
+	spa_node_emit_info(&n->hooks, &n->node_info);
+	n->node_info.change_mask = 0;
+	return 0;
+}
+
+static int bench_node_ok(void *object)
+{
+	return 0;
+}
+
+static int bench_node_set_callbacks(void *object,
+		const struct spa_node_callbacks *callbacks, void *data)
+{
+	return 0;
+}
+
+static int bench_node_set_io(void *object, uint32_t id, void *data, size_t size)
+{
+	return 0;
+}
+
+static int bench_node_send_command(void *object, const struct spa_command *command)
+{
+	return 0;
+}
+
+static int bench_node_port_enum_params(void *object, int seq,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t id, uint32_t start, uint32_t num,
+		const struct spa_pod *filter)
+{
+	return 0;
+}
+
+static int bench_node_port_set_param(void *object,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t id, uint32_t flags, const struct spa_pod *param)
+{
+	return -ENOTSUP;
+}
+
+static int bench_node_port_use_buffers(void *object,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t flags, struct spa_buffer **buffers, uint32_t n_buffers)
+{
+	return 0;
+}
+
+static int bench_node_port_set_io(void *object,
+		enum spa_direction direction, uint32_t port_id,
+		uint32_t id, void *data, size_t size)
+{
+	return 0;
+}
+
+static const struct spa_node_methods bench_node_methods = {
+	SPA_VERSION_NODE_METHODS,
+	.add_listener = bench_node_add_listener,
+	.set_callbacks = bench_node_set_callbacks,
+	.enum_params = bench_node_enum_params,
+	.set_param = bench_node_set_param,
+	.set_io = bench_node_set_io,
+	.send_command = bench_node_send_command,
+	.port_enum_params = bench_node_port_enum_params,
+	.port_set_param = bench_node_port_set_param,
+	.port_use_buffers = bench_node_port_use_buffers,
+	.port_set_io = bench_node_port_set_io,
+	.process = bench_node_ok,
+};
+
+/* add a node with \a props and BENCH_MAX_PORTS ports in \a direction that
+ * take the format of \a info. Call with the loop locked. */
+static inline struct bench_node *bench_node_new(struct bench *b,
+		enum spa_direction direction, const struct spa_audio_info_raw *info,
+		struct pw_properties *props)
+{
+	struct bench_node *n;
+	uint32_t i;
+
+	n = calloc(1, sizeof(*n));
+	spa_assert(n != NULL);
+
+	n->node.iface = SPA_INTERFACE_INIT(SPA_TYPE_INTERFACE_Node,
+			SPA_VERSION_NODE, &bench_node_methods, n);
+	spa_hook_list_init(&n->hooks);
+	n->direction = direction;
+	n->info = *info;
+	for (i = 0; i < n->info.channels; i++)
+		n->volumes[i] = 1.0f;
+
+	n->node_info = SPA_NODE_INFO_INIT();
+	if (direction == SPA_DIRECTION_INPUT)
+		n->node_info.max_input_ports = BENCH_MAX_PORTS;
+	else
+		n->node_info.max_output_ports = BENCH_MAX_PORTS;
+	n->params[0] = SPA_PARAM_INFO(SPA_PARAM_EnumFormat, SPA_PARAM_INFO_READ);
+	n->params[1] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_READ);
+	n->params[2] = SPA_PARAM_INFO(SPA_PARAM_Props, SPA_PARAM_INFO_READWRITE);
+	n->node_info.params = n->params;
+	n->node_info.n_params = SPA_N_ELEMENTS(n->params);
+	n->port_info = SPA_PORT_INFO_INIT();
+
+	n->impl = pw_context_create_node(b->context, props, 0);
+	spa_assert(n->impl != NULL);
+	spa_assert(pw_impl_node_set_implementation(n->impl, &n->node) >= 0);
+	spa_assert(pw_impl_node_register(n->impl, NULL) >= 0);
+	n->id = pw_global_get_id(pw_impl_node_get_global(n->impl));
+	return n;
+}
+
+static inline void bench_node_free(struct bench_node *n)
+{
+	pw_impl_node_destroy(n->impl);
+	free(n);
+}
+
+/* link the ports of \a out to the ports of \a in, like the session manager
+ * does. The nodes are not active, the links are never negotiated. Call
+ * with the loop locked. */
+static inline void bench_link(struct bench *b, struct bench_node *out, struct bench_node *in)
+{
+	struct pw_impl_port *op, *ip;
+	struct pw_impl_link *link;
+	struct pw_properties *props;
+	uint32_t i;
+
+	for (i = 0; i < BENCH_MAX_PORTS; i++) {
+		op = pw_impl_node_find_port(out->impl, PW_DIRECTION_OUTPUT, i);
+		ip = pw_impl_node_find_port(in->impl, PW_DIRECTION_INPUT, i);
+		spa_assert(op != NULL && ip != NULL);
+
+		props = pw_properties_new(NULL, NULL);
+		pw_properties_setf(props, PW_KEY_LINK_OUTPUT_NODE, "%u", out->id);
+		pw_properties_setf(props, PW_KEY_LINK_INPUT_NODE, "%u", in->id);
+
+		link = pw_context_create_link(b->context, op, ip, NULL, props, 0);
+		spa_assert(link != NULL);
+		spa_assert(pw_impl_link_register(link, NULL) >= 0);
+	}
+}
+
+static inline void bench_put(struct bench *b, const void *data, uint32_t size)
+{
+	spa_assert(b->length + size <= sizeof(b->message));
+	memcpy(&b->message[b->length], data, size);
+	b->length += size;
+}
+
+static inline void bench_put_u8(struct bench *b, uint8_t tag, uint8_t val)
+{
+	bench_put(b, &tag, 1);
+	bench_put(b, &val, 1);
+}
+
+static inline void bench_put_u32(struct bench *b, uint32_t val)
+{
+	uint8_t tag = 'L';
+	val = htonl(val);
+	bench_put(b, &tag, 1);
+	bench_put(b, &val, 4);
+}
+
+static inline void bench_put_string(struct bench *b, const char *str)
+{
+	uint8_t tag = str ? 't' : 'N';
+	bench_put(b, &tag, 1);
+	if (str)
+		bench_put(b, str, strlen(str) + 1);
+}
+
+static inline void bench_put_arbitrary(struct bench *b, const void *data, uint32_t size)
+{
+	uint8_t tag = 'x';
+	uint32_t len = htonl(size);
+	bench_put(b, &tag, 1);
+	bench_put(b, &len, 4);
+	bench_put(b, data, size);
+}
+
+static inline void bench_put_proplist(struct bench *b, const struct spa_dict *dict)
+{
+	const struct spa_dict_item *it;
+	uint8_t tag = 'P';
+
+	bench_put(b, &tag, 1);
+	spa_dict_for_each(it, dict) {
+		uint32_t size = strlen(it->value) + 1;
+		bench_put_string(b, it->key);
+		bench_put_u32(b, size);
+		bench_put_arbitrary(b, it->value, size);
+	}
+	bench_put_string(b, NULL);
+}
+
+static inline void bench_put_sample_spec(struct bench *b, uint8_t format,
+		uint8_t channels, uint32_t rate)
+{
+	uint8_t tag = 'a';
+	rate = htonl(rate);
+	bench_put(b, &tag, 1);
+	bench_put(b, &format, 1);
+	bench_put(b, &channels, 1);
+	bench_put(b, &rate, 4);
+}
+
+static inline void bench_put_channel_map(struct bench *b, uint8_t channels,
+		const uint8_t *map)
+{
+	uint8_t tag = 'm';
+	bench_put(b, &tag, 1);
+	bench_put(b, &channels, 1);
+	bench_put(b, map, channels);
+}
+
+static inline void bench_put_cvolume(struct bench *b, uint8_t channels, uint32_t volume)
+{
+	uint8_t tag = 'v', i;
+	bench_put(b, &tag, 1);
+	bench_put(b, &channels, 1);
+	volume = htonl(volume);
+	for (i = 0; i < channels; i++)
+		bench_put(b, &volume, 4);
+}
+
+/* start a request, returns its tag */
+static inline uint32_t bench_start(struct bench *b, uint32_t command)
+{
+	b->length = 0;
+	bench_put_u32(b, command);
+	bench_put_u32(b, ++b->tag);
+	return b->tag;
+}
+
+static inline void bench_write(struct bench *b, const void *data, size_t size)
+{
+	const uint8_t *p = data;
+	ssize_t res;
+
+	while (size > 0) {
+		res = write(b->fd, p, size);
+		if (res < 0 && errno == EINTR)
+			continue;
+		spa_assert(res > 0);
+		p += res;
+		size -= res;
+	}
+}
+
+static inline void bench_read_data(struct bench *b, void *data, size_t size)
+{
+	uint8_t *p = data;
+	ssize_t res;
+
+	while (size > 0) {
+		res = read(b->fd, p, size);
+		if (res < 0 && errno == EINTR)
+			continue;
+		spa_assert(res > 0);
+		p += res;
+		size -= res;
+	}
+}
+
+static inline void bench_send_packet(struct bench *b, uint32_t channel,
+		const void *data, uint32_t size)
+{
+	uint32_t desc[5];
+
+	desc[0] = htonl(size);
+	desc[1] = htonl(channel);
+	desc[2] = 0;
+	desc[3] = 0;
+	desc[4] = 0;
+	bench_write(b, desc, sizeof(desc));
+	bench_write(b, data, size);
+}
+
+static inline void bench_send(struct bench *b)
+{
+	bench_send_packet(b, -1, b->message, b->length);
+}
+
+/* read the next packet, a command with its tag or a memblock */
+static inline void bench_read(struct bench *b)
+{
+	uint32_t desc[5];
+
+	bench_read_data(b, desc, sizeof(desc));
+	b->packet_length = ntohl(desc[0]);
+	b->channel = ntohl(desc[1]);
+
+	if (b->packet_length > b->packet_size) {
+		b->packet = realloc(b->packet, b->packet_length);
+		spa_assert(b->packet != NULL);
+		b->packet_size = b->packet_length;
+	}
+	bench_read_data(b, b->packet, b->packet_length);
+}
+
+static inline int bench_skip(struct bench_reply *r);
+
+static inline int bench_get_tag(struct bench_reply *r, uint8_t *tag)
+{
+	if (r->offset + 1 > r->length)
+		return -EPROTO;
+	*tag = r->data[r->offset++];
+	return 0;
+}
+
+static inline int bench_get_u32(struct bench_reply *r, uint32_t *val)
+{
+	uint8_t tag;
+
+	if (bench_get_tag(r, &tag) < 0 || tag != 'L' || r->offset + 4 > r->length)
+		return -EPROTO;
+	memcpy(val, &r->data[r->offset], 4);
+	*val = ntohl(*val);
+	r->offset += 4;
+	return 0;
+}
+
+static inline int bench_get_string(struct bench_reply *r, const char **str)
+{
+	uint8_t tag;
+	size_t len;
+
+	if (bench_get_tag(r, &tag) < 0)
+		return -EPROTO;
+	if (tag == 'N') {
+		*str = NULL;
+		return 0;
+	}
+	if (tag != 't')
+		return -EPROTO;
+	len = strnlen((const char *)&r->data[r->offset], r->length - r->offset);
+	if (r->offset + len >= r->length)
+		return -EPROTO;
+	*str = (const char *)&r->data[r->offset];
+	r->offset += len + 1;
+	return 0;
+}
+
+static inline int bench_get_channel_map(struct bench_reply *r, uint8_t *channels)
+{
+	uint8_t tag;
+
+	if (bench_get_tag(r, &tag) < 0 || tag != 'm' || r->offset + 1 > r->length)
+		return -EPROTO;
+	*channels = r->data[r->offset];
+	r->offset--;
+	return bench_skip(r);
+}
+
+static inline int bench_skip_bytes(struct bench_reply *r, uint32_t size)
+{
+	if (r->offset + size > r->length)
+		return -EPROTO;
+	r->offset += size;
+	return 0;
+}
+
+static inline int bench_skip(struct bench_reply *r)
+{
+	const char *str;
+	uint32_t size;
+	uint8_t tag;
+
+	if (bench_get_tag(r, &tag) < 0)
+		return -EPROTO;
+
+	switch (tag) {
+	case 't':
+		r->offset--;
+		return bench_get_string(r, &str);
+	case 'N': case '1': case '0':
+		return 0;
+	case 'B':
+		return bench_skip_bytes(r, 1);
+	case 'L': case 'V':
+		return bench_skip_bytes(r, 4);
+	case 'R': case 'r': case 'U': case 'T':
+		return bench_skip_bytes(r, 8);
+	case 'a':
+		return bench_skip_bytes(r, 6);
+	case 'x':
+		if (r->offset + 4 > r->length)
+			return -EPROTO;
+		memcpy(&size, &r->data[r->offset], 4);
+		return bench_skip_bytes(r, 4 + ntohl(size));
+	case 'm':
+		if (r->offset + 1 > r->length)
+			return -EPROTO;
+		return bench_skip_bytes(r, 1 + r->data[r->offset]);
+	case 'v':
+		if (r->offset + 1 > r->length)
+			return -EPROTO;
+		return bench_skip_bytes(r, 1 + 4 * r->data[r->offset]);
+	case 'P':
+		while (true) {
+			if (bench_get_string(r, &str) < 0)
+				return -EPROTO;
+			if (str == NULL)
+				return 0;
+			if (bench_skip(r) < 0 || bench_skip(r) < 0)
+				return -EPROTO;
+		}
+	case 'f':
+		if (bench_skip(r) < 0)
+			return -EPROTO;
+		return bench_skip(r);
+	}
+	return -EPROTO;
+}
+
+static inline int bench_skip_n(struct bench_reply *r, uint32_t n)
+{
+	while (n-- > 0)
+		if (bench_skip(r) < 0)
+			return -EPROTO;
+	return 0;
+}
+
+/* read packets until the next command, memblocks are skipped */
+static inline void bench_next(struct bench *b, struct bench_reply *r,
+		uint32_t *command, uint32_t *tag)
+{
+	do {
+		bench_read(b);
+	} while (b->channel != (uint32_t)-1);
+
+	r->data = b->packet;
+	r->length = b->packet_length;
+	r->offset = 0;
+	spa_assert(bench_get_u32(r, command) == 0);
+	spa_assert(bench_get_u32(r, tag) == 0);
+}
+
+static inline void bench_check_reply(uint32_t tag, uint32_t command, struct bench_reply *r)
+{
+	uint32_t error = 0;
+
+	if (command == COMMAND_ERROR) {
+		bench_get_u32(r, &error);
+		fprintf(stderr, "request %u failed: error %u\n", tag, error);
+	}
+	spa_assert(command == COMMAND_REPLY);
+}
+
+/* read commands until the reply to \a tag, the commands before it, like
+ * events, are passed to \a func when it is not NULL */
+static inline void bench_wait(struct bench *b, uint32_t tag, struct bench_reply *reply,
+		void (*func) (void *data, uint32_t command, struct bench_reply *r), void *data)
+{
+	uint32_t command, t;
+
+	while (true) {
+		bench_next(b, reply, &command, &t);
+		if (t == tag) {
+			bench_check_reply(tag, command, reply);
+			return;
+		}
+		if (func != NULL)
+			func(data, command, reply);
+	}
+}
+
+static inline void bench_request(struct bench *b, struct bench_reply *reply)
+{
+	uint32_t tag = b->tag;
+	bench_send(b);
+	bench_wait(b, tag, reply, NULL, NULL);
+}
+
+/* make a context with the pulse module and the modules in \a modules */
+static inline void bench_init(struct bench *b, const char * const *modules)
+{
+	const char *args = "{ server.address = [ \"unix:native\" ] }";
+
+	spa_zero(*b);
+	b->fd = -1;
+
+	/* the socket is made in pulse/ of the runtime dir */
+	snprintf(b->dir, sizeof(b->dir), "/tmp/pw-benchmark-pulse-XXXXXX");
+	spa_assert(mkdtemp(b->dir) != NULL);
+	setenv("PULSE_RUNTIME_PATH", b->dir, 1);
+
+	b->loop = pw_thread_loop_new("benchmark", NULL);
+	spa_assert(b->loop != NULL);
+	b->context = pw_context_new(pw_thread_loop_get_loop(b->loop),
+			pw_properties_new(
+				PW_KEY_CONFIG_NAME, "null",
+				NULL), 0);
+	spa_assert(b->context != NULL);
+
+	spa_assert(pw_context_load_module(b->context,
+			"libpipewire-module-protocol-native", NULL, NULL) != NULL);
+	for (; modules && *modules; modules++)
+		spa_assert(pw_context_load_module(b->context, *modules, NULL, NULL) != NULL);
+	spa_assert(pw_context_load_module(b->context,
+			"libpipewire-module-protocol-pulse", args, NULL) != NULL);
+
+	spa_assert(pw_thread_loop_start(b->loop) >= 0);
+}
+
+/* connect, the server connects to the context of the benchmark and
+ * replies when it knows all the objects */
+static inline void bench_connect(struct bench *b, const struct spa_dict *client_props)
+{
+	struct sockaddr_un addr;
+	struct bench_reply r;
+	struct pw_properties *props;
+	uint8_t cookie[NATIVE_COOKIE_LENGTH];
+
+	b->fd = socket(PF_LOCAL, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	spa_assert(b->fd >= 0);
+
+	spa_zero(addr);
+	addr.sun_family = AF_LOCAL;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/pulse/native", b->dir);
+	spa_assert(connect(b->fd, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+
+	memset(cookie, 0, sizeof(cookie));
+	bench_start(b, COMMAND_AUTH);
+	bench_put_u32(b, BENCH_VERSION);
+	bench_put_arbitrary(b, cookie, sizeof(cookie));
+	bench_request(b, &r);
+
+	props = pw_properties_new(
+			PW_KEY_APP_NAME, "benchmark",
+			PW_KEY_REMOTE_NAME, "internal",
+			NULL);
+	if (client_props)
+		pw_properties_update(props, client_props);
+	bench_start(b, COMMAND_SET_CLIENT_NAME);
+	bench_put_proplist(b, &props->dict);
+	bench_request(b, &r);
+	pw_properties_free(props);
+}
+
+static inline void bench_disconnect(struct bench *b)
+{
+	if (b->fd >= 0)
+		close(b->fd);
+	b->fd = -1;
+}
+
+static inline void bench_clear(struct bench *b)
+{
+	char path[128];
+
+	bench_disconnect(b);
+	pw_thread_loop_stop(b->loop);
+	pw_context_destroy(b->context);
+	pw_thread_loop_destroy(b->loop);
+	free(b->packet);
+
+	snprintf(path, sizeof(path), "%s/pulse", b->dir);
+	rmdir(path);
+	rmdir(b->dir);
+}
+
+#endif /* PULSE_BENCHMARK_H */
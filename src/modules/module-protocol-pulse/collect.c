@@ -24,50 +24,32 @@
 
 static bool object_is_client(struct pw_manager_object *o)
 {
-	return strcmp(o->type, PW_TYPE_INTERFACE_Client) == 0;
+	return SPA_FLAG_IS_SET(o->classes, PW_MANAGER_CLASS_MASK(CLIENT));
 }
 
 static bool object_is_module(struct pw_manager_object *o)
 {
-	return strcmp(o->type, PW_TYPE_INTERFACE_Module) == 0;
+	return SPA_FLAG_IS_SET(o->classes, PW_MANAGER_CLASS_MASK(MODULE));
 }
 
 static bool object_is_card(struct pw_manager_object *o)
 {
-	const char *str;
-	return strcmp(o->type, PW_TYPE_INTERFACE_Device) == 0 &&
-		o->props != NULL &&
-		(str = pw_properties_get(o->props, PW_KEY_MEDIA_CLASS)) != NULL &&
-		strcmp(str, "Audio/Device") == 0;
+	return SPA_FLAG_IS_SET(o->classes, PW_MANAGER_CLASS_MASK(CARD));
 }
 
 static bool object_is_sink(struct pw_manager_object *o)
 {
-	const char *str;
-	return strcmp(o->type, PW_TYPE_INTERFACE_Node) == 0 &&
-		o->props != NULL &&
-		(str = pw_properties_get(o->props, PW_KEY_MEDIA_CLASS)) != NULL &&
-		(strcmp(str, "Audio/Sink") == 0 || strcmp(str, "Audio/Duplex") == 0);
+	return SPA_FLAG_IS_SET(o->classes, PW_MANAGER_CLASS_MASK(SINK));
 }
 
 static bool object_is_source(struct pw_manager_object *o)
 {
-	const char *str;
-	return strcmp(o->type, PW_TYPE_INTERFACE_Node) == 0 &&
-		o->props != NULL &&
-		(str = pw_properties_get(o->props, PW_KEY_MEDIA_CLASS)) != NULL &&
-		(strcmp(str, "Audio/Source") == 0 ||
-		 strcmp(str, "Audio/Duplex") == 0 ||
-		 strcmp(str, "Audio/Source/Virtual") == 0);
+	return SPA_FLAG_IS_SET(o->classes, PW_MANAGER_CLASS_MASK(SOURCE));
 }
 
 static bool object_is_monitor(struct pw_manager_object *o)
 {
-	const char *str;
-	return strcmp(o->type, PW_TYPE_INTERFACE_Node) == 0 &&
-		o->props != NULL &&
-		(str = pw_properties_get(o->props, PW_KEY_MEDIA_CLASS)) != NULL &&
-		(strcmp(str, "Audio/Sink") == 0);
+	return SPA_FLAG_IS_SET(o->classes, PW_MANAGER_CLASS_MASK(MONITOR));
 }
 
 static bool object_is_source_or_monitor(struct pw_manager_object *o)
@@ -77,20 +59,12 @@ static bool object_is_source_or_monitor(struct pw_manager_object *o)
 
 static bool object_is_sink_input(struct pw_manager_object *o)
 {
-	const char *str;
-	return strcmp(o->type, PW_TYPE_INTERFACE_Node) == 0 &&
-		o->props != NULL &&
-		(str = pw_properties_get(o->props, PW_KEY_MEDIA_CLASS)) != NULL &&
-		strcmp(str, "Stream/Output/Audio") == 0;
+	return SPA_FLAG_IS_SET(o->classes, PW_MANAGER_CLASS_MASK(SINK_INPUT));
 }
 
 static bool object_is_source_output(struct pw_manager_object *o)
 {
-	const char *str;
-	return strcmp(o->type, PW_TYPE_INTERFACE_Node) == 0 &&
-		o->props != NULL &&
-		(str = pw_properties_get(o->props, PW_KEY_MEDIA_CLASS)) != NULL &&
-		strcmp(str, "Stream/Input/Audio") == 0;
+	return SPA_FLAG_IS_SET(o->classes, PW_MANAGER_CLASS_MASK(SOURCE_OUTPUT));
 }
 
 static bool object_is_recordable(struct pw_manager_object *o)
@@ -100,7 +74,36 @@ static bool object_is_recordable(struct pw_manager_object *o)
 
 static bool object_is_link(struct pw_manager_object *o)
 {
-	return strcmp(o->type, PW_TYPE_INTERFACE_Link) == 0;
+	return SPA_FLAG_IS_SET(o->classes, PW_MANAGER_CLASS_MASK(LINK));
+}
+
+/* the classes to look in for each of the object types */
+static const struct {
+	bool (*type) (struct pw_manager_object *o);
+	uint32_t classes;
+} type_classes[] = {
+	{ object_is_client, PW_MANAGER_CLASS_MASK(CLIENT) },
+	{ object_is_module, PW_MANAGER_CLASS_MASK(MODULE) },
+	{ object_is_card, PW_MANAGER_CLASS_MASK(CARD) },
+	{ object_is_sink, PW_MANAGER_CLASS_MASK(SINK) },
+	{ object_is_source, PW_MANAGER_CLASS_MASK(SOURCE) },
+	{ object_is_monitor, PW_MANAGER_CLASS_MASK(MONITOR) },
+	{ object_is_source_or_monitor, PW_MANAGER_CLASS_MASK(SOURCE) |
+		PW_MANAGER_CLASS_MASK(MONITOR) },
+	{ object_is_sink_input, PW_MANAGER_CLASS_MASK(SINK_INPUT) },
+	{ object_is_source_output, PW_MANAGER_CLASS_MASK(SOURCE_OUTPUT) },
+	{ object_is_recordable, PW_MANAGER_CLASS_MASK(SOURCE) |
+		PW_MANAGER_CLASS_MASK(SINK) | PW_MANAGER_CLASS_MASK(SINK_INPUT) },
+	{ object_is_link, PW_MANAGER_CLASS_MASK(LINK) },
+};
+
+static uint32_t object_type_classes(bool (*type) (struct pw_manager_object *o))
+{
+	size_t i;
+	for (i = 0; i < SPA_N_ELEMENTS(type_classes); i++)
+		if (type_classes[i].type == type)
+			return type_classes[i].classes;
+	return 0;
 }
 
 struct selector {
@@ -128,60 +131,78 @@ static void select_best(struct selector *s, struct pw_manager_object *o)
 	}
 }
 
+static int select_match(void *data, struct pw_manager_object *o)
+{
+	struct selector *s = data;
+	const char *str;
+
+	if (o->removing)
+		return 0;
+	if (s->type != NULL && !s->type(o))
+		return 0;
+	if (o->id == s->id)
+		goto found;
+	if (s->accumulate)
+		s->accumulate(s, o);
+	if (o->props && s->key != NULL && s->value != NULL &&
+	    (str = pw_properties_get(o->props, s->key)) != NULL &&
+	    strcmp(str, s->value) == 0)
+		goto found;
+	if (s->value != NULL && (uint32_t)atoi(s->value) == o->id)
+		goto found;
+	return 0;
+found:
+	s->best = o;
+	return 1;
+}
+
 static struct pw_manager_object *select_object(struct pw_manager *m,
 		struct selector *s)
 {
 	struct pw_manager_object *o;
-	const char *str;
-
-	spa_list_for_each(o, &m->object_list, link) {
-		if (o->creating || o->removing)
-			continue;
-		if (s->type != NULL && !s->type(o))
-			continue;
-		if (o->id == s->id)
-			return o;
-		if (s->accumulate)
-			s->accumulate(s, o);
-		if (o->props && s->key != NULL && s->value != NULL &&
-		    (str = pw_properties_get(o->props, s->key)) != NULL &&
-		    strcmp(str, s->value) == 0)
-			return o;
-		if (s->value != NULL && (uint32_t)atoi(s->value) == o->id)
-			return o;
+	uint32_t classes;
+
+	/* a lookup by id only needs the index */
+	if (s->id != SPA_ID_INVALID && s->key == NULL && s->value == NULL &&
+	    s->accumulate == NULL) {
+		if ((o = pw_manager_find_object(m, s->id)) == NULL ||
+		    (s->type != NULL && !s->type(o)))
+			return NULL;
+		return o;
 	}
+	if (s->type != NULL && (classes = object_type_classes(s->type)) != 0)
+		pw_manager_for_each_object_of_class(m, classes, select_match, s);
+	else
+		pw_manager_for_each_object(m, select_match, s);
 	return s->best;
 }
 
-static struct pw_manager_object *find_linked(struct pw_manager *m, uint32_t obj_id, enum pw_direction direction)
+struct find_linked_data {
+	struct pw_manager *manager;
+	bool (*type) (struct pw_manager_object *o);
+	struct pw_manager_object *result;
+};
+
+static int find_linked_peer(void *data, struct pw_manager_object *link, uint32_t peer_id)
 {
-	struct pw_manager_object *o, *p;
-	const char *str;
-	uint32_t in_node, out_node;
+	struct find_linked_data *d = data;
+	struct pw_manager_object *p;
 
-	spa_list_for_each(o, &m->object_list, link) {
-		if (o->props == NULL || !object_is_link(o))
-			continue;
+	if ((p = pw_manager_find_object(d->manager, peer_id)) == NULL || !d->type(p))
+		return 0;
+	d->result = p;
+	return 1;
+}
 
-		if ((str = pw_properties_get(o->props, PW_KEY_LINK_OUTPUT_NODE)) == NULL)
-                        continue;
-		out_node = pw_properties_parse_int(str);
-                if ((str = pw_properties_get(o->props, PW_KEY_LINK_INPUT_NODE)) == NULL)
-                        continue;
-		in_node = pw_properties_parse_int(str);
-
-		if (direction == PW_DIRECTION_OUTPUT && obj_id == out_node) {
-			struct selector sel = { .id = in_node, .type = object_is_sink, };
-			if ((p = select_object(m, &sel)) != NULL)
-				return p;
-		}
-		if (direction == PW_DIRECTION_INPUT && obj_id == in_node) {
-			struct selector sel = { .id = out_node, .type = object_is_recordable, };
-			if ((p = select_object(m, &sel)) != NULL)
-				return p;
-		}
-	}
-	return NULL;
+static struct pw_manager_object *find_linked(struct pw_manager *m, uint32_t obj_id, enum pw_direction direction)
+{
+	struct find_linked_data d = {
+		.manager = m,
+		.type = direction == PW_DIRECTION_OUTPUT ?
+			object_is_sink : object_is_recordable,
+	};
+	pw_manager_for_each_link(m, obj_id, direction, find_linked_peer, &d);
+	return d.result;
 }
 
 struct card_info {
@@ -333,10 +354,46 @@ struct device_info {
 				.active_port = SPA_ID_INVALID,		\
 			}
 
+/* the format of a device, parsed from the params when they changed */
+struct format_cache {
+	uint32_t param_seq;
+	unsigned int valid:1;
+	unsigned int have_format:1;
+	struct sample_spec ss;
+	struct channel_map map;
+};
+
+static void parse_device_format(struct pw_manager_object *device, struct format_cache *fc)
+{
+	struct pw_manager_param *p;
+
+	fc->have_format = false;
+	spa_list_for_each(p, &device->param_list, link) {
+		switch (p->id) {
+		case SPA_PARAM_EnumFormat:
+		{
+			struct spa_pod *copy = spa_pod_copy(p->param);
+			spa_pod_fixate(copy);
+			if (format_parse_param(copy, &fc->ss, &fc->map) >= 0)
+				fc->have_format = true;
+			free(copy);
+			break;
+		}
+		case SPA_PARAM_Format:
+			if (format_parse_param(p->param, &fc->ss, &fc->map) >= 0)
+				fc->have_format = true;
+			break;
+		}
+	}
+	fc->param_seq = device->param_seq;
+	fc->valid = true;
+}
+
 static void collect_device_info(struct pw_manager_object *device,
 		struct pw_manager_object *card, struct device_info *dev_info)
 {
 	struct pw_manager_param *p;
+	struct format_cache *fc;
 
 	if (card) {
 		spa_list_for_each(p, &card->param_list, link) {
@@ -362,25 +419,22 @@ static void collect_device_info(struct pw_manager_object *device,
 		}
 	}
 
-	spa_list_for_each(p, &device->param_list, link) {
-		switch (p->id) {
-		case SPA_PARAM_EnumFormat:
-		{
-			struct spa_pod *copy = spa_pod_copy(p->param);
-			spa_pod_fixate(copy);
-			format_parse_param(copy, &dev_info->ss, &dev_info->map);
-			free(copy);
-			break;
+	if ((fc = pw_manager_object_add_data(device, "format_cache",
+				sizeof(struct format_cache))) != NULL) {
+		if (!fc->valid || fc->param_seq != device->param_seq)
+			parse_device_format(device, fc);
+		if (fc->have_format) {
+			dev_info->ss = fc->ss;
+			dev_info->map = fc->map;
 		}
-		case SPA_PARAM_Format:
-			format_parse_param(p->param, &dev_info->ss, &dev_info->map);
-			break;
+	}
 
-		case SPA_PARAM_Props:
-			if (!dev_info->have_volume) {
-				volume_parse_param(p->param, &dev_info->volume_info);
-				dev_info->have_volume = true;
-			}
+	if (!dev_info->have_volume) {
+		spa_list_for_each(p, &device->param_list, link) {
+			if (p->id != SPA_PARAM_Props)
+				continue;
+			volume_parse_param(p->param, &dev_info->volume_info);
+			dev_info->have_volume = true;
 			break;
 		}
 	}
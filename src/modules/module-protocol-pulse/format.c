@@ -95,36 +95,6 @@ static inline uint32_t format_pa2id(enum sample_format format)
 	return audio_formats[format].id;
 }
 
-static inline const char *format_id2name(uint32_t format)
-{
-	int i;
-	for (i = 0; spa_type_audio_format[i].name; i++) {
-		if (spa_type_audio_format[i].type == format)
-			return spa_debug_type_short_name(spa_type_audio_format[i].name);
-	}
-	return "UNKNOWN";
-}
-
-static inline uint32_t format_paname2id(const char *name, size_t size)
-{
-	size_t i;
-	for (i = 0; i < SAMPLE_MAX; i++) {
-		if (strncmp(name, audio_formats[i].name, size) == 0)
-			return audio_formats[i].id;
-	}
-	return SPA_AUDIO_FORMAT_UNKNOWN;
-}
-
-static inline enum sample_format format_id2pa(uint32_t id)
-{
-	size_t i;
-	for (i = 0; i < SPA_N_ELEMENTS(audio_formats); i++) {
-		if (id == audio_formats[i].id)
-			return audio_formats[i].pa;
-	}
-	return SAMPLE_INVALID;
-}
-
 struct sample_spec {
 	uint32_t format;
 	uint32_t rate;
@@ -327,47 +297,194 @@ static inline uint32_t channel_pa2id(enum channel_position channel)
         return audio_channels[channel].channel;
 }
 
-static inline const char *channel_id2name(uint32_t channel)
+/* reverse lookups for the tables above and for the SPA type names. They
+ * are filled on first use and map ids and names in constant time, the
+ * introspection replies do these for every object and channel. */
+#define FORMAT_SLOTS		(3 * 64)
+#define CHANNEL_SLOTS		(64 + 33)
+#define NAME_TABLE_SIZE		128
+
+struct id_lookup {
+	int8_t pa;
+	const char *name;
+};
+
+struct name_entry {
+	const char *name;
+	uint32_t len;
+	uint32_t id;
+};
+
+struct name_table {
+	struct name_entry entries[NAME_TABLE_SIZE];
+};
+
+static struct format_tables {
+	bool initialized;
+	struct id_lookup formats[FORMAT_SLOTS];
+	struct id_lookup channels[CHANNEL_SLOTS];
+	struct name_table format_panames;
+	struct name_table channel_panames;
+	struct name_table channel_names;
+} format_tables;
+
+/* interleaved and planar formats with the low byte of the id */
+static inline int format_slot(uint32_t id)
 {
-	int i;
-	for (i = 0; spa_type_audio_channel[i].name; i++) {
-		if (spa_type_audio_channel[i].type == channel)
-			return spa_debug_type_short_name(spa_type_audio_channel[i].name);
+	if ((id & 0xff) >= 64 || (id >> 8) >= 3)
+		return -1;
+	return (id >> 8) * 64 + (id & 0xff);
+}
+
+/* the positions and the custom positions we use for the aux channels */
+static inline int channel_slot(uint32_t id)
+{
+	if (id < 64)
+		return id;
+	if (id >= SPA_AUDIO_CHANNEL_CUSTOM_START &&
+	    id - SPA_AUDIO_CHANNEL_CUSTOM_START < 33)
+		return 64 + id - SPA_AUDIO_CHANNEL_CUSTOM_START;
+	return -1;
+}
+
+static inline uint32_t name_hash(const char *name, size_t len)
+{
+	uint32_t h = 2166136261u;
+	while (len--)
+		h = (h ^ (uint8_t)*name++) * 16777619u;
+	return h;
+}
+
+/* the first name that is added wins, like in a scan of the table */
+static void name_table_add(struct name_table *t, const char *name, uint32_t id)
+{
+	size_t len = strlen(name);
+	uint32_t i = name_hash(name, len);
+	struct name_entry *e;
+
+	while ((e = &t->entries[i++ & (NAME_TABLE_SIZE - 1)])->name != NULL) {
+		if (e->len == len && memcmp(e->name, name, len) == 0)
+			return;
 	}
-	return "UNK";
+	*e = (struct name_entry) { name, len, id };
 }
 
-static inline uint32_t channel_name2id(const char *name)
+static uint32_t name_table_find(const struct name_table *t, const char *name, size_t len,
+		uint32_t def)
 {
-	int i;
-	for (i = 0; spa_type_audio_channel[i].name; i++) {
-		if (strcmp(name, spa_debug_type_short_name(spa_type_audio_channel[i].name)) == 0)
-			return spa_type_audio_channel[i].type;
+	uint32_t i = name_hash(name, len);
+	const struct name_entry *e;
+
+	while ((e = &t->entries[i++ & (NAME_TABLE_SIZE - 1)])->name != NULL) {
+		if (e->len == len && memcmp(e->name, name, len) == 0)
+			return e->id;
 	}
-	return SPA_AUDIO_CHANNEL_UNKNOWN;
+	return def;
 }
 
-static inline enum channel_position channel_id2pa(uint32_t id, uint32_t *aux)
+static void format_tables_init(void)
 {
+	struct format_tables *t = &format_tables;
 	size_t i;
-	for (i = 0; i < SPA_N_ELEMENTS(audio_channels); i++) {
-		if (id == audio_channels[i].channel)
-			return i;
+	int slot;
+
+	for (i = 0; i < FORMAT_SLOTS; i++)
+		t->formats[i] = (struct id_lookup) { SAMPLE_INVALID, "UNKNOWN" };
+	for (i = 0; i < CHANNEL_SLOTS; i++)
+		t->channels[i] = (struct id_lookup) { CHANNEL_POSITION_INVALID, "UNK" };
+
+	/* walk the tables backwards so that the first match is kept */
+	for (i = SPA_N_ELEMENTS(spa_type_audio_format) - 1; i > 0; i--) {
+		if ((slot = format_slot(spa_type_audio_format[i-1].type)) >= 0)
+			t->formats[slot].name = spa_debug_type_short_name(spa_type_audio_format[i-1].name);
 	}
-	return CHANNEL_POSITION_AUX0 + (*aux)++;
+	for (i = SPA_N_ELEMENTS(audio_formats); i > 0; i--) {
+		if ((slot = format_slot(audio_formats[i-1].id)) >= 0)
+			t->formats[slot].pa = audio_formats[i-1].pa;
+	}
+	/* the planar names are the native endian names of the interleaved formats */
+	for (i = 0; i < SPA_N_ELEMENTS(audio_formats); i++)
+		name_table_add(&t->format_panames, audio_formats[i].name,
+				audio_formats[audio_formats[i].pa].id);
+
+	for (i = SPA_N_ELEMENTS(spa_type_audio_channel) - 1; i > 0; i--) {
+		if ((slot = channel_slot(spa_type_audio_channel[i-1].type)) >= 0)
+			t->channels[slot].name = spa_debug_type_short_name(spa_type_audio_channel[i-1].name);
+	}
+	for (i = 0; spa_type_audio_channel[i].name; i++)
+		name_table_add(&t->channel_names,
+				spa_debug_type_short_name(spa_type_audio_channel[i].name),
+				spa_type_audio_channel[i].type);
+	for (i = SPA_N_ELEMENTS(audio_channels); i > 0; i--) {
+		if ((slot = channel_slot(audio_channels[i-1].channel)) >= 0)
+			t->channels[slot].pa = i-1;
+	}
+	for (i = 0; i < SPA_N_ELEMENTS(audio_channels); i++)
+		name_table_add(&t->channel_panames, audio_channels[i].name,
+				audio_channels[i].channel);
+
+	t->initialized = true;
 }
 
+static inline struct format_tables *get_format_tables(void)
+{
+	if (SPA_UNLIKELY(!format_tables.initialized))
+		format_tables_init();
+	return &format_tables;
+}
 
-static inline uint32_t channel_paname2id(const char *name, size_t size)
+static inline const char *format_id2name(uint32_t format)
 {
-	size_t i;
-	for (i = 0; i < SPA_N_ELEMENTS(audio_channels); i++) {
-		if (strncmp(name, audio_channels[i].name, size) == 0)
-			return audio_channels[i].channel;
-	}
-	return SPA_AUDIO_CHANNEL_UNKNOWN;
+	int slot = format_slot(format);
+	if (slot < 0)
+		return "UNKNOWN";
+	return get_format_tables()->formats[slot].name;
 }
 
+static inline uint32_t format_paname2id(const char *name, size_t size)
+{
+	return name_table_find(&get_format_tables()->format_panames, name, size,
+			SPA_AUDIO_FORMAT_UNKNOWN);
+}
+
+static inline enum sample_format format_id2pa(uint32_t id)
+{
+	int slot = format_slot(id);
+	if (slot < 0)
+		return SAMPLE_INVALID;
+	return get_format_tables()->formats[slot].pa;
+}
+
+static inline const char *channel_id2name(uint32_t channel)
+{
+	int slot = channel_slot(channel);
+	if (slot < 0)
+		return "UNK";
+	return get_format_tables()->channels[slot].name;
+}
+
+static inline uint32_t channel_name2id(const char *name)
+{
+	return name_table_find(&get_format_tables()->channel_names, name, strlen(name),
+			SPA_AUDIO_CHANNEL_UNKNOWN);
+}
+
+static inline enum channel_position channel_id2pa(uint32_t id, uint32_t *aux)
+{
+	int slot = channel_slot(id);
+	enum channel_position pa;
+
+	if (slot >= 0 &&
+	    (pa = get_format_tables()->channels[slot].pa) != CHANNEL_POSITION_INVALID)
+		return pa;
+	return CHANNEL_POSITION_AUX0 + (*aux)++;
+}
+
+static inline uint32_t channel_paname2id(const char *name, size_t size)
+{
+	return name_table_find(&get_format_tables()->channel_panames, name, size,
+			SPA_AUDIO_CHANNEL_UNKNOWN);
+}
 
 static inline void channel_map_to_positions(const struct channel_map *map, uint32_t *pos)
 {
@@ -44,6 +44,11 @@ struct manager {
 	int sync_seq;
 
 	struct spa_hook_list hooks;
+
+	struct pw_map objects;			/**< objects indexed by id */
+	struct spa_list unlinked[2];		/**< links without a node, by direction */
+	struct spa_list class_list[PW_MANAGER_CLASS_LAST];	/**< objects by class */
+	uint64_t seq;				/**< order of the objects in the class lists */
 };
 
 struct object_info {
@@ -67,12 +72,24 @@ struct object {
 
 	const struct object_info *info;
 
-	struct spa_list pending_list;
+	struct pw_array pending;		/**< struct pending_param */
+	struct pw_array param_blocks;		/**< struct param_block */
 
 	struct spa_hook proxy_listener;
 	struct spa_hook object_listener;
 
 	struct spa_list data_list;
+
+	/* for links, the nodes at both ends indexed by enum pw_direction, and
+	 * the link in the links of that node */
+	uint32_t link_node[2];
+	struct spa_list link_link[2];
+	/* for nodes, the links that have the node as input or output */
+	struct spa_list links[2];
+
+	/* link in the class_list of the manager for each class in this.classes */
+	struct spa_list class_link[PW_MANAGER_CLASS_LAST];
+	uint64_t seq;
 };
 
 static void core_sync(struct manager *m)
@@ -81,102 +98,319 @@ static void core_sync(struct manager *m)
 	pw_log_debug("sync start %u", m->sync_seq);
 }
 
-static uint32_t clear_params(struct spa_list *param_list, uint32_t id)
+/* an enumerated param, waiting for the next sync to be applied, stored one
+ * after the other in the pending array of the object */
+struct pending_param {
+	uint32_t id;			/**< SPA_ID_INVALID when done or stale */
+	uint32_t size;			/**< size of the param, 0 marks the start
+					  *  of an enumeration of id */
+	/* param follows */
+};
+
+#define PENDING_SIZE(size)	SPA_ROUND_UP_N(sizeof(struct pending_param) + (size), 8)
+
+/* the memory of all params with the same id, applied together */
+struct param_block {
+	uint32_t id;
+	void *data;
+};
+
+static void *pending_append(struct object *o, uint32_t id, uint32_t size)
 {
-	struct pw_manager_param *p, *t;
-	uint32_t count = 0;
+	struct pending_param *pp;
 
-	spa_list_for_each_safe(p, t, param_list, link) {
-		if (id == SPA_ID_INVALID || p->id == id) {
-			spa_list_remove(&p->link);
-			free(p);
-			count++;
-		}
+	if ((pp = pw_array_add(&o->pending, PENDING_SIZE(size))) == NULL)
+		return NULL;
+	pp->id = id;
+	pp->size = size;
+	return SPA_MEMBER(pp, sizeof(*pp), void);
+}
+
+/* a new enumeration of id, forget the params of a previous one that was
+ * not applied yet */
+static void pending_start(struct object *o, uint32_t id)
+{
+	struct pending_param *pp;
+
+	for (pp = o->pending.data; (void*)pp < pw_array_end(&o->pending);
+	    pp = SPA_MEMBER(pp, PENDING_SIZE(pp->size), struct pending_param)) {
+		if (pp->id == id)
+			pp->id = SPA_ID_INVALID;
 	}
-	return count;
+	pending_append(o, id, 0);
 }
 
-static struct pw_manager_param *add_param(struct spa_list *params, uint32_t id, const struct spa_pod *param)
+static const struct spa_pod *pending_add(struct object *o, uint32_t id, const struct spa_pod *param)
 {
-	struct pw_manager_param *p;
+	void *data;
 
+	if (param == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
 	if (id == SPA_ID_INVALID) {
-		if (param == NULL || !spa_pod_is_object(param)) {
+		if (!spa_pod_is_object(param)) {
 			errno = EINVAL;
 			return NULL;
 		}
 		id = SPA_POD_OBJECT_ID(param);
 	}
 
-	p = malloc(sizeof(*p) + (param != NULL ? SPA_POD_SIZE(param) : 0));
-	if (p == NULL)
+	if ((data = pending_append(o, id, SPA_POD_SIZE(param))) == NULL)
 		return NULL;
-
-	p->id = id;
-	if (param != NULL) {
-		p->param = SPA_MEMBER(p, sizeof(*p), struct spa_pod);
-		memcpy(p->param, param, SPA_POD_SIZE(param));
-	} else {
-		clear_params(params, id);
-		p->param = NULL;
-	}
-	spa_list_append(params, &p->link);
-
-	return p;
+	memcpy(data, param, SPA_POD_SIZE(param));
+	return data;
 }
 
-static bool has_param(struct spa_list *param_list, struct pw_manager_param *p)
+static bool has_param(struct spa_list *param_list, uint32_t id, const struct spa_pod *param)
 {
 	struct pw_manager_param *t;
 	spa_list_for_each(t, param_list, link) {
-		if (p->id == t->id &&
-		   SPA_POD_SIZE(p->param) == SPA_POD_SIZE(t->param) &&
-		   memcmp(p->param, t->param, SPA_POD_SIZE(p->param)) == 0)
+		if (id == t->id &&
+		   SPA_POD_SIZE(param) == SPA_POD_SIZE(t->param) &&
+		   memcmp(param, t->param, SPA_POD_SIZE(param)) == 0)
 			return true;
 	}
 	return false;
 }
 
+static void clear_params(struct object *o, uint32_t id)
+{
+	struct pw_manager_param *p, *t;
+	struct param_block *b;
 
-static struct object *find_object(struct manager *m, uint32_t id)
+	spa_list_for_each_safe(p, t, &o->this.param_list, link) {
+		if (id == SPA_ID_INVALID || p->id == id)
+			spa_list_remove(&p->link);
+	}
+	for (b = o->param_blocks.data; (void*)b < pw_array_end(&o->param_blocks);) {
+		if (id == SPA_ID_INVALID || b->id == id) {
+			/* move the last block in its place */
+			free(b->data);
+			o->param_blocks.size -= sizeof(*b);
+			*b = *(struct param_block*)pw_array_end(&o->param_blocks);
+		} else {
+			b++;
+		}
+	}
+}
+
+/* check if the pending params of id are the same as the current ones */
+static bool params_equal(struct object *o, uint32_t id, struct pending_param *first)
 {
-	struct object *o;
-	spa_list_for_each(o, &m->this.object_list, this.link) {
-		if (o->this.creating)
+	struct pending_param *pp = first;
+	struct pw_manager_param *p;
+
+	spa_list_for_each(p, &o->this.param_list, link) {
+		if (p->id != id)
 			continue;
-		if (o->this.id == id)
-			return o;
+		for (; (void*)pp < pw_array_end(&o->pending);
+		    pp = SPA_MEMBER(pp, PENDING_SIZE(pp->size), struct pending_param))
+			if (pp->id == id && pp->size > 0)
+				break;
+		if ((void*)pp >= pw_array_end(&o->pending) ||
+		    pp->size != SPA_POD_SIZE(p->param) ||
+		    memcmp(SPA_MEMBER(pp, sizeof(*pp), void), p->param, pp->size) != 0)
+			return false;
+		pp = SPA_MEMBER(pp, PENDING_SIZE(pp->size), struct pending_param);
 	}
-	return NULL;
+	for (; (void*)pp < pw_array_end(&o->pending);
+	    pp = SPA_MEMBER(pp, PENDING_SIZE(pp->size), struct pending_param))
+		if (pp->id == id && pp->size > 0)
+			return false;
+	return true;
 }
 
-static void object_update_params(struct object *o)
+/* apply the pending params of id, starting at first, in one block of
+ * memory. Returns true when the params of id changed. */
+static bool apply_params(struct object *o, uint32_t id, struct pending_param *first)
 {
+	struct pending_param *pp;
 	struct pw_manager_param *p;
+	struct param_block *b;
+	bool replace = false, changed = false;
+	size_t size = 0;
+	void *data;
+
+	for (pp = first; (void*)pp < pw_array_end(&o->pending);
+	    pp = SPA_MEMBER(pp, PENDING_SIZE(pp->size), struct pending_param)) {
+		if (pp->id != id)
+			continue;
+		if (pp->size == 0)
+			replace = true;
+		else
+			size += sizeof(struct pw_manager_param) + SPA_ROUND_UP_N(pp->size, 8);
+	}
 
-	spa_list_consume(p, &o->pending_list, link) {
-		spa_list_remove(&p->link);
-		if (p->param == NULL) {
-			clear_params(&o->this.param_list, p->id);
-			free(p);
-		} else {
-			spa_list_append(&o->this.param_list, &p->link);
+	if (replace) {
+		if (params_equal(o, id, first))
+			goto done;
+		clear_params(o, id);
+	}
+	if (size == 0)
+		goto done_changed;
+
+	if ((data = malloc(size)) == NULL ||
+	    (b = pw_array_add(&o->param_blocks, sizeof(*b))) == NULL) {
+		free(data);
+		goto done_changed;
+	}
+	b->id = id;
+	b->data = p = data;
+
+	for (pp = first; (void*)pp < pw_array_end(&o->pending);
+	    pp = SPA_MEMBER(pp, PENDING_SIZE(pp->size), struct pending_param)) {
+		if (pp->id != id || pp->size == 0)
+			continue;
+		p->id = id;
+		p->param = SPA_MEMBER(p, sizeof(*p), struct spa_pod);
+		memcpy(p->param, SPA_MEMBER(pp, sizeof(*pp), void), pp->size);
+		spa_list_append(&o->this.param_list, &p->link);
+		p = SPA_MEMBER(p->param, SPA_ROUND_UP_N(pp->size, 8), struct pw_manager_param);
+	}
+done_changed:
+	o->this.param_seq++;
+	changed = true;
+done:
+	for (pp = first; (void*)pp < pw_array_end(&o->pending);
+	    pp = SPA_MEMBER(pp, PENDING_SIZE(pp->size), struct pending_param))
+		if (pp->id == id)
+			pp->id = SPA_ID_INVALID;
+	return changed;
+}
+
+static struct object *find_object(struct manager *m, uint32_t id)
+{
+	struct object *o = pw_map_lookup(&m->objects, id);
+	if (o == NULL || o->this.creating)
+		return NULL;
+	return o;
+}
+
+static void index_object(struct manager *m, struct object *o)
+{
+	size_t size = pw_map_get_size(&m->objects);
+
+	while (o->this.id > size)
+		if (pw_map_insert_at(&m->objects, size++, NULL) < 0)
+			return;
+	pw_map_insert_at(&m->objects, o->this.id, o);
+}
+
+static void unindex_object(struct manager *m, struct object *o)
+{
+	if (pw_map_lookup(&m->objects, o->this.id) == o)
+		pw_map_insert_at(&m->objects, o->this.id, NULL);
+}
+
+static uint32_t link_node_id(struct object *o, const char *key)
+{
+	const char *str;
+	if (o->this.props == NULL ||
+	    (str = pw_properties_get(o->this.props, key)) == NULL)
+		return SPA_ID_INVALID;
+	return pw_properties_parse_int(str);
+}
+
+/* add a link to the links of its nodes, or to the unlinked list until the
+ * node appears */
+static void link_add(struct manager *m, struct object *o)
+{
+	struct object *node;
+	uint32_t i;
+
+	o->link_node[PW_DIRECTION_OUTPUT] = link_node_id(o, PW_KEY_LINK_OUTPUT_NODE);
+	o->link_node[PW_DIRECTION_INPUT] = link_node_id(o, PW_KEY_LINK_INPUT_NODE);
+
+	/* only links between two known node ids are indexed */
+	if (o->link_node[0] == SPA_ID_INVALID || o->link_node[1] == SPA_ID_INVALID)
+		return;
+
+	for (i = 0; i < 2; i++) {
+		node = pw_map_lookup(&m->objects, o->link_node[i]);
+		if (node != NULL && strcmp(node->this.type, PW_TYPE_INTERFACE_Node) == 0)
+			spa_list_append(&node->links[i], &o->link_link[i]);
+		else
+			spa_list_append(&m->unlinked[i], &o->link_link[i]);
+	}
+}
+
+static void node_add(struct manager *m, struct object *o)
+{
+	struct object *l, *t;
+	uint32_t i;
+
+	for (i = 0; i < 2; i++) {
+		spa_list_for_each_safe(l, t, &m->unlinked[i], link_link[i]) {
+			if (l->link_node[i] != o->this.id)
+				continue;
+			spa_list_remove(&l->link_link[i]);
+			spa_list_append(&o->links[i], &l->link_link[i]);
+		}
+	}
+}
+
+static void node_remove(struct manager *m, struct object *o)
+{
+	struct object *l;
+	uint32_t i;
+
+	for (i = 0; i < 2; i++) {
+		spa_list_consume(l, &o->links[i], link_link[i]) {
+			spa_list_remove(&l->link_link[i]);
+			spa_list_append(&m->unlinked[i], &l->link_link[i]);
 		}
 	}
 }
 
+static void class_remove(struct object *o)
+{
+	uint32_t i;
+
+	for (i = 0; i < PW_MANAGER_CLASS_LAST; i++)
+		if (SPA_FLAG_IS_SET(o->this.classes, 1u << i))
+			spa_list_remove(&o->class_link[i]);
+	o->this.classes = 0;
+}
+
+#define PARAM_MASK(id)	(1ull << SPA_MIN(id, 63u))
+
+/* apply the params that were enumerated since the last sync, only the
+ * param ids that really changed are replaced. Returns the mask of changed
+ * param ids */
+static uint64_t object_update_params(struct object *o)
+{
+	struct pending_param *pp;
+	uint64_t changed = 0;
+
+	for (pp = o->pending.data; (void*)pp < pw_array_end(&o->pending);
+	    pp = SPA_MEMBER(pp, PENDING_SIZE(pp->size), struct pending_param)) {
+		uint32_t id = pp->id;
+		if (id != SPA_ID_INVALID && apply_params(o, id, pp))
+			changed |= PARAM_MASK(id);
+	}
+	pw_array_reset(&o->pending);
+	return changed;
+}
+
 static void object_destroy(struct object *o)
 {
 	struct manager *m = o->manager;
 	struct object_data *d;
 	spa_list_remove(&o->this.link);
 	m->this.n_objects--;
+	unindex_object(m, o);
+	node_remove(m, o);
+	spa_list_remove(&o->link_link[0]);
+	spa_list_remove(&o->link_link[1]);
+	class_remove(o);
 	if (o->this.proxy)
 		pw_proxy_destroy(o->this.proxy);
 	if (o->this.props)
 		pw_properties_free(o->this.props);
-	clear_params(&o->this.param_list, SPA_ID_INVALID);
-	clear_params(&o->pending_list, SPA_ID_INVALID);
+	clear_params(o, SPA_ID_INVALID);
+	pw_array_clear(&o->param_blocks);
+	pw_array_clear(&o->pending);
 	spa_list_consume(d, &o->data_list, link) {
 		spa_list_remove(&d->link);
 		free(d);
@@ -273,6 +507,7 @@ static void device_event_info(void *object, const struct pw_device_info *info)
 {
 	struct object *o = object;
 	uint32_t i, changed = 0;
+	bool enumerate = false;
 
 	pw_log_debug("object %p: id:%d change-mask:%08"PRIx64, o, o->this.id, info->change_mask);
 
@@ -289,16 +524,11 @@ static void device_event_info(void *object, const struct pw_device_info *info)
 				continue;
 			info->params[i].user = 0;
 
-			switch (id) {
-			case SPA_PARAM_EnumProfile:
-			case SPA_PARAM_Profile:
-			case SPA_PARAM_EnumRoute:
-				changed++;
-				break;
-			case SPA_PARAM_Route:
-				break;
-			}
-			add_param(&o->pending_list, id, NULL);
+			/* the params are compared with the current ones on
+			 * the next sync, they only count as a change when they
+			 * are different */
+			pending_start(o, id);
+			enumerate = true;
 			if (!(info->params[i].flags & SPA_PARAM_INFO_READ))
 				continue;
 
@@ -306,28 +536,30 @@ static void device_event_info(void *object, const struct pw_device_info *info)
 					0, id, 0, -1, NULL);
 		}
 	}
-	if (changed) {
+	if (changed || enumerate) {
 		o->this.changed += changed;
 		core_sync(o->manager);
 	}
 }
 static struct object *find_device(struct manager *m, uint32_t card_id, uint32_t device)
 {
+	static const uint32_t classes[] = { PW_MANAGER_CLASS_SINK, PW_MANAGER_CLASS_SOURCE };
 	struct object *o;
-
-	spa_list_for_each(o, &m->this.object_list, this.link) {
-		struct pw_node_info *info;
-		const char *str;
-
-		if (strcmp(o->this.type, PW_TYPE_INTERFACE_Node) != 0)
-			continue;
-
-		if ((info = o->this.info) != NULL &&
-		    (str = spa_dict_lookup(info->props, PW_KEY_DEVICE_ID)) != NULL &&
-		    (uint32_t)atoi(str) == card_id &&
-		    (str = spa_dict_lookup(info->props, "card.profile.device")) != NULL &&
-		    (uint32_t)atoi(str) == device)
-			return o;
+	uint32_t i;
+
+	/* the nodes of a card are its sinks and sources */
+	for (i = 0; i < SPA_N_ELEMENTS(classes); i++) {
+		spa_list_for_each(o, &m->class_list[classes[i]], class_link[classes[i]]) {
+			struct pw_node_info *info;
+			const char *str;
+
+			if ((info = o->this.info) != NULL &&
+			    (str = spa_dict_lookup(info->props, PW_KEY_DEVICE_ID)) != NULL &&
+			    (uint32_t)atoi(str) == card_id &&
+			    (str = spa_dict_lookup(info->props, "card.profile.device")) != NULL &&
+			    (uint32_t)atoi(str) == device)
+				return o;
+		}
 	}
 	return NULL;
 }
@@ -338,11 +570,12 @@ static void device_event_param(void *object, int seq,
 {
 	struct object *o = object, *dev;
 	struct manager *m = o->manager;
-	struct pw_manager_param *p;
+	const struct spa_pod *p;
 
-	p = add_param(&o->pending_list, id, param);
+	if ((p = pending_add(o, id, param)) == NULL)
+		return;
 
-	if (id == SPA_PARAM_Route && !has_param(&o->this.param_list, p)) {
+	if (id == SPA_PARAM_Route && !has_param(&o->this.param_list, id, p)) {
 		uint32_t id, device;
 		if (spa_pod_parse_object(param,
 				SPA_TYPE_OBJECT_ParamRoute, NULL,
@@ -383,6 +616,7 @@ static void node_event_info(void *object, const struct pw_node_info *info)
 {
 	struct object *o = object;
 	uint32_t i, changed = 0;
+	bool enumerate = false;
 
 	pw_log_debug("object %p: id:%d change-mask:%08"PRIx64, o, o->this.id, info->change_mask);
 
@@ -402,8 +636,8 @@ static void node_event_info(void *object, const struct pw_node_info *info)
 				continue;
 			info->params[i].user = 0;
 
-			changed++;
-			add_param(&o->pending_list, id, NULL);
+			pending_start(o, id);
+			enumerate = true;
 			if (!(info->params[i].flags & SPA_PARAM_INFO_READ))
 				continue;
 
@@ -411,7 +645,7 @@ static void node_event_info(void *object, const struct pw_node_info *info)
 					0, id, 0, -1, NULL);
 		}
 	}
-	if (changed) {
+	if (changed || enumerate) {
 		o->this.changed += changed;
 		core_sync(o->manager);
 	}
@@ -422,7 +656,7 @@ static void node_event_param(void *object, int seq,
 		const struct spa_pod *param)
 {
 	struct object *o = object;
-	add_param(&o->pending_list, id, param);
+	pending_add(o, id, param);
 }
 
 static const struct pw_node_events node_events = {
@@ -535,6 +769,51 @@ static const struct pw_proxy_events proxy_events = {
         .destroy = destroy_proxy,
 };
 
+static uint32_t object_classes(struct object *o)
+{
+	const char *str = NULL;
+
+	if (o->this.props != NULL)
+		str = pw_properties_get(o->this.props, PW_KEY_MEDIA_CLASS);
+
+	if (o->info == &client_info)
+		return PW_MANAGER_CLASS_MASK(CLIENT);
+	if (o->info == &module_info)
+		return PW_MANAGER_CLASS_MASK(MODULE);
+	if (o->info == &link_info)
+		return PW_MANAGER_CLASS_MASK(LINK);
+	if (str == NULL)
+		return 0;
+	if (o->info == &device_info) {
+		if (strcmp(str, "Audio/Device") == 0)
+			return PW_MANAGER_CLASS_MASK(CARD);
+	} else if (o->info == &node_info) {
+		if (strcmp(str, "Audio/Sink") == 0)
+			return PW_MANAGER_CLASS_MASK(SINK) | PW_MANAGER_CLASS_MASK(MONITOR);
+		if (strcmp(str, "Audio/Duplex") == 0)
+			return PW_MANAGER_CLASS_MASK(SINK) | PW_MANAGER_CLASS_MASK(SOURCE);
+		if (strcmp(str, "Audio/Source") == 0 ||
+		    strcmp(str, "Audio/Source/Virtual") == 0)
+			return PW_MANAGER_CLASS_MASK(SOURCE);
+		if (strcmp(str, "Stream/Output/Audio") == 0)
+			return PW_MANAGER_CLASS_MASK(SINK_INPUT);
+		if (strcmp(str, "Stream/Input/Audio") == 0)
+			return PW_MANAGER_CLASS_MASK(SOURCE_OUTPUT);
+	}
+	return 0;
+}
+
+static void class_add(struct manager *m, struct object *o)
+{
+	uint32_t i;
+
+	o->this.classes = object_classes(o);
+	o->seq = m->seq++;
+	for (i = 0; i < PW_MANAGER_CLASS_LAST; i++)
+		if (SPA_FLAG_IS_SET(o->this.classes, 1u << i))
+			spa_list_append(&m->class_list[i], &o->class_link[i]);
+}
+
 static void registry_event_global(void *data, uint32_t id,
 			uint32_t permissions, const char *type, uint32_t version,
 			const struct spa_dict *props)
@@ -567,14 +846,26 @@ static void registry_event_global(void *data, uint32_t id,
 	o->this.proxy = proxy;
 	o->this.creating = true;
 	spa_list_init(&o->this.param_list);
-	spa_list_init(&o->pending_list);
+	pw_array_init(&o->pending, 1024);
+	pw_array_init(&o->param_blocks, 8 * sizeof(struct param_block));
 	spa_list_init(&o->data_list);
+	spa_list_init(&o->link_link[0]);
+	spa_list_init(&o->link_link[1]);
+	spa_list_init(&o->links[0]);
+	spa_list_init(&o->links[1]);
 
 	o->manager = m;
 	o->info = info;
 	spa_list_append(&m->this.object_list, &o->this.link);
 	m->this.n_objects++;
 
+	index_object(m, o);
+	class_add(m, o);
+	if (info == &node_info)
+		node_add(m, o);
+	else if (info == &link_info)
+		link_add(m, o);
+
 	if (info->events)
 		pw_proxy_add_object_listener(proxy,
 				&o->object_listener,
@@ -629,8 +920,15 @@ static void on_core_done(void *data, uint32_t id, int seq)
 
 		manager_emit_sync(m);
 
-		spa_list_for_each(o, &m->this.object_list, this.link)
-			object_update_params(o);
+		spa_list_for_each(o, &m->this.object_list, this.link) {
+			uint64_t changed = object_update_params(o);
+
+			/* a route change is announced on the device node */
+			if (o->info == &device_info)
+				changed &= ~PARAM_MASK(SPA_PARAM_Route);
+			if (changed)
+				o->this.changed++;
+		}
 
 		spa_list_for_each(o, &m->this.object_list, this.link) {
 			if (o->this.creating) {
@@ -654,6 +952,7 @@ static const struct pw_core_events core_events = {
 struct pw_manager *pw_manager_new(struct pw_core *core)
 {
 	struct manager *m;
+	uint32_t i;
 
 	m = calloc(1, sizeof(*m));
 	if (m == NULL)
@@ -670,6 +969,11 @@ struct pw_manager *pw_manager_new(struct pw_core *core)
 	spa_hook_list_init(&m->hooks);
 
 	spa_list_init(&m->this.object_list);
+	pw_map_init(&m->objects, 256, 256);
+	spa_list_init(&m->unlinked[0]);
+	spa_list_init(&m->unlinked[1]);
+	for (i = 0; i < PW_MANAGER_CLASS_LAST; i++)
+		spa_list_init(&m->class_list[i]);
 
 	pw_core_add_listener(m->this.core,
 			&m->core_listener,
@@ -726,6 +1030,35 @@ int pw_manager_set_metadata(struct pw_manager *manager,
 	return 0;
 }
 
+struct pw_manager_object *pw_manager_find_object(struct pw_manager *manager, uint32_t id)
+{
+	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
+	struct object *o = pw_map_lookup(&m->objects, id);
+
+	if (o == NULL || o->this.creating || o->this.removing)
+		return NULL;
+	return &o->this;
+}
+
+int pw_manager_for_each_link(struct pw_manager *manager, uint32_t node_id,
+		enum pw_direction direction,
+		int (*callback) (void *data, struct pw_manager_object *link, uint32_t peer_id),
+		void *data)
+{
+	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
+	struct object *node, *l;
+	int res;
+
+	if ((node = pw_map_lookup(&m->objects, node_id)) == NULL)
+		return 0;
+
+	spa_list_for_each(l, &node->links[direction], link_link[direction]) {
+		if ((res = callback(data, &l->this, l->link_node[1 - direction])) != 0)
+			return res;
+	}
+	return 0;
+}
+
 int pw_manager_for_each_object(struct pw_manager *manager,
 		int (*callback) (void *data, struct pw_manager_object *object),
 		void *data)
@@ -743,6 +1076,46 @@ int pw_manager_for_each_object(struct pw_manager *manager,
 	return 0;
 }
 
+static struct object *class_next(struct manager *m, uint32_t class, struct object *o)
+{
+	struct spa_list *next = o ? o->class_link[class].next : m->class_list[class].next;
+	if (next == &m->class_list[class])
+		return NULL;
+	return SPA_CONTAINER_OF(next, struct object, class_link[class]);
+}
+
+int pw_manager_for_each_object_of_class(struct pw_manager *manager, uint32_t classes,
+		int (*callback) (void *data, struct pw_manager_object *object),
+		void *data)
+{
+	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
+	struct object *cur[PW_MANAGER_CLASS_LAST], *o;
+	uint32_t i;
+	int res;
+
+	for (i = 0; i < PW_MANAGER_CLASS_LAST; i++)
+		cur[i] = SPA_FLAG_IS_SET(classes, 1u << i) ? class_next(m, i, NULL) : NULL;
+
+	/* merge the lists, they are all in the order the objects were added */
+	while (true) {
+		o = NULL;
+		for (i = 0; i < PW_MANAGER_CLASS_LAST; i++)
+			if (cur[i] != NULL && (o == NULL || cur[i]->seq < o->seq))
+				o = cur[i];
+		if (o == NULL)
+			break;
+		for (i = 0; i < PW_MANAGER_CLASS_LAST; i++)
+			if (cur[i] == o)
+				cur[i] = class_next(m, i, o);
+
+		if (o->this.creating)
+			continue;
+		if ((res = callback(data, &o->this)) != 0)
+			return res;
+	}
+	return 0;
+}
+
 void pw_manager_destroy(struct pw_manager *manager)
 {
 	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
@@ -752,6 +1125,7 @@ void pw_manager_destroy(struct pw_manager *manager)
 
 	spa_list_consume(o, &m->this.object_list, this.link)
 		object_destroy(o);
+	pw_map_clear(&m->objects);
 
 	spa_hook_remove(&m->registry_listener);
 	pw_proxy_destroy((struct pw_proxy*)m->this.registry);
@@ -766,7 +1140,8 @@ static struct object_data *object_find_data(struct object *o, const char *id)
 {
 	struct object_data *d;
 	spa_list_for_each(d, &o->data_list, link) {
-		if (strcmp(d->id, id) == 0)
+		/* the ids are usually the same string constant */
+		if (d->id == id || strcmp(d->id, id) == 0)
 			return d;
 	}
 	return NULL;
@@ -36,6 +36,24 @@ extern "C" {
 
 struct pw_manager_object;
 
+/** The classes the manager sorts objects in, an object can be in more
+ * than one class */
+enum pw_manager_class {
+	PW_MANAGER_CLASS_CLIENT,
+	PW_MANAGER_CLASS_MODULE,
+	PW_MANAGER_CLASS_CARD,		/**< Audio/Device devices */
+	PW_MANAGER_CLASS_SINK,		/**< Audio/Sink and Audio/Duplex nodes */
+	PW_MANAGER_CLASS_SOURCE,	/**< Audio/Source, Audio/Duplex and
+					  *  Audio/Source/Virtual nodes */
+	PW_MANAGER_CLASS_MONITOR,	/**< Audio/Sink nodes */
+	PW_MANAGER_CLASS_SINK_INPUT,	/**< Stream/Output/Audio nodes */
+	PW_MANAGER_CLASS_SOURCE_OUTPUT,	/**< Stream/Input/Audio nodes */
+	PW_MANAGER_CLASS_LINK,
+	PW_MANAGER_CLASS_LAST,
+};
+
+#define PW_MANAGER_CLASS_MASK(c)	(1u << PW_MANAGER_CLASS_ ## c)
+
 struct pw_manager_events {
 #define PW_VERSION_MANAGER_EVENTS	0
 	uint32_t version;
@@ -83,6 +101,8 @@ struct pw_manager_object {
 	int changed;
 	void *info;
 	struct spa_list param_list;
+	uint32_t param_seq;		/**< changes when param_list changes */
+	uint32_t classes;		/**< mask of enum pw_manager_class */
 	unsigned int creating:1;
 	unsigned int removing:1;
 };
@@ -104,6 +124,23 @@ int pw_manager_for_each_object(struct pw_manager *manager,
 		int (*callback) (void *data, struct pw_manager_object *object),
 		void *data);
 
+/** Call \a callback for the objects in one of the \a classes, a mask of
+ * PW_MANAGER_CLASS_MASK() values. Objects are visited once, in the order
+ * they were added */
+int pw_manager_for_each_object_of_class(struct pw_manager *manager, uint32_t classes,
+		int (*callback) (void *data, struct pw_manager_object *object),
+		void *data);
+
+/** Find an object by id, objects that are being added or removed are not found */
+struct pw_manager_object *pw_manager_find_object(struct pw_manager *manager, uint32_t id);
+
+/** Call \a callback for the links that have node \a node_id on their
+ * \a direction side, with the id of the node on the other side */
+int pw_manager_for_each_link(struct pw_manager *manager, uint32_t node_id,
+		enum pw_direction direction,
+		int (*callback) (void *data, struct pw_manager_object *link, uint32_t peer_id),
+		void *data);
+
 void *pw_manager_object_add_data(struct pw_manager_object *o, const char *id, size_t size);
 
 #ifdef __cplusplus
@@ -265,6 +265,7 @@ struct impl {
 	struct spa_list cleanup_clients;
 
 	struct pw_map samples;
+	struct spa_list sample_mixers;
 	struct pw_map modules;
 
 	struct spa_list free_messages;
@@ -2762,9 +2763,9 @@ static int do_play_sample(struct client *client, uint32_t command, uint32_t tag,
 	if (sample == NULL)
 		goto error_noent;
 
-	pw_properties_setf(props, PW_KEY_NODE_TARGET, "%u", o->id);
-
-	play = sample_play_new(client->core, sample, props, sizeof(struct pending_sample));
+	/* the sample plays on the mixer of the sink for these props */
+	play = sample_play_new(impl->context, &impl->sample_mixers, sample, o->id,
+			props, sizeof(struct pending_sample));
 	props = NULL;
 	if (play == NULL)
 		goto error_errno;
@@ -4538,6 +4539,7 @@ static int do_get_info_list(struct client *client, uint32_t command, uint32_t ta
 	struct impl *impl = client->impl;
 	struct pw_manager *manager = client->manager;
 	struct info_list_data info;
+	uint32_t classes = 0;
 
 	pw_log_info(NAME" %p: [%s] %s tag:%u", impl, client->name,
 			commands[command].name, tag);
@@ -4548,24 +4550,32 @@ static int do_get_info_list(struct client *client, uint32_t command, uint32_t ta
 	switch (command) {
 	case COMMAND_GET_CLIENT_INFO_LIST:
 		info.fill_func = fill_client_info;
+		classes = PW_MANAGER_CLASS_MASK(CLIENT);
 		break;
 	case COMMAND_GET_MODULE_INFO_LIST:
 		info.fill_func = fill_module_info;
+		classes = PW_MANAGER_CLASS_MASK(MODULE);
 		break;
 	case COMMAND_GET_CARD_INFO_LIST:
 		info.fill_func = fill_card_info;
+		classes = PW_MANAGER_CLASS_MASK(CARD);
 		break;
 	case COMMAND_GET_SINK_INFO_LIST:
 		info.fill_func = fill_sink_info;
+		classes = PW_MANAGER_CLASS_MASK(SINK);
 		break;
 	case COMMAND_GET_SOURCE_INFO_LIST:
 		info.fill_func = fill_source_info;
+		classes = PW_MANAGER_CLASS_MASK(SOURCE) |
+			PW_MANAGER_CLASS_MASK(MONITOR);
 		break;
 	case COMMAND_GET_SINK_INPUT_INFO_LIST:
 		info.fill_func = fill_sink_input_info;
+		classes = PW_MANAGER_CLASS_MASK(SINK_INPUT);
 		break;
 	case COMMAND_GET_SOURCE_OUTPUT_INFO_LIST:
 		info.fill_func = fill_source_output_info;
+		classes = PW_MANAGER_CLASS_MASK(SOURCE_OUTPUT);
 		break;
 	default:
 		return -ENOTSUP;
@@ -4573,7 +4583,8 @@ static int do_get_info_list(struct client *client, uint32_t command, uint32_t ta
 
 	info.reply = reply_new(client, tag);
 	if (info.fill_func)
-		pw_manager_for_each_object(manager, do_list_info, &info);
+		pw_manager_for_each_object_of_class(manager, classes,
+				do_list_info, &info);
 
 	if (command == COMMAND_GET_MODULE_INFO_LIST)
 		pw_map_for_each(&impl->modules, do_info_list_module, &info);
@@ -6013,11 +6024,14 @@ static void impl_free(struct impl *impl)
 {
 	struct server *s;
 	struct client *c;
+	struct sample_mixer *m;
 
 	if (impl->context != NULL)
 		spa_hook_remove(&impl->context_listener);
 	spa_list_consume(c, &impl->cleanup_clients, link)
 		client_free(c);
+	spa_list_consume(m, &impl->sample_mixers, link)
+		sample_mixer_destroy(m);
 	spa_list_consume(s, &impl->servers, link)
 		server_free(s);
 	pw_map_for_each(&impl->samples, impl_free_sample, impl);
@@ -6034,6 +6048,15 @@ static void context_destroy(void *data)
 {
 	struct impl *impl = data;
 	struct server *s;
+	struct client *c;
+	struct sample_mixer *m;
+
+	/* the mixers and clients have a core on the context, they go before
+	 * the context disconnects the cores and destroys their streams */
+	spa_list_consume(c, &impl->cleanup_clients, link)
+		client_free(c);
+	spa_list_consume(m, &impl->sample_mixers, link)
+		sample_mixer_destroy(m);
 	spa_list_consume(s, &impl->servers, link)
 		server_free(s);
 	spa_hook_remove(&impl->context_listener);
@@ -6125,6 +6148,7 @@ struct pw_protocol_pulse *pw_protocol_pulse_new(struct pw_context *context,
 	pw_map_init(&impl->samples, 16, 16);
 	pw_map_init(&impl->modules, 16, 16);
 	spa_list_init(&impl->cleanup_clients);
+	spa_list_init(&impl->sample_mixers);
 	spa_list_init(&impl->free_messages);
 
 	pw_context_add_listener(context, &impl->context_listener,
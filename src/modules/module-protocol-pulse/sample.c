@@ -22,6 +22,9 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+
+#include <endian.h>
+
 struct sample {
 	int ref;
 	uint32_t index;
@@ -46,178 +49,553 @@ struct sample_play_events {
 #define sample_play_emit_ready(p,i) spa_hook_list_call(&p->hooks, struct sample_play_events, ready, 0, i)
 #define sample_play_emit_done(p,r) spa_hook_list_call(&p->hooks, struct sample_play_events, done, 0, r)
 
-struct sample_play {
+/* seconds a mixer keeps running after the last sample finished */
+#define SAMPLE_MIXER_IDLE_SEC	3
+
+typedef void (*sample_mix_func_t) (float *dst, const void *src, uint32_t n_samples);
+
+/* one playback node per sink, sample rate, channel layout and properties
+ * of the play requests. The properties carry the client and the role of
+ * the samples, so that the node is routed and attributed like a stream of
+ * the client would be. The samples that are played on it are mixed in the
+ * process function, each starting at the frame where it was requested. */
+struct sample_mixer {
 	struct spa_list link;
-	struct sample *sample;
+
+	struct pw_loop *main_loop;
+	struct pw_loop *data_loop;
+	struct pw_core *core;
 	struct pw_stream *stream;
+	struct spa_hook listener;
 	struct spa_io_rate_match *rate_match;
+	struct spa_source *event;
+	struct spa_source *idle;
+
+	uint32_t target;
+	struct pw_properties *props;
+	struct sample_spec ss;
+	struct channel_map map;
+	uint32_t stride;
 	uint32_t index;
-	struct spa_hook listener;
-	struct pw_context *context;
-	struct pw_loop *main_loop;
+
+	struct spa_list voices;
+	struct spa_list rt_voices;
+	uint64_t last_nsec;
+
+	unsigned int active:1;
+	unsigned int failed:1;
+};
+
+struct sample_play {
+	struct spa_list link;
+	struct spa_list rt_link;
+	struct sample *sample;
+	struct sample_mixer *mixer;
+	sample_mix_func_t mix;
+	uint64_t start_nsec;
 	uint32_t offset;
 	uint32_t stride;
 	struct spa_hook_list hooks;
 	void *user_data;
+	unsigned int ready:1;
+	unsigned int done:1;
+
+	/* changed in the data thread */
+	bool in_rt;
+	bool started;
+	bool finished;
 };
 
 static void sample_free(struct sample *sample);
 
-static void sample_play_stream_state_changed(void *data, enum pw_stream_state old,
+#define MIX_FUNC(name,type,expr)						\
+static void mix_ ##name(float *dst, const void *src, uint32_t n_samples)	\
+{										\
+	const type *s = src;							\
+	uint32_t i;								\
+	for (i = 0; i < n_samples; i++)						\
+		dst[i] += (expr);						\
+}
+
+static inline float s24_32_to_f32(uint32_t v)
+{
+	return (int32_t)(v << 8) / 2147483648.0f;
+}
+
+static inline float u32_to_f32(uint32_t v)
+{
+	union { uint32_t i; float f; } u = { v };
+	return u.f;
+}
+
+MIX_FUNC(u8, uint8_t, (s[i] - 128) / 128.0f);
+MIX_FUNC(s16le, uint16_t, (int16_t)le16toh(s[i]) / 32768.0f);
+MIX_FUNC(s16be, uint16_t, (int16_t)be16toh(s[i]) / 32768.0f);
+MIX_FUNC(s32le, uint32_t, (int32_t)le32toh(s[i]) / 2147483648.0f);
+MIX_FUNC(s32be, uint32_t, (int32_t)be32toh(s[i]) / 2147483648.0f);
+MIX_FUNC(s24_32le, uint32_t, s24_32_to_f32(le32toh(s[i])));
+MIX_FUNC(s24_32be, uint32_t, s24_32_to_f32(be32toh(s[i])));
+MIX_FUNC(f32le, uint32_t, u32_to_f32(le32toh(s[i])));
+MIX_FUNC(f32be, uint32_t, u32_to_f32(be32toh(s[i])));
+MIX_FUNC(s24le, uint8_t, (int32_t)((uint32_t)s[3*i] << 8 | (uint32_t)s[3*i+1] << 16 |
+			(uint32_t)s[3*i+2] << 24) / 2147483648.0f);
+MIX_FUNC(s24be, uint8_t, (int32_t)((uint32_t)s[3*i+2] << 8 | (uint32_t)s[3*i+1] << 16 |
+			(uint32_t)s[3*i] << 24) / 2147483648.0f);
+
+static sample_mix_func_t find_mix_func(uint32_t format)
+{
+	switch (format) {
+	case SPA_AUDIO_FORMAT_U8:
+		return mix_u8;
+	case SPA_AUDIO_FORMAT_S16_LE:
+		return mix_s16le;
+	case SPA_AUDIO_FORMAT_S16_BE:
+		return mix_s16be;
+	case SPA_AUDIO_FORMAT_S32_LE:
+		return mix_s32le;
+	case SPA_AUDIO_FORMAT_S32_BE:
+		return mix_s32be;
+	case SPA_AUDIO_FORMAT_S24_32_LE:
+		return mix_s24_32le;
+	case SPA_AUDIO_FORMAT_S24_32_BE:
+		return mix_s24_32be;
+	case SPA_AUDIO_FORMAT_F32_LE:
+		return mix_f32le;
+	case SPA_AUDIO_FORMAT_F32_BE:
+		return mix_f32be;
+	case SPA_AUDIO_FORMAT_S24_LE:
+		return mix_s24le;
+	case SPA_AUDIO_FORMAT_S24_BE:
+		return mix_s24be;
+	default:
+		return NULL;
+	}
+}
+
+/* the frame in this cycle where a sample starts. Samples that were
+ * requested less than a cycle after the previous cycle start at the same
+ * distance from this cycle, so that they all have the same latency. */
+static uint32_t sample_play_start(struct sample_mixer *m, struct sample_play *p,
+		uint32_t n_frames)
+{
+	uint64_t diff, period;
+
+	if (m->last_nsec == 0 || p->start_nsec <= m->last_nsec)
+		return 0;
+
+	diff = p->start_nsec - m->last_nsec;
+	period = (uint64_t)n_frames * SPA_NSEC_PER_SEC / m->ss.rate;
+	if (diff >= period)
+		return 0;
+	return diff * m->ss.rate / SPA_NSEC_PER_SEC;
+}
+
+/* mix the active samples into the buffer, called from the data thread */
+static void sample_mix(struct sample_mixer *m, float *dst, uint32_t n_frames, uint64_t nsec)
+{
+	struct sample_play *p, *t;
+	uint32_t channels = m->ss.channels, start, avail, frames;
+	bool finished = false;
+
+	memset(dst, 0, n_frames * m->stride);
+
+	spa_list_for_each_safe(p, t, &m->rt_voices, rt_link) {
+		struct sample *s = p->sample;
+
+		start = 0;
+		if (!p->started) {
+			start = sample_play_start(m, p, n_frames);
+			p->started = true;
+		}
+		avail = (s->length - p->offset) / p->stride;
+		frames = SPA_MIN(n_frames - start, avail);
+
+		p->mix(dst + start * channels, s->buffer + p->offset, frames * channels);
+		p->offset += frames * p->stride;
+
+		if (frames == avail) {
+			spa_list_remove(&p->rt_link);
+			p->in_rt = false;
+			p->finished = true;
+			finished = true;
+		}
+	}
+	m->last_nsec = nsec;
+
+	if (finished)
+		pw_loop_signal_event(m->main_loop, m->event);
+}
+
+static void sample_mixer_process(void *data)
+{
+	struct sample_mixer *m = data;
+	struct pw_buffer *b;
+	struct spa_data *d;
+	struct pw_time time;
+	uint32_t n_frames;
+
+	if ((b = pw_stream_dequeue_buffer(m->stream)) == NULL) {
+		pw_log_warn("out of buffers: %m");
+		return;
+	}
+	d = &b->buffer->datas[0];
+	if (d->data == NULL)
+		return;
+
+	n_frames = d->maxsize / m->stride;
+	if (m->rate_match && m->rate_match->size > 0)
+		n_frames = SPA_MIN(n_frames, m->rate_match->size);
+
+	pw_stream_get_time(m->stream, &time);
+	sample_mix(m, d->data, n_frames, time.now);
+
+	d->chunk->offset = 0;
+	d->chunk->stride = m->stride;
+	d->chunk->size = n_frames * m->stride;
+
+	pw_stream_queue_buffer(m->stream, b);
+}
+
+static void sample_mixer_stream_state_changed(void *data, enum pw_stream_state old,
 		enum pw_stream_state state, const char *error)
 {
-	struct sample_play *p = data;
+	struct sample_mixer *m = data;
 
 	switch (state) {
 	case PW_STREAM_STATE_UNCONNECTED:
 	case PW_STREAM_STATE_ERROR:
-		sample_play_emit_done(p, -EIO);
+		/* new samples get a new mixer, this one goes when its
+		 * samples are destroyed */
+		m->failed = true;
+		pw_loop_signal_event(m->main_loop, m->event);
 		break;
 	case PW_STREAM_STATE_PAUSED:
-		p->index = pw_stream_get_node_id(p->stream);
-		sample_play_emit_ready(p, p->index);
+		m->index = pw_stream_get_node_id(m->stream);
+		pw_loop_signal_event(m->main_loop, m->event);
 		break;
 	default:
 		break;
 	}
 }
 
-static void sample_play_stream_io_changed(void *data, uint32_t id, void *area, uint32_t size)
+static void sample_mixer_stream_io_changed(void *data, uint32_t id, void *area, uint32_t size)
 {
-	struct sample_play *p = data;
+	struct sample_mixer *m = data;
 	switch (id) {
 	case SPA_IO_RateMatch:
-		p->rate_match = area;
+		m->rate_match = area;
 		break;
 	}
 }
 
-static void sample_play_stream_destroy(void *data)
-{
-	struct sample_play *p = data;
-
-	pw_log_info("destroy %s", p->sample->name);
-	spa_hook_remove(&p->listener);
-	p->stream = NULL;
-	if (--p->sample->ref == 0)
-		sample_free(p->sample);
-	p->sample = NULL;
-}
+static const struct pw_stream_events sample_mixer_stream_events = {
+	PW_VERSION_STREAM_EVENTS,
+	.state_changed = sample_mixer_stream_state_changed,
+	.io_changed = sample_mixer_stream_io_changed,
+	.process = sample_mixer_process,
+};
 
-static void sample_play_stream_process(void *data)
+static void sample_mixer_destroy(struct sample_mixer *m)
 {
-	struct sample_play *p = data;
-	struct sample *s = p->sample;
-	struct pw_buffer *b;
-	struct spa_buffer *buf;
-	uint32_t size;
-	uint8_t *d;
+	struct sample_play *p;
 
-	if (p->offset >= s->length) {
-		pw_stream_flush(p->stream, true);
-		return;
-	}
-	size = s->length - p->offset;
+	pw_log_info("destroy sample mixer %p target:%u", m, m->target);
 
-	if ((b = pw_stream_dequeue_buffer(p->stream)) == NULL) {
-		pw_log_warn("out of buffers: %m");
-                return;
+	spa_list_remove(&m->link);
+	if (m->stream) {
+		spa_hook_remove(&m->listener);
+		pw_stream_destroy(m->stream);
+	}
+	/* the data thread is done with the samples now */
+	spa_list_for_each(p, &m->voices, link) {
+		p->mixer = NULL;
+		p->in_rt = false;
 	}
+	if (m->core)
+		pw_core_disconnect(m->core);
+	if (m->event)
+		pw_loop_destroy_source(m->main_loop, m->event);
+	if (m->idle)
+		pw_loop_destroy_source(m->main_loop, m->idle);
+	if (m->props)
+		pw_properties_free(m->props);
+	free(m);
+}
 
-	buf = b->buffer;
-	if ((d = buf->datas[0].data) == NULL)
-		return;
+static void sample_mixer_set_idle(struct sample_mixer *m, bool idle)
+{
+	struct timespec value = { SAMPLE_MIXER_IDLE_SEC, 0 }, interval = { 0, 0 };
 
-	size = SPA_MIN(size, buf->datas[0].maxsize);
-	if (p->rate_match)
-		size = SPA_MIN(size, p->rate_match->size * p->stride);
+	pw_loop_update_timer(m->main_loop, m->idle, idle ? &value : NULL, &interval, false);
 
-	memcpy(d, p->sample->buffer + p->offset, size);
+	if (!idle && !m->active) {
+		pw_stream_set_active(m->stream, true);
+		m->active = true;
+	}
+}
 
-	p->offset += size;
+static bool sample_mixer_busy(struct sample_mixer *m)
+{
+	struct sample_play *p;
+	spa_list_for_each(p, &m->voices, link) {
+		if (!p->done)
+			return true;
+	}
+	return false;
+}
 
-        buf->datas[0].chunk->offset = 0;
-        buf->datas[0].chunk->stride = p->stride;
-        buf->datas[0].chunk->size = size;
+static void on_sample_mixer_idle(void *data, uint64_t expirations)
+{
+	struct sample_mixer *m = data;
 
-        pw_stream_queue_buffer(p->stream, b);
+	if (m->active && !sample_mixer_busy(m)) {
+		pw_log_debug("sample mixer %p idle", m);
+		pw_stream_set_active(m->stream, false);
+		m->active = false;
+	}
 }
 
-static void sample_play_stream_drained(void *data)
+/* tell the samples that were added and finished since the last time,
+ * called in the main thread */
+static void on_sample_mixer_event(void *data, uint64_t count)
 {
-	struct sample_play *p = data;
-	sample_play_emit_done(p, 0);
+	struct sample_mixer *m = data;
+	struct sample_play *p, *t;
+
+	spa_list_for_each_safe(p, t, &m->voices, link) {
+		if (!p->ready && m->index != SPA_ID_INVALID) {
+			p->ready = true;
+			sample_play_emit_ready(p, m->index);
+		}
+		if (!p->done && (p->finished || m->failed)) {
+			p->done = true;
+			sample_play_emit_done(p, p->finished ? 0 : -EIO);
+		}
+	}
+	if (m->failed) {
+		if (spa_list_is_empty(&m->voices))
+			sample_mixer_destroy(m);
+	} else if (!sample_mixer_busy(m)) {
+		sample_mixer_set_idle(m, true);
+	}
 }
 
-struct pw_stream_events sample_play_stream_events = {
-	PW_VERSION_STREAM_EVENTS,
-	.state_changed = sample_play_stream_state_changed,
-	.io_changed = sample_play_stream_io_changed,
-	.destroy = sample_play_stream_destroy,
-	.process = sample_play_stream_process,
-	.drained = sample_play_stream_drained,
-};
-
-static struct sample_play *sample_play_new(struct pw_core *core,
-		struct sample *sample, struct pw_properties *props,
-		size_t user_data_size)
+static struct sample_mixer *sample_mixer_new(struct pw_context *context,
+		struct spa_list *mixers, uint32_t target, const struct sample *sample,
+		const struct pw_properties *play_props)
 {
-	struct sample_play *p;
+	struct sample_mixer *m;
+	struct pw_properties *props;
 	uint8_t buffer[1024];
-        struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
 	const struct spa_pod *params[1];
 	uint32_t n_params = 0;
 	int res;
 
-	p = calloc(1, sizeof(struct sample_play) + user_data_size);
-	if (p == NULL) {
+	m = calloc(1, sizeof(struct sample_mixer));
+	if (m == NULL)
+		return NULL;
+
+	m->main_loop = pw_context_get_main_loop(context);
+	m->data_loop = context->data_loop;
+	m->target = target;
+	m->props = pw_properties_copy(play_props);
+	m->ss = sample->ss;
+	m->ss.format = SPA_AUDIO_FORMAT_F32;
+	m->map = sample->map;
+	m->stride = sample_spec_frame_size(&m->ss);
+	m->index = SPA_ID_INVALID;
+	spa_list_init(&m->voices);
+	spa_list_init(&m->rt_voices);
+	spa_list_append(mixers, &m->link);
+
+	m->event = pw_loop_add_event(m->main_loop, on_sample_mixer_event, m);
+	m->idle = pw_loop_add_timer(m->main_loop, on_sample_mixer_idle, m);
+	if (m->props == NULL || m->event == NULL || m->idle == NULL) {
 		res = -errno;
-		goto error_free;
+		goto error;
 	}
 
-	p->context = pw_core_get_context(core);
-	p->main_loop = pw_context_get_main_loop(p->context);
-	spa_hook_list_init(&p->hooks);
-	p->user_data = SPA_MEMBER(p, sizeof(struct sample_play), void);
-
-	pw_properties_update(props, &sample->props->dict);
-
-	p->stream = pw_stream_new(core, sample->name, props);
-	props = NULL;
-	if (p->stream == NULL) {
+	/* the client props are in the play props, the connection is made
+	 * with them so that the node belongs to a client like the one that
+	 * plays the samples */
+	m->core = pw_context_connect(context, pw_properties_copy(m->props), 0);
+	if (m->core == NULL) {
 		res = -errno;
-		goto error_free;
+		goto error;
 	}
 
-	p->sample = sample;
-	p->stride = sample_spec_frame_size(&sample->ss);
-	sample->ref++;
+	if ((props = pw_properties_copy(m->props)) == NULL) {
+		res = -errno;
+		goto error;
+	}
+	pw_properties_set(props, PW_KEY_MEDIA_NAME, sample->name);
+	pw_properties_setf(props, PW_KEY_NODE_TARGET, "%u", target);
 
-	pw_stream_add_listener(p->stream,
-			&p->listener,
-			&sample_play_stream_events, p);
+	m->stream = pw_stream_new(m->core, sample->name, props);
+	if (m->stream == NULL) {
+		res = -errno;
+		goto error;
+	}
+	pw_stream_add_listener(m->stream, &m->listener,
+			&sample_mixer_stream_events, m);
 
 	params[n_params++] = format_build_param(&b, SPA_PARAM_EnumFormat,
-			&sample->ss, &sample->map);
+			&m->ss, &m->map);
 
-	res = pw_stream_connect(p->stream,
+	res = pw_stream_connect(m->stream,
 			PW_DIRECTION_OUTPUT,
 			PW_ID_ANY,
 			PW_STREAM_FLAG_AUTOCONNECT |
+			PW_STREAM_FLAG_DONT_RECONNECT |
 			PW_STREAM_FLAG_MAP_BUFFERS |
 			PW_STREAM_FLAG_RT_PROCESS,
 			params, n_params);
 	if (res < 0)
-		goto error_cleanup;
+		goto error;
+
+	m->active = true;
+
+	pw_log_info("new sample mixer %p target:%u rate:%u channels:%u",
+			m, target, m->ss.rate, m->ss.channels);
+	return m;
+
+error:
+	sample_mixer_destroy(m);
+	errno = -res;
+	return NULL;
+}
+
+static bool props_equal(const struct pw_properties *a, const struct pw_properties *b)
+{
+	const struct spa_dict_item *it;
+	const char *str;
+
+	if (a->dict.n_items != b->dict.n_items)
+		return false;
+	spa_dict_for_each(it, &a->dict) {
+		if ((str = pw_properties_get(b, it->key)) == NULL ||
+		    strcmp(str, it->value) != 0)
+			return false;
+	}
+	return true;
+}
+
+static struct sample_mixer *find_sample_mixer(struct spa_list *mixers, uint32_t target,
+		const struct sample *sample, const struct pw_properties *props)
+{
+	struct sample_mixer *m;
+
+	spa_list_for_each(m, mixers, link) {
+		if (!m->failed &&
+		    m->target == target &&
+		    m->ss.rate == sample->ss.rate &&
+		    m->map.channels == sample->map.channels &&
+		    memcmp(m->map.map, sample->map.map,
+			    m->map.channels * sizeof(uint32_t)) == 0 &&
+		    props_equal(m->props, props))
+			return m;
+	}
+	return NULL;
+}
+
+static int do_add_voice(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct sample_play *p = user_data;
+	spa_list_append(&p->mixer->rt_voices, &p->rt_link);
+	p->in_rt = true;
+	return 0;
+}
+
+static int do_remove_voice(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct sample_play *p = user_data;
+	if (p->in_rt) {
+		spa_list_remove(&p->rt_link);
+		p->in_rt = false;
+	}
+	return 0;
+}
+
+/* the name of a node of the mixer, the last sample that was played on it */
+static void sample_mixer_set_name(struct sample_mixer *m, const char *name)
+{
+	const char *str;
+
+	str = pw_properties_get(pw_stream_get_properties(m->stream), PW_KEY_MEDIA_NAME);
+	if (str == NULL || strcmp(str, name) != 0) {
+		struct spa_dict_item items[1];
+		items[0] = SPA_DICT_ITEM_INIT(PW_KEY_MEDIA_NAME, name);
+		pw_stream_update_properties(m->stream, &SPA_DICT_INIT(items, 1));
+	}
+}
+
+/* play sample on the mixer of the target sink with the same props, the
+ * mixer is made when there is none yet. Takes ownership of props */
+static struct sample_play *sample_play_new(struct pw_context *context,
+		struct spa_list *mixers, struct sample *sample, uint32_t target,
+		struct pw_properties *props, size_t user_data_size)
+{
+	struct sample_play *p = NULL;
+	struct sample_mixer *m;
+	struct timespec ts;
+	int res;
+
+	if (!sample_spec_valid(&sample->ss) ||
+	    sample->map.channels != sample->ss.channels) {
+		res = -EINVAL;
+		goto error_free;
+	}
+
+	/* the sample props decide the role, the name and event of a sample
+	 * is not a reason for another node */
+	pw_properties_update(props, &sample->props->dict);
+	pw_properties_set(props, PW_KEY_MEDIA_NAME, NULL);
+	pw_properties_set(props, "event.id", NULL);
+
+	p = calloc(1, sizeof(struct sample_play) + user_data_size);
+	if (p == NULL) {
+		res = -errno;
+		goto error_free;
+	}
+
+	spa_hook_list_init(&p->hooks);
+	p->user_data = SPA_MEMBER(p, sizeof(struct sample_play), void);
+	p->stride = sample_spec_frame_size(&sample->ss);
+	if ((p->mix = find_mix_func(sample->ss.format)) == NULL) {
+		res = -ENOTSUP;
+		goto error_free;
+	}
+
+	if ((m = find_sample_mixer(mixers, target, sample, props)) == NULL) {
+		if ((m = sample_mixer_new(context, mixers, target, sample, props)) == NULL) {
+			res = -errno;
+			goto error_free;
+		}
+	} else {
+		sample_mixer_set_name(m, sample->name);
+	}
+	pw_properties_free(props);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	p->start_nsec = SPA_TIMESPEC_TO_NSEC(&ts);
+	p->sample = sample;
+	p->mixer = m;
+	sample->ref++;
+
+	spa_list_append(&m->voices, &p->link);
+	pw_loop_invoke(m->data_loop, do_add_voice, 0, NULL, 0, false, p);
+
+	sample_mixer_set_idle(m, false);
+	pw_loop_signal_event(m->main_loop, m->event);
 
 	return p;
 
-error_cleanup:
-	pw_stream_destroy(p->stream);
 error_free:
-	if (props)
-		pw_properties_free(props);
 	free(p);
+	pw_properties_free(props);
 	errno = -res;
 	return NULL;
 }
@@ -231,7 +609,15 @@ static void sample_play_add_listener(struct sample_play *p,
 
 static void sample_play_destroy(struct sample_play *p)
 {
-	if (p->stream)
-		pw_stream_destroy(p->stream);
+	struct sample_mixer *m = p->mixer;
+
+	if (m != NULL) {
+		pw_loop_invoke(m->data_loop, do_remove_voice, 0, NULL, 0, true, p);
+		spa_list_remove(&p->link);
+		if (m->failed && spa_list_is_empty(&m->voices))
+			sample_mixer_destroy(m);
+	}
+	if (p->sample != NULL && --p->sample->ref == 0)
+		sample_free(p->sample);
 	free(p);
 }
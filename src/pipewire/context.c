@@ -33,6 +33,7 @@
 
 #include <spa/support/cpu.h>
 #include <spa/support/dbus.h>
+#include <spa/support/parallel.h>
 #include <spa/node/utils.h>
 #include <spa/utils/names.h>
 #include <spa/debug/format.h>
@@ -65,6 +66,7 @@
 struct impl {
 	struct pw_context this;
 	struct spa_handle *dbus_handle;
+	struct spa_handle *parallel_handle;
 	unsigned int recalc;
 };
 
@@ -303,6 +305,29 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 			this->support[n_support++] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_DBus, dbus_iface);
 		}
 	}
+	if ((str = pw_properties_get(properties, "support.parallel")) != NULL &&
+	    pw_properties_parse_bool(str)) {
+		struct spa_dict_item items[2];
+		uint32_t n_items = 0;
+		void *parallel_iface = NULL;
+
+		if ((str = pw_properties_get(properties, "support.parallel.threads")) != NULL)
+			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_PARALLEL_THREADS, str);
+		if ((str = pw_properties_get(properties, "support.parallel.rt.prio")) != NULL)
+			items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_PARALLEL_RT_PRIO, str);
+
+		impl->parallel_handle = pw_load_spa_handle("support/libspa-support",
+				SPA_NAME_SUPPORT_PARALLEL, &SPA_DICT_INIT(items, n_items),
+				n_support, this->support);
+
+		if (impl->parallel_handle == NULL ||
+		    (res = spa_handle_get_interface(impl->parallel_handle,
+							SPA_TYPE_INTERFACE_Parallel, &parallel_iface)) < 0) {
+				pw_log_warn(NAME" %p: can't load parallel interface: %s", this, spa_strerror(res));
+		} else {
+			this->support[n_support++] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_Parallel, parallel_iface);
+		}
+	}
 	this->n_support = n_support;
 
 	pw_array_init(&this->factory_lib, 32);
@@ -422,6 +447,8 @@ void pw_context_destroy(struct pw_context *context)
 
 	if (impl->dbus_handle)
 		pw_unload_spa_handle(impl->dbus_handle);
+	if (impl->parallel_handle)
+		pw_unload_spa_handle(impl->parallel_handle);
 
 	pw_array_for_each(entry, &context->factory_lib) {
 		regfree(&entry->regex);
@@ -488,6 +488,24 @@ struct pw_mempool * pw_core_get_mempool(struct pw_core *core)
 	return core->pool;
 }
 
+SPA_EXPORT
+struct pw_memmap *pw_node_clock_map(struct pw_core *core, const struct spa_pod *param)
+{
+	uint32_t id, mem_id, size;
+
+	if (spa_pod_parse_object(param,
+			SPA_TYPE_OBJECT_ParamIO, NULL,
+			SPA_PARAM_IO_id,    SPA_POD_Id(&id),
+			SPA_PARAM_IO_memId, SPA_POD_Int(&mem_id),
+			SPA_PARAM_IO_size,  SPA_POD_Int(&size)) < 0 ||
+	    id != SPA_IO_Clock || size < sizeof(struct pw_node_clock)) {
+		errno = EINVAL;
+		return NULL;
+	}
+	return pw_mempool_map_id(core->pool, mem_id, PW_MEMMAP_FLAG_READ,
+			0, sizeof(struct pw_node_clock), NULL);
+}
+
 SPA_EXPORT
 int pw_core_disconnect(struct pw_core *core)
 {
@@ -51,6 +51,7 @@
 #define MAX_PORTS	1024
 
 static float empty[MAX_SAMPLES];
+static float discard[MAX_SAMPLES];
 static bool mlock_warned = false;
 
 static uint32_t mappable_dataTypes = (1<<SPA_DATA_MemFd);
@@ -109,6 +110,9 @@ struct port {
 	struct queue dequeued;
 	struct queue queued;
 
+	unsigned int is_dsp:1;		/* 32 bit float mono audio */
+	uint32_t dsp_buffer;		/* buffer used in DSP array mode */
+
 	/* from here is what the caller gets as user_data */
 	uint8_t user_data[0];
 };
@@ -134,6 +138,14 @@ struct filter {
 	struct spa_list port_list;;
 	struct port *ports[2][MAX_PORTS];
 
+	/* the audio DSP ports in the order they were added, only changed
+	 * from the data thread */
+	struct {
+		struct port *ports[2][MAX_PORTS];
+		float *data[2][MAX_PORTS];
+		uint32_t n_ports[2];
+	} dsp;
+
 	uint32_t change_mask_all;
 	struct spa_node_info info;
 	struct spa_list param_list;
@@ -152,6 +164,7 @@ struct filter {
 	unsigned int allow_mlock:1;
 	unsigned int warn_mlock:1;
 	unsigned int process_rt:1;
+	unsigned int dsp_array:1;
 };
 
 static int get_param_index(uint32_t id)
@@ -364,6 +377,28 @@ do_set_position(struct spa_loop *loop,
 	return 0;
 }
 
+static int
+do_update_dsp_ports(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct filter *impl = user_data;
+	struct port *p;
+
+	impl->dsp.n_ports[SPA_DIRECTION_INPUT] = 0;
+	impl->dsp.n_ports[SPA_DIRECTION_OUTPUT] = 0;
+	spa_list_for_each(p, &impl->port_list, link) {
+		if (p->is_dsp)
+			impl->dsp.ports[p->direction][impl->dsp.n_ports[p->direction]++] = p;
+	}
+	return 0;
+}
+
+static void update_dsp_ports(struct filter *impl)
+{
+	pw_loop_invoke(impl->context->data_loop,
+		do_update_dsp_ports, 1, NULL, 0, true, impl);
+}
+
 static int impl_set_io(void *object, uint32_t id, void *data, size_t size)
 {
 	struct filter *impl = object;
@@ -819,6 +854,73 @@ static void call_drained(struct filter *impl)
 		do_call_drained, 1, NULL, 0, false, impl);
 }
 
+/* point the data of the DSP ports straight at the buffers, without going
+ * through the queues. Returns true when nothing was consumed or produced. */
+static inline bool prepare_dsp_buffers(struct filter *impl)
+{
+	struct spa_io_position *pos = impl->rt.position;
+	uint32_t i, n_samples, size;
+	bool drained = true;
+
+	n_samples = pos ? SPA_MIN(pos->clock.duration, MAX_SAMPLES) : 0;
+
+	for (i = 0; i < impl->dsp.n_ports[SPA_DIRECTION_INPUT]; i++) {
+		struct port *p = impl->dsp.ports[SPA_DIRECTION_INPUT][i];
+		struct spa_io_buffers *io = p->io;
+		float *data = empty;
+
+		if (io != NULL &&
+		    io->status == SPA_STATUS_HAVE_DATA &&
+		    io->buffer_id < p->n_buffers) {
+			data = p->buffers[io->buffer_id].this.buffer->datas[0].data;
+			drained = false;
+		}
+		impl->dsp.data[SPA_DIRECTION_INPUT][i] = data;
+	}
+	for (i = 0; i < impl->dsp.n_ports[SPA_DIRECTION_OUTPUT]; i++) {
+		struct port *p = impl->dsp.ports[SPA_DIRECTION_OUTPUT][i];
+		struct spa_io_buffers *io = p->io;
+		struct spa_data *d;
+		float *data = discard;
+
+		p->dsp_buffer = SPA_ID_INVALID;
+		if (io != NULL &&
+		    io->status != SPA_STATUS_HAVE_DATA &&
+		    p->n_buffers > 0) {
+			/* the consumer is done with the buffer, reuse it */
+			p->dsp_buffer = io->buffer_id < p->n_buffers ? io->buffer_id : 0;
+			d = &p->buffers[p->dsp_buffer].this.buffer->datas[0];
+			size = SPA_MIN(n_samples * sizeof(float), d->maxsize);
+			d->chunk->offset = 0;
+			d->chunk->size = size;
+			d->chunk->stride = sizeof(float);
+			d->chunk->flags = 0;
+			data = d->data;
+			drained = false;
+		}
+		impl->dsp.data[SPA_DIRECTION_OUTPUT][i] = data;
+	}
+	return drained;
+}
+
+static inline void finish_dsp_buffers(struct filter *impl)
+{
+	uint32_t i;
+
+	for (i = 0; i < impl->dsp.n_ports[SPA_DIRECTION_INPUT]; i++) {
+		struct spa_io_buffers *io = impl->dsp.ports[SPA_DIRECTION_INPUT][i]->io;
+		if (io != NULL && io->status == SPA_STATUS_HAVE_DATA)
+			io->status = SPA_STATUS_NEED_DATA;
+	}
+	for (i = 0; i < impl->dsp.n_ports[SPA_DIRECTION_OUTPUT]; i++) {
+		struct port *p = impl->dsp.ports[SPA_DIRECTION_OUTPUT][i];
+		if (p->dsp_buffer == SPA_ID_INVALID)
+			continue;
+		p->io->buffer_id = p->dsp_buffer;
+		p->io->status = SPA_STATUS_HAVE_DATA;
+	}
+}
+
 static int impl_node_process(void *object)
 {
 	struct filter *impl = object;
@@ -828,12 +930,16 @@ static int impl_node_process(void *object)
 
 	pw_log_trace(NAME" %p: do process %p", impl, impl->rt.position);
 
+	if (impl->dsp_array)
+		drained = prepare_dsp_buffers(impl);
+
 	/** first dequeue and recycle buffers */
 	spa_list_for_each(p, &impl->port_list, link) {
 		struct spa_io_buffers *io = p->io;
 
 		if (io == NULL ||
-		    io->buffer_id >= p->n_buffers)
+		    io->buffer_id >= p->n_buffers ||
+		    (p->is_dsp && impl->dsp_array))
 			continue;
 
 		if (p->direction == SPA_DIRECTION_INPUT) {
@@ -859,11 +965,15 @@ static int impl_node_process(void *object)
 	copy_position(impl);
 	call_process(impl);
 
+	if (impl->dsp_array)
+		finish_dsp_buffers(impl);
+
 	/** recycle/push queued buffers */
 	spa_list_for_each(p, &impl->port_list, link) {
 		struct spa_io_buffers *io = p->io;
 
-		if (io == NULL)
+		if (io == NULL ||
+		    (p->is_dsp && impl->dsp_array))
 			continue;
 
 		if (p->direction == SPA_DIRECTION_INPUT) {
@@ -1245,6 +1355,11 @@ pw_filter_connect(struct pw_filter *filter,
 	impl->flags = flags;
 
 	impl->process_rt = SPA_FLAG_IS_SET(flags, PW_FILTER_FLAG_RT_PROCESS);
+	impl->dsp_array = SPA_FLAG_IS_SET(flags, PW_FILTER_FLAG_DSP_ARRAY);
+	if (impl->dsp_array && !impl->process_rt) {
+		pw_log_warn(NAME" %p: DSP_ARRAY needs RT_PROCESS, ignored", filter);
+		impl->dsp_array = false;
+	}
 
 	if ((str = pw_properties_get(filter->properties, "mem.warn-mlock")) != NULL)
 		impl->warn_mlock = pw_properties_parse_bool(str);
@@ -1437,8 +1552,10 @@ void *pw_filter_add_port(struct pw_filter *filter,
 	/* first configure default params */
 	add_port_params(impl, p);
 	if ((str = pw_properties_get(props, PW_KEY_FORMAT_DSP)) != NULL) {
-		if (!strcmp(str, "32 bit float mono audio"))
+		if (!strcmp(str, "32 bit float mono audio")) {
 			add_audio_dsp_port_params(impl, p);
+			p->is_dsp = true;
+		}
 		else if (!strcmp(str, "32 bit float RGBA video"))
 			add_video_dsp_port_params(impl, p);
 		else if (!strcmp(str, "8 bit raw midi") ||
@@ -1468,6 +1585,9 @@ void *pw_filter_add_port(struct pw_filter *filter,
 
 	emit_port_info(impl, p, true);
 
+	if (p->is_dsp)
+		update_dsp_ports(impl);
+
 	return p->user_data;
 
 
@@ -1490,6 +1610,8 @@ int pw_filter_remove_port(void *port_data)
 
 	spa_list_remove(&port->link);
 	impl->ports[port->direction][port->id] = NULL;
+	if (port->is_dsp)
+		update_dsp_ports(impl);
 
 	clear_buffers(port);
 	clear_params(impl, port, SPA_ID_INVALID);
@@ -1652,6 +1774,20 @@ void *pw_filter_get_dsp_buffer(void *port_data, uint32_t n_samples)
 	return d->data;
 }
 
+SPA_EXPORT
+float **pw_filter_get_dsp_buffers(struct pw_filter *filter,
+		enum pw_direction direction, uint32_t *n_buffers)
+{
+	struct filter *impl = SPA_CONTAINER_OF(filter, struct filter, this);
+
+	if (!impl->dsp_array) {
+		*n_buffers = 0;
+		return NULL;
+	}
+	*n_buffers = impl->dsp.n_ports[direction];
+	return impl->dsp.data[direction];
+}
+
 static int
 do_flush(struct spa_loop *loop,
                  bool async, uint32_t seq, const void *data, size_t size, void *user_data)
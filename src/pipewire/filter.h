@@ -112,6 +112,11 @@ enum pw_filter_flags {
 	PW_FILTER_FLAG_DRIVER		= (1 << 1),	/**< be a driver */
 	PW_FILTER_FLAG_RT_PROCESS	= (1 << 2),	/**< call process from the realtime
 							  *  thread */
+	PW_FILTER_FLAG_DSP_ARRAY	= (1 << 3),	/**< make the data of all audio DSP ports
+							  *  available with
+							  *  pw_filter_get_dsp_buffers() without
+							  *  dequeueing buffers. Only used
+							  *  together with RT_PROCESS */
 };
 
 enum pw_filter_port_flags {
@@ -226,6 +231,14 @@ int pw_filter_queue_buffer(void *port_data, struct pw_buffer *buffer);
 /** Get a data pointer to the buffer data */
 void *pw_filter_get_dsp_buffer(void *port_data, uint32_t n_samples);
 
+/** Get the data of all audio DSP ports of \a direction, in the order the
+ * ports were added. Only valid in the process callback of a filter
+ * connected with PW_FILTER_FLAG_DSP_ARRAY. Inputs without data point to
+ * silence, the outputs are sized for the current cycle and are queued
+ * when process returns. */
+float **pw_filter_get_dsp_buffers(struct pw_filter *filter,
+		enum pw_direction direction, uint32_t *n_buffers);
+
 /** Activate or deactivate the filter \memberof pw_filter */
 int pw_filter_set_active(struct pw_filter *filter, bool active);
 
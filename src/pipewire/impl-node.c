@@ -28,6 +28,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
+#include <fcntl.h>
 
 #include <spa/support/system.h>
 #include <spa/pod/parser.h>
@@ -74,6 +75,8 @@ struct resource_data {
 	uint32_t subscribe_ids[MAX_PARAMS];
 	uint32_t n_subscribe_ids;
 
+	struct pw_memblock *clock;	/* clock page imported in the client pool */
+
 	/* for async replies */
 	int seq;
 	int end;
@@ -394,6 +397,45 @@ static int reply_param(void *data, int seq, uint32_t id,
 	return 0;
 }
 
+static int reply_clock_param(struct resource_data *d, int seq,
+		const struct spa_pod *filter)
+{
+	struct pw_impl_node *node = d->node;
+	struct pw_resource *resource = d->resource;
+	struct pw_memblock *m = node->clock;
+	struct spa_pod *param;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[256];
+
+	if (m == NULL || !SPA_FLAG_IS_SET(resource->permissions, PW_PERM_R))
+		return 0;
+
+	if (d->clock == NULL) {
+		d->clock = pw_mempool_import(resource->client->pool,
+				PW_MEMBLOCK_FLAG_READABLE |
+				PW_MEMBLOCK_FLAG_DONT_CLOSE,
+				m->type, m->fd);
+		if (d->clock == NULL)
+			return -errno;
+		pw_log_debug(NAME" %p: resource %p clock page mem:%u", node,
+				resource, d->clock->id);
+	}
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamIO, SPA_PARAM_IO,
+			SPA_PARAM_IO_id,    SPA_POD_Id(SPA_IO_Clock),
+			SPA_PARAM_IO_size,  SPA_POD_Int(sizeof(struct pw_node_clock)),
+			SPA_PARAM_IO_memId, SPA_POD_Int(d->clock->id));
+
+	if (spa_pod_filter(&b, &param, param, filter) < 0)
+		return 0;
+
+	pw_node_resource_param(resource, seq, SPA_PARAM_IO,
+			PW_NODE_CLOCK_PARAM_INDEX, PW_NODE_CLOCK_PARAM_INDEX + 1, param);
+	return 0;
+}
+
 static int node_enum_params(void *object, int seq, uint32_t id,
 		uint32_t index, uint32_t num, const struct spa_pod *filter)
 {
@@ -406,6 +448,15 @@ static int node_enum_params(void *object, int seq, uint32_t id,
 			node, resource, seq, id,
 			spa_debug_type_find_name(spa_type_param, id), index, num);
 
+	/* the clock page is not a param of the node itself, it has its own
+	 * index after the IO params of the node */
+	if (id == SPA_PARAM_IO && index == PW_NODE_CLOCK_PARAM_INDEX) {
+		if ((res = reply_clock_param(data, seq, filter)) < 0)
+			pw_resource_errorf(resource, res,
+					"can't share clock page: %s", spa_strerror(res));
+		return 0;
+	}
+
 	if ((res = pw_impl_node_for_each_param(node, seq, id, index, num,
 				filter, reply_param, data)) < 0) {
 		pw_resource_errorf(resource, res,
@@ -514,6 +565,8 @@ static void resource_destroy(void *data)
 {
 	struct resource_data *d = data;
 	remove_busy_resource(d);
+	if (d->clock)
+		pw_memblock_unref(d->clock);
 	spa_hook_remove(&d->resource_listener);
 	spa_hook_remove(&d->object_listener);
 }
@@ -782,6 +835,54 @@ static uint32_t flp2(uint32_t x)
 	return x - (x >> 1);
 }
 
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS		(1024 + 9)
+#endif
+#ifndef F_SEAL_SEAL
+#define F_SEAL_SEAL		0x0001
+#define F_SEAL_SHRINK		0x0002
+#define F_SEAL_GROW		0x0004
+#endif
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE	0x0010
+#endif
+
+/* the clock page is only needed for drivers. Clients only get to map it
+ * read-only, after the seal only our own mapping can write to it. */
+static void ensure_clock_page(struct pw_impl_node *node)
+{
+	struct pw_memblock *m;
+	unsigned int seals = F_SEAL_GROW | F_SEAL_SHRINK | F_SEAL_FUTURE_WRITE | F_SEAL_SEAL;
+
+	if (node->clock != NULL)
+		return;
+
+	m = pw_mempool_alloc(node->context->pool,
+			PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, sizeof(struct pw_node_clock));
+	if (m == NULL) {
+		pw_log_warn(NAME" %p: can't allocate clock page: %m", node);
+		return;
+	}
+	if (fcntl(m->fd, F_ADD_SEALS, seals) < 0) {
+		/* without F_SEAL_FUTURE_WRITE (Linux 5.1) clients could map the
+		 * page writable again */
+		if (errno == EINVAL)
+			pw_log_info(NAME" %p: F_SEAL_FUTURE_WRITE is not supported, "
+					"not sharing the clock page", node);
+		else
+			pw_log_warn(NAME" %p: can't seal clock page, not sharing it: %m", node);
+		pw_memblock_unref(m);
+		return;
+	}
+	node->clock = m;
+	__atomic_store_n(&node->rt.clock_page, m->map->ptr, __ATOMIC_RELEASE);
+	pw_properties_set(node->properties, PW_KEY_NODE_CLOCK_PAGE, "true");
+
+	pw_log_debug(NAME" %p: clock page mem:%u", node, m->id);
+}
+
 static void check_properties(struct pw_impl_node *node)
 {
 	struct impl *impl = SPA_CONTAINER_OF(node, struct impl, this);
@@ -832,6 +933,8 @@ static void check_properties(struct pw_impl_node *node)
 	if (node->driver != driver) {
 		pw_log_debug(NAME" %p: driver %d -> %d", node, node->driver, driver);
 		node->driver = driver;
+		if (driver)
+			ensure_clock_page(node);
 		if (node->registered) {
 			if (driver)
 				insert_driver(context, node);
@@ -1496,6 +1599,25 @@ static void update_position(struct pw_impl_node *node, int all_ready)
 		a->position.offset += a->position.clock.duration;
 }
 
+/* publish the clock of the driver in the clock page. Readers retry
+ * while the sequence number is odd or changed while copying. */
+static inline void update_clock_page(struct pw_impl_node *node,
+		struct pw_node_activation *a)
+{
+	struct pw_node_clock *page = __atomic_load_n(&node->rt.clock_page, __ATOMIC_ACQUIRE);
+	uint32_t seq;
+
+	if (SPA_UNLIKELY(page == NULL))
+		return;
+
+	seq = page->seq;
+
+	__atomic_store_n(&page->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	page->clock = a->position.clock;
+	__atomic_store_n(&page->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
 static int node_ready(void *data, int status)
 {
 	struct pw_impl_node *node = data, *reposition_node = NULL;
@@ -1568,6 +1690,7 @@ static int node_ready(void *data, int status)
 			do_reposition(node, reposition_node);
 
 		update_position(node, all_ready);
+		update_clock_page(node, a);
 
 		pw_context_driver_emit_start(node->context, node);
 	}
@@ -1746,6 +1869,8 @@ void pw_impl_node_destroy(struct pw_impl_node *node)
 
 	spa_hook_list_clean(&node->listener_list);
 
+	if (node->clock)
+		pw_memblock_unref(node->clock);
 	pw_memblock_unref(node->activation);
 
 	pw_work_queue_destroy(impl->work);
@@ -150,6 +150,8 @@ extern "C" {
 #define PW_KEY_NODE_PAUSE_ON_IDLE	"node.pause-on-idle"	/**< pause the node when idle */
 #define PW_KEY_NODE_CACHE_PARAMS	"node.cache-params"	/**< cache the node params */
 #define PW_KEY_NODE_DRIVER		"node.driver"		/**< node can drive the graph */
+#define PW_KEY_NODE_CLOCK_PAGE		"node.clock-page"	/**< the node shares its clock page, see
+								  *  PW_NODE_CLOCK_PARAM_INDEX */
 #define PW_KEY_NODE_STREAM		"node.stream"		/**< node is a stream, the server side should
 								  *  add a converter */
 /** Port keys */
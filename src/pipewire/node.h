@@ -35,6 +35,7 @@ extern "C" {
 #include <spa/utils/defs.h>
 #include <spa/utils/hook.h>
 #include <spa/node/command.h>
+#include <spa/node/io.h>
 #include <spa/param/param.h>
 
 #include <pipewire/proxy.h>
@@ -79,6 +80,60 @@ struct pw_node_info {
 	uint32_t n_params;			/**< number of items in \a params */
 };
 
+/** The clock page of a driver node \memberof pw_node
+ *
+ * Clients with read permission on a driver node can map the clock page
+ * of the node without joining the graph. Nodes with a clock page have
+ * the PW_KEY_NODE_CLOCK_PAGE property set to "true". Enumerate the
+ * SPA_PARAM_IO param at index PW_NODE_CLOCK_PARAM_INDEX, it has id
+ * SPA_IO_Clock and its memId is the id of the shared memory block in the
+ * core mempool. Map it with pw_node_clock_map(), the block can only be
+ * mapped read-only.
+ *
+ * The page is updated by the driver on each cycle. Use
+ * pw_node_clock_read() to get a consistent copy of the clock. */
+#define PW_NODE_CLOCK_PARAM_INDEX	0x10000	/**< index of the clock page in the
+						  *  IO params of a node */
+struct pw_node_clock {
+	uint32_t seq;			/**< odd while the clock is updated */
+	uint32_t padding;
+	struct spa_io_clock clock;	/**< the clock of the driver */
+};
+
+/** Read a consistent copy of the clock page \memberof pw_node
+ *
+ * \return 0 on success, -EAGAIN when the clock was being updated
+ */
+static inline int pw_node_clock_read(const struct pw_node_clock *page,
+		struct spa_io_clock *clock)
+{
+	uint32_t seq1, seq2, retry;
+
+	for (retry = 0; retry < 16; retry++) {
+		seq1 = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+		if (seq1 & 1)
+			continue;
+		*clock = page->clock;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		seq2 = __atomic_load_n(&page->seq, __ATOMIC_RELAXED);
+		if (seq1 == seq2)
+			return 0;
+	}
+	return -EAGAIN;
+}
+
+struct pw_core;
+struct pw_memmap;
+
+/** Map the clock page of a node \memberof pw_node
+ *
+ * \param core the core of the node proxy
+ * \param param the SPA_PARAM_IO param at index PW_NODE_CLOCK_PARAM_INDEX
+ * \return a read-only map with a struct pw_node_clock, free it with
+ *	pw_memmap_free(), or NULL with errno set on error.
+ */
+struct pw_memmap *pw_node_clock_map(struct pw_core *core, const struct spa_pod *param);
+
 struct pw_node_info *
 pw_node_info_update(struct pw_node_info *info,
 		    const struct pw_node_info *update);
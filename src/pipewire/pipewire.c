@@ -46,6 +46,11 @@
 
 #define SUPPORTLIB	"support/libspa-support"
 
+struct factory_entry {
+	uint32_t hash;
+	const struct spa_handle_factory *factory;
+};
+
 struct plugin {
 	struct spa_list link;
 	char *filename;
@@ -53,6 +58,9 @@ struct plugin {
 	spa_handle_factory_enum_func_t enum_func;
 	struct spa_list handles;
 	int ref;
+	struct factory_entry *factories;
+	uint32_t n_factories;
+	unsigned int indexed:1;
 };
 
 struct handle {
@@ -156,30 +164,105 @@ unref_plugin(struct plugin *plugin)
 		pw_log_debug("unloaded plugin:'%s'", plugin->filename);
 		if (!global_support.in_valgrind)
 			dlclose(plugin->hnd);
+		free(plugin->factories);
 		free(plugin->filename);
 		free(plugin);
 	}
 }
 
-static const struct spa_handle_factory *find_factory(struct plugin *plugin, const char *factory_name)
+static uint32_t factory_hash(const char *name)
 {
-	int res = -ENOENT;
-	uint32_t index;
-        const struct spa_handle_factory *factory;
+	uint32_t hash = 2166136261u;
+	while (*name)
+		hash = (hash ^ (uint8_t)*name++) * 16777619u;
+	return hash;
+}
+
+static int factory_entry_compare(const void *a, const void *b)
+{
+	const struct factory_entry *ea = a, *eb = b;
+	return ea->hash < eb->hash ? -1 : ea->hash > eb->hash;
+}
+
+/* enumerate the factories of the plugin once and keep them sorted on the
+ * hash of their name. Handles for factories of an already loaded plugin are
+ * then created with a binary search instead of going through the enum
+ * function again.
+ *
+ * The index only lives as long as the plugin is loaded. There is no cache
+ * on disk: the caller always names the library, and the library needs to
+ * be opened anyway to get to the factory. */
+static int index_factories(struct plugin *plugin)
+{
+	int res;
+	uint32_t index, n_factories = 0, n_alloc = 0;
+	const struct spa_handle_factory *factory;
+	struct factory_entry *factories = NULL, *e;
 
-        for (index = 0;;) {
-                if ((res = plugin->enum_func(&factory, &index)) <= 0) {
-                        if (res == 0)
+	for (index = 0;;) {
+		if ((res = plugin->enum_func(&factory, &index)) <= 0) {
+			if (res == 0)
 				break;
-                        goto out;
-                }
+			goto error;
+		}
 		if (factory->version < 1) {
 			pw_log_warn("factory version %d < 1 not supported",
 					factory->version);
 			continue;
 		}
-                if (strcmp(factory->name, factory_name) == 0)
-                        return factory;
+		if (n_factories == n_alloc) {
+			n_alloc = n_alloc ? n_alloc * 2 : 16;
+			e = reallocarray(factories, n_alloc, sizeof(*e));
+			if (e == NULL) {
+				res = -errno;
+				goto error;
+			}
+			factories = e;
+		}
+		e = &factories[n_factories++];
+		e->hash = factory_hash(factory->name);
+		e->factory = factory;
+	}
+	qsort(factories, n_factories, sizeof(*factories), factory_entry_compare);
+
+	plugin->factories = factories;
+	plugin->n_factories = n_factories;
+	plugin->indexed = true;
+	pw_log_debug("plugin:'%s' has %u factories", plugin->filename,
+			plugin->n_factories);
+	return 0;
+
+error:
+	free(factories);
+	return res;
+}
+
+static const struct spa_handle_factory *find_factory(struct plugin *plugin, const char *factory_name)
+{
+	int res = -ENOENT;
+	uint32_t lo, hi, mid, hash;
+	struct factory_entry *e;
+
+	if (!plugin->indexed &&
+	    (res = index_factories(plugin)) < 0)
+		goto out;
+
+	/* find the first entry with the hash, then check all entries with
+	 * the same hash */
+	hash = factory_hash(factory_name);
+	lo = 0;
+	hi = plugin->n_factories;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (plugin->factories[mid].hash < hash)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	for (e = &plugin->factories[lo];
+	     e < &plugin->factories[plugin->n_factories] && e->hash == hash; e++) {
+		if (strcmp(e->factory->name, factory_name) == 0)
+			return e->factory;
 	}
 	res = -ENOENT;
 out:
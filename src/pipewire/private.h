@@ -661,10 +661,12 @@ struct pw_impl_node {
 	uint32_t max_quantum_size;		/**< max supported quantum */
 	struct spa_source source;		/**< source to remotely trigger this node */
 	struct pw_memblock *activation;
+	struct pw_memblock *clock;		/**< clock page, shared read-only with clients */
 	struct {
 		struct spa_io_clock *clock;	/**< io area of the clock or NULL */
 		struct spa_io_position *position;
 		struct pw_node_activation *activation;
+		struct pw_node_clock *clock_page;	/* clock page updated when driving */
 
 		struct spa_list target_list;		/* list of targets to signal after
 							 * this node */
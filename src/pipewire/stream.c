@@ -30,6 +30,7 @@
 
 #include <spa/buffer/alloc.h>
 #include <spa/param/props.h>
+#include <spa/param/audio/format-utils.h>
 #include <spa/node/io.h>
 #include <spa/node/utils.h>
 #include <spa/utils/ringbuffer.h>
@@ -49,6 +50,11 @@
 #define MASK_BUFFERS	(MAX_BUFFERS-1)
 #define MAX_PORTS	1
 
+#define RING_PERIODS		4
+#define RING_MIN_FRAMES		1024
+#define RING_MAX_FRAMES		(1u << 20)
+#define DEFAULT_QUANTUM		1024u
+
 static bool mlock_warned = false;
 
 static uint32_t mappable_dataTypes = (1<<SPA_DATA_MemFd);
@@ -56,13 +62,22 @@ static uint32_t mappable_dataTypes = (1<<SPA_DATA_MemFd);
 struct buffer {
 	struct pw_buffer this;
 	uint32_t id;
-#define BUFFER_FLAG_MAPPED	(1 << 0)
 #define BUFFER_FLAG_QUEUED	(1 << 1)
 #define BUFFER_FLAG_ADDED	(1 << 2)
 	uint32_t flags;
 	struct spa_meta_busy *busy;
 };
 
+/* the part of an fd that is used by the buffers, mapped once for all of
+ * them */
+struct mem_range {
+	int64_t fd;
+	uint32_t type;
+	uint32_t offset;
+	uint32_t end;
+	struct pw_memmap *map;
+};
+
 struct queue {
 	uint32_t ids[MAX_BUFFERS];
 	struct spa_ringbuffer ring;
@@ -75,6 +90,20 @@ struct data {
 	struct spa_hook stream_listener;
 };
 
+struct ring {
+	struct pw_memblock *mem;
+	uint8_t *data;
+	uint32_t frames;		/* size of the ring in frames, power of 2 */
+	uint32_t mask;
+	uint32_t stride;		/* bytes per frame */
+	uint32_t rate;
+	uint32_t threshold;		/* wakeup threshold in frames */
+	uint32_t xruns;
+	uint32_t reserved;		/* frames handed out by reserve */
+	struct spa_ringbuffer ring;	/* indexes count frames */
+	int fd;				/* eventfd to wake up poll() */
+};
+
 struct param {
 	uint32_t id;
 #define PARAM_FLAG_LOCKED	(1 << 0)
@@ -116,6 +145,7 @@ struct stream {
 	struct spa_io_buffers *io;
 	struct {
 		struct spa_io_position *position;
+		struct ring *ring;
 	} rt;
 
 	uint32_t change_mask_all;
@@ -130,9 +160,14 @@ struct stream {
 	struct buffer buffers[MAX_BUFFERS];
 	uint32_t n_buffers;
 
+	struct pw_mempool *pool;
+	struct pw_array mem_ranges;
+
 	struct queue dequeued;
 	struct queue queued;
 
+	struct ring ring;
+
 	struct data data;
 	uintptr_t seq;
 	struct pw_time time;
@@ -576,54 +611,116 @@ static int impl_port_enum_params(void *object, int seq,
 	return found ? 0 : -ENOENT;
 }
 
-static int map_data(struct stream *impl, struct spa_data *data, int prot)
+static void lock_mem(struct stream *impl, void *ptr, uint32_t size)
 {
-	void *ptr;
-	struct pw_map_range range;
-
-	pw_map_range_init(&range, data->mapoffset, data->maxsize, impl->context->sc_pagesize);
-
-	ptr = mmap(NULL, range.size, prot, MAP_SHARED, data->fd, range.offset);
-	if (ptr == MAP_FAILED) {
-		pw_log_error(NAME" %p: failed to mmap buffer mem: %m", impl);
-		return -errno;
-	}
-
-	data->data = SPA_MEMBER(ptr, range.start, void);
-	pw_log_debug(NAME" %p: fd %"PRIi64" mapped %d %d %p", impl, data->fd,
-			range.offset, range.size, data->data);
-
-	if (impl->allow_mlock && mlock(data->data, data->maxsize) < 0) {
+	if (impl->allow_mlock && mlock(ptr, size) < 0) {
 		if (errno != ENOMEM || !mlock_warned) {
 			pw_log(impl->warn_mlock ? SPA_LOG_LEVEL_WARN : SPA_LOG_LEVEL_DEBUG,
 					NAME" %p: Failed to mlock memory %p %u: %s", impl,
-					data->data, data->maxsize,
+					ptr, size,
 					errno == ENOMEM ?
 					"This is not a problem but for best performance, "
 					"consider increasing RLIMIT_MEMLOCK" : strerror(errno));
 			mlock_warned |= errno == ENOMEM;
 		}
 	}
-	return 0;
 }
 
-static int unmap_data(struct stream *impl, struct spa_data *data)
+static struct mem_range *find_mem_range(struct stream *impl, int64_t fd)
+{
+	struct mem_range *r;
+	pw_array_for_each(r, &impl->mem_ranges) {
+		if (r->fd == fd)
+			return r;
+	}
+	return NULL;
+}
+
+static void unmap_buffers(struct stream *impl)
+{
+	struct mem_range *r;
+
+	pw_array_for_each(r, &impl->mem_ranges) {
+		if (r->map == NULL)
+			continue;
+		pw_log_debug(NAME" %p: fd %"PRIi64" unmapped", impl, r->fd);
+		pw_memmap_free(r->map);
+	}
+	pw_array_reset(&impl->mem_ranges);
+}
+
+/* The buffers are usually allocated at different offsets in the same fd.
+ * Collect the range of every fd first and map each of them only once,
+ * the data then points into the shared mapping. */
+static int map_buffers(struct stream *impl, struct spa_buffer **buffers,
+		uint32_t n_buffers, enum pw_memmap_flags flags)
 {
-	struct pw_map_range range;
+	struct pw_memblock *block;
+	struct mem_range *r;
+	struct spa_data *d;
+	uint32_t i, j;
+	int res;
+
+	for (i = 0; i < n_buffers; i++) {
+		for (j = 0; j < buffers[i]->n_datas; j++) {
+			d = &buffers[i]->datas[j];
+			if ((mappable_dataTypes & (1<<d->type)) == 0)
+				continue;
+
+			if ((r = find_mem_range(impl, d->fd)) == NULL) {
+				r = pw_array_add(&impl->mem_ranges, sizeof(*r));
+				if (r == NULL)
+					return -errno;
+				r->fd = d->fd;
+				r->type = d->type;
+				r->offset = d->mapoffset;
+				r->end = d->mapoffset + d->maxsize;
+				r->map = NULL;
+			} else {
+				r->offset = SPA_MIN(r->offset, d->mapoffset);
+				r->end = SPA_MAX(r->end, d->mapoffset + d->maxsize);
+			}
+		}
+	}
+
+	pw_array_for_each(r, &impl->mem_ranges) {
+		block = pw_mempool_import(impl->pool,
+				PW_MEMBLOCK_FLAG_DONT_CLOSE | PW_MEMBLOCK_FLAG_DONT_NOTIFY,
+				r->type, r->fd);
+		if (block == NULL)
+			return -errno;
 
-	pw_map_range_init(&range, data->mapoffset, data->maxsize, impl->context->sc_pagesize);
+		r->map = pw_memblock_map(block, flags, r->offset, r->end - r->offset, NULL);
+		res = -errno;
+		/* the mapping keeps the block alive */
+		pw_memblock_unref(block);
+		if (r->map == NULL) {
+			pw_log_error(NAME" %p: failed to mmap buffer mem: %s", impl,
+					spa_strerror(res));
+			return res;
+		}
+		pw_log_debug(NAME" %p: fd %"PRIi64" mapped %d %d %p", impl, r->fd,
+				r->offset, r->end - r->offset, r->map->ptr);
 
-	if (munmap(SPA_MEMBER(data->data, -range.start, void), range.size) < 0)
-		pw_log_warn(NAME" %p: failed to unmap: %m", impl);
+		lock_mem(impl, r->map->ptr, r->map->size);
+	}
 
-	pw_log_debug(NAME" %p: fd %"PRIi64" unmapped", impl, data->fd);
+	for (i = 0; i < n_buffers; i++) {
+		for (j = 0; j < buffers[i]->n_datas; j++) {
+			d = &buffers[i]->datas[j];
+			if ((mappable_dataTypes & (1<<d->type)) == 0)
+				continue;
+			r = find_mem_range(impl, d->fd);
+			d->data = SPA_MEMBER(r->map->ptr, d->mapoffset - r->offset, void);
+		}
+	}
 	return 0;
 }
 
 static void clear_buffers(struct pw_stream *stream)
 {
 	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
-	uint32_t i, j;
+	uint32_t i;
 
 	pw_log_debug(NAME" %p: clear buffers %d", stream, impl->n_buffers);
 
@@ -632,21 +729,244 @@ static void clear_buffers(struct pw_stream *stream)
 
 		if (SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_ADDED))
 			pw_stream_emit_remove_buffer(stream, &b->this);
-
-		if (SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_MAPPED)) {
-			for (j = 0; j < b->this.buffer->n_datas; j++) {
-				struct spa_data *d = &b->this.buffer->datas[j];
-				pw_log_debug(NAME" %p: clear buffer %d mem",
-						stream, b->id);
-				unmap_data(impl, d);
-			}
-		}
 	}
+	unmap_buffers(impl);
 	impl->n_buffers = 0;
 	clear_queue(impl, &impl->dequeued);
 	clear_queue(impl, &impl->queued);
 }
 
+static int
+do_set_ring(struct spa_loop *loop,
+		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct stream *impl = user_data;
+	impl->rt.ring = impl->ring.data ? &impl->ring : NULL;
+	return 0;
+}
+
+static void ring_clear(struct stream *impl)
+{
+	struct ring *r = &impl->ring;
+
+	if (r->mem == NULL)
+		return;
+
+	r->data = NULL;
+	pw_loop_invoke(impl->context->data_loop,
+			do_set_ring, 1, NULL, 0, true, impl);
+
+	pw_memblock_unref(r->mem);
+	r->mem = NULL;
+	r->frames = r->mask = r->stride = 0;
+}
+
+static uint32_t audio_stride(const struct spa_audio_info_raw *info)
+{
+	switch (info->format) {
+	case SPA_AUDIO_FORMAT_S8:
+	case SPA_AUDIO_FORMAT_U8:
+		return info->channels;
+	case SPA_AUDIO_FORMAT_S16_LE:
+	case SPA_AUDIO_FORMAT_S16_BE:
+	case SPA_AUDIO_FORMAT_U16_LE:
+	case SPA_AUDIO_FORMAT_U16_BE:
+		return 2 * info->channels;
+	case SPA_AUDIO_FORMAT_S24_LE:
+	case SPA_AUDIO_FORMAT_S24_BE:
+	case SPA_AUDIO_FORMAT_U24_LE:
+	case SPA_AUDIO_FORMAT_U24_BE:
+		return 3 * info->channels;
+	case SPA_AUDIO_FORMAT_S24_32_LE:
+	case SPA_AUDIO_FORMAT_S24_32_BE:
+	case SPA_AUDIO_FORMAT_U24_32_LE:
+	case SPA_AUDIO_FORMAT_U24_32_BE:
+	case SPA_AUDIO_FORMAT_S32_LE:
+	case SPA_AUDIO_FORMAT_S32_BE:
+	case SPA_AUDIO_FORMAT_U32_LE:
+	case SPA_AUDIO_FORMAT_U32_BE:
+	case SPA_AUDIO_FORMAT_F32_LE:
+	case SPA_AUDIO_FORMAT_F32_BE:
+		return 4 * info->channels;
+	case SPA_AUDIO_FORMAT_F64_LE:
+	case SPA_AUDIO_FORMAT_F64_BE:
+		return 8 * info->channels;
+	default:
+		return 0;
+	}
+}
+
+/* size the ring for RING_PERIODS quantums of the requested node latency */
+static int ring_setup(struct stream *impl, const struct spa_pod *format)
+{
+	struct ring *r = &impl->ring;
+	struct spa_audio_info_raw info;
+	uint32_t media_type, media_subtype, frames, num = DEFAULT_QUANTUM, denom = 0;
+	const char *str;
+
+	ring_clear(impl);
+
+	if (format == NULL)
+		return 0;
+
+	spa_zero(info);
+	if (spa_format_parse(format, &media_type, &media_subtype) < 0 ||
+	    media_type != SPA_MEDIA_TYPE_audio ||
+	    media_subtype != SPA_MEDIA_SUBTYPE_raw ||
+	    spa_format_audio_raw_parse(format, &info) < 0 ||
+	    info.rate == 0 ||
+	    (r->stride = audio_stride(&info)) == 0) {
+		pw_log_error(NAME" %p: ring mode needs interleaved raw audio", impl);
+		return -ENOTSUP;
+	}
+	r->rate = info.rate;
+
+	if ((str = pw_properties_get(impl->this.properties, PW_KEY_NODE_LATENCY)) != NULL &&
+	    sscanf(str, "%u/%u", &num, &denom) == 2 && denom > 0)
+		num = (uint32_t)((uint64_t)num * info.rate / denom);
+
+	frames = SPA_CLAMP(num * RING_PERIODS, RING_MIN_FRAMES, RING_MAX_FRAMES);
+	r->frames = 1;
+	while (r->frames < frames)
+		r->frames <<= 1;
+	r->mask = r->frames - 1;
+	if (r->threshold == 0 || r->threshold > r->frames)
+		r->threshold = r->frames / RING_PERIODS;
+
+	r->mem = pw_mempool_alloc(impl->context->pool,
+			PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_SEAL |
+			PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, r->frames * r->stride);
+	if (r->mem == NULL)
+		return -errno;
+
+	spa_ringbuffer_init(&r->ring);
+	r->reserved = 0;
+	r->xruns = 0;
+	r->data = r->mem->map->ptr;
+
+	pw_log_debug(NAME" %p: ring %u frames stride:%u rate:%u threshold:%u", impl,
+			r->frames, r->stride, r->rate, r->threshold);
+
+	pw_loop_invoke(impl->context->data_loop,
+			do_set_ring, 1, NULL, 0, true, impl);
+	return 0;
+}
+
+/* the application can write or read at least threshold frames */
+static inline bool ring_ready(struct stream *impl, struct ring *r)
+{
+	uint32_t index;
+	int32_t filled;
+
+	if (impl->direction == SPA_DIRECTION_OUTPUT) {
+		filled = spa_ringbuffer_get_write_index(&r->ring, &index);
+		return r->frames - SPA_CLAMP(filled, 0, (int32_t)r->frames) >= r->threshold;
+	} else {
+		filled = spa_ringbuffer_get_read_index(&r->ring, &index);
+		return SPA_MAX(filled, 0) >= (int32_t)r->threshold;
+	}
+}
+
+/* called from the data thread after it changed the fill level */
+static inline void ring_signal(struct stream *impl, struct ring *r)
+{
+	if (ring_ready(impl, r))
+		spa_system_eventfd_write(impl->context->data_system, r->fd, 1);
+}
+
+/* clear the wakeup when the ring is not ready for the application. The
+ * data thread can make the ring ready between the check and the read of
+ * the eventfd, check again so that its wakeup is not lost. */
+static inline void ring_unsignal(struct stream *impl, struct ring *r)
+{
+	uint64_t count;
+
+	if (ring_ready(impl, r))
+		return;
+	spa_system_eventfd_read(impl->context->data_system, r->fd, &count);
+	if (ring_ready(impl, r))
+		spa_system_eventfd_write(impl->context->data_system, r->fd, 1);
+}
+
+/* copy frames from the ring into a free buffer and queue it */
+static void ring_output(struct stream *impl, struct ring *r)
+{
+	struct buffer *b;
+	struct spa_data *d;
+	uint32_t index, n_frames, offset, l0;
+	int32_t avail;
+
+	avail = spa_ringbuffer_get_read_index(&r->ring, &index);
+	if (avail <= 0) {
+		if (!impl->draining && !impl->drained)
+			r->xruns++;
+		ring_signal(impl, r);
+		return;
+	}
+	if ((b = pop_queue(impl, &impl->dequeued)) == NULL)
+		return;
+
+	d = &b->this.buffer->datas[0];
+	if (SPA_UNLIKELY(d->data == NULL)) {
+		push_queue(impl, &impl->dequeued, b);
+		return;
+	}
+	n_frames = SPA_MIN((uint32_t)avail, d->maxsize / r->stride);
+	if (impl->rt.position)
+		n_frames = SPA_MIN(n_frames, impl->rt.position->clock.duration);
+
+	offset = index & r->mask;
+	l0 = SPA_MIN(n_frames, r->frames - offset);
+	memcpy(d->data, r->data + offset * r->stride, l0 * r->stride);
+	if (l0 < n_frames)
+		memcpy(SPA_MEMBER(d->data, l0 * r->stride, void),
+				r->data, (n_frames - l0) * r->stride);
+	spa_ringbuffer_read_update(&r->ring, index + n_frames);
+
+	d->chunk->offset = 0;
+	d->chunk->size = n_frames * r->stride;
+	d->chunk->stride = r->stride;
+	b->this.size = n_frames;
+	push_queue(impl, &impl->queued, b);
+
+	ring_signal(impl, r);
+}
+
+/* append the data of a captured buffer to the ring */
+static void ring_input(struct stream *impl, struct ring *r, struct buffer *b)
+{
+	struct spa_data *d = &b->this.buffer->datas[0];
+	uint32_t index, n_frames, offset, l0, size;
+	int32_t filled;
+
+	if (SPA_UNLIKELY(d->data == NULL))
+		return;
+
+	offset = SPA_MIN(d->chunk->offset, d->maxsize);
+	size = SPA_MIN(d->chunk->size, d->maxsize - offset);
+	n_frames = size / r->stride;
+
+	filled = spa_ringbuffer_get_write_index(&r->ring, &index);
+	if ((uint32_t)filled + n_frames > r->frames) {
+		r->xruns++;
+		n_frames = filled < (int32_t)r->frames ? r->frames - filled : 0;
+	}
+	if (n_frames > 0) {
+		const uint8_t *src = SPA_MEMBER(d->data, offset, uint8_t);
+		uint32_t o = index & r->mask;
+
+		l0 = SPA_MIN(n_frames, r->frames - o);
+		memcpy(r->data + o * r->stride, src, l0 * r->stride);
+		if (l0 < n_frames)
+			memcpy(r->data, src + l0 * r->stride,
+					(n_frames - l0) * r->stride);
+		spa_ringbuffer_write_update(&r->ring, index + n_frames);
+	}
+	ring_signal(impl, r);
+}
+
 static int impl_port_set_param(void *object,
 			       enum spa_direction direction, uint32_t port_id,
 			       uint32_t id, uint32_t flags,
@@ -668,8 +988,15 @@ static int impl_port_set_param(void *object,
 	if ((res = update_params(impl, id, &param, param ? 1 : 0)) < 0)
 		return res;
 
-	if (id == SPA_PARAM_Format)
+	if (id == SPA_PARAM_Format) {
 		clear_buffers(stream);
+		if (SPA_FLAG_IS_SET(impl->flags, PW_STREAM_FLAG_RING) &&
+		    (res = ring_setup(impl, param)) < 0) {
+			pw_stream_set_error(stream, res, "can't configure ring: %s",
+					spa_strerror(res));
+			return res;
+		}
+	}
 
 	pw_stream_emit_param_changed(stream, id, param);
 
@@ -689,16 +1016,22 @@ static int impl_port_use_buffers(void *object,
 	struct stream *impl = object;
 	struct pw_stream *stream = &impl->this;
 	uint32_t i, j, impl_flags = impl->flags;
-	int prot, res;
+	enum pw_memmap_flags prot;
+	int res;
 	int size = 0;
 
 	if (impl->disconnecting && n_buffers > 0)
 		return -EIO;
 
-	prot = PROT_READ | (direction == SPA_DIRECTION_OUTPUT ? PROT_WRITE : 0);
+	prot = PW_MEMMAP_FLAG_READ |
+		(direction == SPA_DIRECTION_OUTPUT ? PW_MEMMAP_FLAG_WRITE : 0);
 
 	clear_buffers(stream);
 
+	if (SPA_FLAG_IS_SET(impl_flags, PW_STREAM_FLAG_MAP_BUFFERS) &&
+	    (res = map_buffers(impl, buffers, n_buffers, prot)) < 0)
+		goto error_unmap;
+
 	for (i = 0; i < n_buffers; i++) {
 		int buf_size = 0;
 		struct buffer *b = &impl->buffers[i];
@@ -709,21 +1042,24 @@ static int impl_port_use_buffers(void *object,
 		if (SPA_FLAG_IS_SET(impl_flags, PW_STREAM_FLAG_MAP_BUFFERS)) {
 			for (j = 0; j < buffers[i]->n_datas; j++) {
 				struct spa_data *d = &buffers[i]->datas[j];
-				if ((mappable_dataTypes & (1<<d->type)) > 0) {
-					if ((res = map_data(impl, d, prot)) < 0)
-						return res;
-					SPA_FLAG_SET(b->flags, BUFFER_FLAG_MAPPED);
-				}
-				else if (d->type == SPA_DATA_MemPtr && d->data == NULL) {
+				if (d->type == SPA_DATA_MemPtr && d->data == NULL) {
 					pw_log_error(NAME" %p: invalid buffer mem", stream);
-					return -EINVAL;
+					res = -EINVAL;
+					goto error_unmap;
+				}
+				if (SPA_FLAG_IS_SET(impl_flags, PW_STREAM_FLAG_RING) &&
+				    d->data == NULL) {
+					pw_log_error(NAME" %p: ring mode needs mappable buffers", stream);
+					res = -ENOTSUP;
+					goto error_unmap;
 				}
 				buf_size += d->maxsize;
 			}
 
 			if (size > 0 && buf_size != size) {
 				pw_log_error(NAME" %p: invalid buffer size %d", stream, buf_size);
-				return -EINVAL;
+				res = -EINVAL;
+				goto error_unmap;
 			} else
 				size = buf_size;
 		}
@@ -750,6 +1086,10 @@ static int impl_port_use_buffers(void *object,
 	impl->n_buffers = n_buffers;
 
 	return 0;
+
+error_unmap:
+	unmap_buffers(impl);
+	return res;
 }
 
 static int impl_port_reuse_buffer(void *object, uint32_t port_id, uint32_t buffer_id)
@@ -784,6 +1124,7 @@ static int impl_node_process_input(void *object)
 	struct stream *impl = object;
 	struct pw_stream *stream = &impl->this;
 	struct spa_io_buffers *io = impl->io;
+	struct ring *r = impl->rt.ring;
 	struct buffer *b;
 
 	pw_log_trace(NAME" %p: process in status:%d id:%d ticks:%"PRIu64" delay:%"PRIi64,
@@ -791,8 +1132,14 @@ static int impl_node_process_input(void *object)
 
 	if (io->status == SPA_STATUS_HAVE_DATA &&
 	    (b = get_buffer(stream, io->buffer_id)) != NULL) {
+		if (r != NULL) {
+			/* copy into the ring and recycle the buffer right away */
+			ring_input(impl, r, b);
+			copy_position(impl, 0);
+			push_queue(impl, &impl->queued, b);
+		}
 		/* push new buffer */
-		if (push_queue(impl, &impl->dequeued, b) == 0) {
+		else if (push_queue(impl, &impl->dequeued, b) == 0) {
 			copy_position(impl, impl->dequeued.incount);
 			if (b->busy)
 				ATOMIC_INC(b->busy->count);
@@ -816,6 +1163,7 @@ static int impl_node_process_output(void *object)
 	struct stream *impl = object;
 	struct pw_stream *stream = &impl->this;
 	struct spa_io_buffers *io = impl->io;
+	struct ring *r = impl->rt.ring;
 	struct buffer *b;
 	int res;
 	uint32_t index;
@@ -830,6 +1178,8 @@ again:
 			pw_log_trace(NAME" %p: recycle buffer %d", stream, b->id);
 			push_queue(impl, &impl->dequeued, b);
 		}
+		if (r != NULL)
+			ring_output(impl, r);
 
 		/* pop new buffer */
 		if ((b = pop_queue(impl, &impl->queued)) != NULL) {
@@ -852,7 +1202,7 @@ again:
 
 	copy_position(impl, impl->queued.outcount);
 
-	if (!impl->draining &&
+	if (!impl->draining && r == NULL &&
 	    !SPA_FLAG_IS_SET(impl->flags, PW_STREAM_FLAG_DRIVER)) {
 		/* we're not draining, not a driver check if we need to get
 		 * more buffers */
@@ -1168,6 +1518,12 @@ stream_new(struct pw_context *context, const char *name,
 		res = -errno;
 		goto error_properties;
 	}
+	impl->pool = pw_mempool_new(NULL);
+	if (impl->pool == NULL) {
+		res = -errno;
+		goto error_properties;
+	}
+	pw_array_init(&impl->mem_ranges, 4 * sizeof(struct mem_range));
 
 	this = &impl->this;
 	pw_log_debug(NAME" %p: new \"%s\"", impl, name);
@@ -1213,6 +1569,8 @@ stream_new(struct pw_context *context, const char *name,
 
 	this->state = PW_STREAM_STATE_UNCONNECTED;
 
+	impl->ring.fd = -1;
+
 	impl->context = context;
 	impl->allow_mlock = context->defaults.mem_allow_mlock;
 	impl->warn_mlock = context->defaults.mem_warn_mlock;
@@ -1223,6 +1581,8 @@ stream_new(struct pw_context *context, const char *name,
 	return impl;
 
 error_properties:
+	if (impl->pool)
+		pw_mempool_destroy(impl->pool);
 	if (impl->port_props)
 		pw_properties_free(impl->port_props);
 	free(impl);
@@ -1339,6 +1699,10 @@ void pw_stream_destroy(struct pw_stream *stream)
 
 	clear_params(impl, SPA_ID_INVALID);
 
+	ring_clear(impl);
+	if (impl->ring.fd != -1)
+		spa_system_close(impl->context->data_system, impl->ring.fd);
+
 	pw_log_debug(NAME" %p: free", stream);
 	free(stream->error);
 
@@ -1359,6 +1723,10 @@ void pw_stream_destroy(struct pw_stream *stream)
 	if (impl->data.context)
 		pw_context_destroy(impl->data.context);
 
+	unmap_buffers(impl);
+	pw_array_clear(&impl->mem_ranges);
+	pw_mempool_destroy(impl->pool);
+
 	pw_properties_free(impl->port_props);
 	free(impl);
 }
@@ -1506,6 +1874,9 @@ pw_stream_connect(struct pw_stream *stream,
 	pw_log_debug(NAME" %p: connect target:%d", stream, target_id);
 	impl->direction =
 	    direction == PW_DIRECTION_INPUT ? SPA_DIRECTION_INPUT : SPA_DIRECTION_OUTPUT;
+	/* the ring copies to and from the buffer memory */
+	if (SPA_FLAG_IS_SET(flags, PW_STREAM_FLAG_RING))
+		flags |= PW_STREAM_FLAG_MAP_BUFFERS;
 	impl->flags = flags;
 	impl->node_methods = impl_node;
 
@@ -1565,6 +1936,16 @@ pw_stream_connect(struct pw_stream *stream,
 
 	impl->process_rt = SPA_FLAG_IS_SET(flags, PW_STREAM_FLAG_RT_PROCESS);
 
+	if (SPA_FLAG_IS_SET(flags, PW_STREAM_FLAG_RING) && impl->ring.fd == -1) {
+		impl->ring.fd = spa_system_eventfd_create(impl->context->data_system,
+				SPA_FD_CLOEXEC | SPA_FD_NONBLOCK);
+		if (impl->ring.fd < 0) {
+			res = impl->ring.fd;
+			impl->ring.fd = -1;
+			goto error_connect;
+		}
+	}
+
 	if ((str = pw_properties_get(stream->properties, "mem.warn-mlock")) != NULL)
 		impl->warn_mlock = pw_properties_parse_bool(str);
 
@@ -1755,6 +2136,28 @@ int pw_stream_update_params(struct pw_stream *stream,
 	return res;
 }
 
+static void add_control_value(struct spa_pod_builder *b, struct control *c,
+		uint32_t n_values, const float *values)
+{
+	spa_pod_builder_prop(b, c->id, 0);
+	switch (c->container) {
+	case SPA_TYPE_Float:
+		spa_pod_builder_float(b, values[0]);
+		break;
+	case SPA_TYPE_Bool:
+		spa_pod_builder_bool(b, values[0] < 0.5 ? false : true);
+		break;
+	case SPA_TYPE_Array:
+		spa_pod_builder_array(b,
+				sizeof(float), SPA_TYPE_Float,
+				n_values, values);
+		break;
+	default:
+		spa_pod_builder_none(b);
+		break;
+	}
+}
+
 SPA_EXPORT
 int pw_stream_set_control(struct pw_stream *stream, uint32_t id, uint32_t n_values, float *values, ...)
 {
@@ -1773,23 +2176,7 @@ int pw_stream_set_control(struct pw_stream *stream, uint32_t id, uint32_t n_valu
 		pw_log_debug(NAME" %p: set control %d %d %f", stream, id, n_values, values[0]);
 
 		if ((c = find_control(stream, id))) {
-			spa_pod_builder_prop(&b, id, 0);
-			switch (c->container) {
-			case SPA_TYPE_Float:
-				spa_pod_builder_float(&b, values[0]);
-				break;
-			case SPA_TYPE_Bool:
-				spa_pod_builder_bool(&b, values[0] < 0.5 ? false : true);
-				break;
-			case SPA_TYPE_Array:
-				spa_pod_builder_array(&b,
-						sizeof(float), SPA_TYPE_Float,
-						n_values, values);
-				break;
-			default:
-				spa_pod_builder_none(&b);
-				break;
-			}
+			add_control_value(&b, c, n_values, values);
 		} else {
 			pw_log_warn(NAME" %p: unknown control with id %d", stream, id);
 		}
@@ -1807,6 +2194,61 @@ int pw_stream_set_control(struct pw_stream *stream, uint32_t id, uint32_t n_valu
 	return 0;
 }
 
+SPA_EXPORT
+int pw_stream_update_controls(struct pw_stream *stream,
+		const struct pw_stream_control_value *values, uint32_t n_values,
+		uint32_t ramp_samples, uint32_t ramp_scale)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	struct spa_pod_builder b = { 0 };
+	struct spa_pod_frame f[1];
+	struct spa_pod *pod;
+	struct control *c;
+	size_t size = 256;
+	void *buf;
+	uint32_t i;
+	int res;
+
+	if (impl->node == NULL)
+		return -EIO;
+	/* the ramp is sent as an Int */
+	if (ramp_samples > INT32_MAX)
+		return -EINVAL;
+
+	for (i = 0; i < n_values; i++)
+		size += 48 + values[i].n_values * sizeof(float);
+
+	if ((buf = malloc(size)) == NULL)
+		return -errno;
+
+	spa_pod_builder_init(&b, buf, size);
+	spa_pod_builder_push_object(&b, &f[0], SPA_TYPE_OBJECT_Props, SPA_PARAM_Props);
+	for (i = 0; i < n_values; i++) {
+		if ((c = find_control(stream, values[i].id)) == NULL) {
+			pw_log_warn(NAME" %p: unknown control with id %d", stream, values[i].id);
+			continue;
+		}
+		if (values[i].n_values == 0)
+			continue;
+		add_control_value(&b, c, values[i].n_values, values[i].values);
+	}
+	if (ramp_samples > 0 && ramp_scale != SPA_PROP_VOLUME_RAMP_NONE) {
+		spa_pod_builder_add(&b,
+			SPA_PROP_volumeRampSamples, SPA_POD_Int(ramp_samples),
+			SPA_PROP_volumeRampScale, SPA_POD_Id(ramp_scale),
+			0);
+	}
+	pod = spa_pod_builder_pop(&b, &f[0]);
+
+	pw_log_debug(NAME" %p: update %u controls ramp:%u scale:%u", stream,
+			n_values, ramp_samples, ramp_scale);
+
+	res = pw_impl_node_set_param(impl->node, SPA_PARAM_Props, 0, pod);
+	free(buf);
+
+	return res < 0 ? res : 0;
+}
+
 SPA_EXPORT
 const struct pw_stream_control *pw_stream_get_control(struct pw_stream *stream, uint32_t id)
 {
@@ -1939,6 +2381,9 @@ do_flush(struct spa_loop *loop,
 	impl->queued.outcount = impl->dequeued.incount =
 		impl->dequeued.outcount = impl->queued.incount = 0;
 
+	if (impl->rt.ring)
+		spa_ringbuffer_init(&impl->rt.ring->ring);
+
 	return 0;
 }
 static int
@@ -1963,3 +2408,144 @@ int pw_stream_flush(struct pw_stream *stream, bool drain)
 				&SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Flush));
 	return 0;
 }
+
+SPA_EXPORT
+int pw_stream_ring_get_info(struct pw_stream *stream, struct pw_stream_ring_info *info)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	struct ring *r = &impl->ring;
+	uint32_t index;
+	int32_t filled;
+
+	if (r->data == NULL)
+		return -EIO;
+
+	if (impl->direction == SPA_DIRECTION_OUTPUT)
+		filled = spa_ringbuffer_get_write_index(&r->ring, &index);
+	else
+		filled = spa_ringbuffer_get_read_index(&r->ring, &index);
+
+	info->frames = r->frames;
+	info->stride = r->stride;
+	info->rate = r->rate;
+	info->threshold = r->threshold;
+	info->filled = SPA_CLAMP(filled, 0, (int32_t)r->frames);
+	info->xruns = r->xruns;
+	info->latency = (uint64_t)info->filled * SPA_NSEC_PER_SEC / r->rate;
+	info->fd = r->mem->fd;
+	return 0;
+}
+
+SPA_EXPORT
+int pw_stream_ring_get_poll_fd(struct pw_stream *stream)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	return impl->ring.fd >= 0 ? impl->ring.fd : -ENOTSUP;
+}
+
+SPA_EXPORT
+int pw_stream_ring_set_threshold(struct pw_stream *stream, uint32_t frames)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	struct ring *r = &impl->ring;
+
+	if (r->frames > 0 && (frames == 0 || frames > r->frames))
+		return -EINVAL;
+	r->threshold = frames;
+	return 0;
+}
+
+SPA_EXPORT
+int32_t pw_stream_ring_reserve(struct pw_stream *stream, void **data)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	struct ring *r = &impl->ring;
+	uint32_t index, offset, avail;
+	int32_t filled;
+
+	if (r->data == NULL)
+		return -EIO;
+
+	ring_unsignal(impl, r);
+
+	if (impl->direction == SPA_DIRECTION_OUTPUT) {
+		filled = spa_ringbuffer_get_write_index(&r->ring, &index);
+		avail = filled < (int32_t)r->frames ? r->frames - SPA_MAX(filled, 0) : 0;
+	} else {
+		filled = spa_ringbuffer_get_read_index(&r->ring, &index);
+		avail = SPA_CLAMP(filled, 0, (int32_t)r->frames);
+	}
+	offset = index & r->mask;
+	r->reserved = SPA_MIN(avail, r->frames - offset);
+	*data = r->data + offset * r->stride;
+	return r->reserved;
+}
+
+SPA_EXPORT
+int pw_stream_ring_commit(struct pw_stream *stream, uint32_t frames)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	struct ring *r = &impl->ring;
+	uint32_t index;
+
+	if (r->data == NULL)
+		return -EIO;
+	if (frames > r->reserved)
+		return -EINVAL;
+
+	if (impl->direction == SPA_DIRECTION_OUTPUT) {
+		spa_ringbuffer_get_write_index(&r->ring, &index);
+		spa_ringbuffer_write_update(&r->ring, index + frames);
+	} else {
+		spa_ringbuffer_get_read_index(&r->ring, &index);
+		spa_ringbuffer_read_update(&r->ring, index + frames);
+	}
+	r->reserved = 0;
+	return 0;
+}
+
+SPA_EXPORT
+int32_t pw_stream_ring_write(struct pw_stream *stream, const void *data, uint32_t frames)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	uint32_t done = 0;
+	int32_t res = 0;
+	void *dst;
+
+	if (impl->direction != SPA_DIRECTION_OUTPUT)
+		return -ENOTSUP;
+
+	while (done < frames) {
+		if ((res = pw_stream_ring_reserve(stream, &dst)) <= 0)
+			break;
+		res = SPA_MIN((uint32_t)res, frames - done);
+		memcpy(dst, SPA_MEMBER(data, done * impl->ring.stride, void),
+				res * impl->ring.stride);
+		pw_stream_ring_commit(stream, res);
+		done += res;
+	}
+	return done > 0 ? (int32_t)done : res;
+}
+
+SPA_EXPORT
+int32_t pw_stream_ring_read(struct pw_stream *stream, void *data, uint32_t frames)
+{
+	struct stream *impl = SPA_CONTAINER_OF(stream, struct stream, this);
+	uint32_t done = 0;
+	int32_t res = 0;
+	void *src;
+
+	if (impl->direction != SPA_DIRECTION_INPUT)
+		return -ENOTSUP;
+
+	while (done < frames) {
+		if ((res = pw_stream_ring_reserve(stream, &src)) <= 0)
+			break;
+		res = SPA_MIN((uint32_t)res, frames - done);
+		memcpy(SPA_MEMBER(data, done * impl->ring.stride, void), src,
+				res * impl->ring.stride);
+		pw_stream_ring_commit(stream, res);
+		done += res;
+	}
+	return done > 0 ? (int32_t)done : res;
+}
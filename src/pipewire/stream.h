@@ -254,6 +254,10 @@ enum pw_stream_flags {
 	PW_STREAM_FLAG_ALLOC_BUFFERS	= (1 << 8),	/**< the application will allocate buffer
 							  *  memory. In the add_buffer event, the
 							  *  data of the buffer should be set */
+	PW_STREAM_FLAG_RING		= (1 << 9),	/**< keep the data in an internal ring
+							  *  buffer, use the pw_stream_ring_*
+							  *  functions instead of dequeue/queue.
+							  *  Only for interleaved raw audio. */
 };
 
 /** Create a new unconneced \ref pw_stream \memberof pw_stream
@@ -334,6 +338,24 @@ pw_stream_update_params(struct pw_stream *stream,	/**< a \ref pw_stream */
 /** Set control values */
 int pw_stream_set_control(struct pw_stream *stream, uint32_t id, uint32_t n_values, float *values, ...);
 
+/** A control value for pw_stream_update_controls() */
+struct pw_stream_control_value {
+	uint32_t id;			/**< id of the control */
+	uint32_t n_values;		/**< number of values */
+	const float *values;		/**< the values */
+};
+
+/** Set many controls in one update \memberof pw_stream
+ *
+ * When \a ramp_samples is > 0, volume changes move to the new value
+ * over \a ramp_samples samples with the shape given by \a ramp_scale,
+ * an enum spa_prop_volume_ramp_scale. A new ramp continues from the
+ * current point of a running ramp, so successive calls make a
+ * piecewise curve. */
+int pw_stream_update_controls(struct pw_stream *stream,
+		const struct pw_stream_control_value *values, uint32_t n_values,
+		uint32_t ramp_samples, uint32_t ramp_scale);
+
 /** Query the time on the stream \memberof pw_stream */
 int pw_stream_get_time(struct pw_stream *stream, struct pw_time *time);
 
@@ -351,6 +373,49 @@ int pw_stream_set_active(struct pw_stream *stream, bool active);
  * be called when all data is played or recorded */
 int pw_stream_flush(struct pw_stream *stream, bool drain);
 
+/** State of the ring of a stream connected with PW_STREAM_FLAG_RING \memberof pw_stream */
+struct pw_stream_ring_info {
+	uint32_t frames;		/**< size of the ring in frames */
+	uint32_t stride;		/**< bytes per frame */
+	uint32_t rate;			/**< sample rate */
+	uint32_t threshold;		/**< wakeup threshold in frames */
+	uint32_t filled;		/**< frames queued in the ring */
+	uint32_t xruns;			/**< number of underruns for playback and
+					  *  overruns for capture */
+	uint64_t latency;		/**< time in nanoseconds to play or read
+					  *  the queued frames */
+	int fd;				/**< memfd with the ring memory */
+};
+
+/** Get the ring state. The ring is available after the format is set.
+ * \return 0 on success, -EIO when there is no ring */
+int pw_stream_ring_get_info(struct pw_stream *stream, struct pw_stream_ring_info *info);
+
+/** Get an fd to poll(). It becomes readable when, for playback, at
+ * least threshold frames can be written or, for capture, at least
+ * threshold frames can be read. It is cleared by the next reserve. */
+int pw_stream_ring_get_poll_fd(struct pw_stream *stream);
+
+/** Set the wakeup threshold in frames. Defaults to a quarter of the ring */
+int pw_stream_ring_set_threshold(struct pw_stream *stream, uint32_t frames);
+
+/** Get a pointer to the contiguous region of the ring that can be written
+ * for playback or read for capture.
+ * \return the number of frames in the region or < 0 on error */
+int32_t pw_stream_ring_reserve(struct pw_stream *stream, void **data);
+
+/** Complete a pw_stream_ring_reserve(). \a frames can be less than the
+ * reserved frames */
+int pw_stream_ring_commit(struct pw_stream *stream, uint32_t frames);
+
+/** Copy frames into the ring of a playback stream
+ * \return the number of frames written or < 0 on error */
+int32_t pw_stream_ring_write(struct pw_stream *stream, const void *data, uint32_t frames);
+
+/** Copy frames out of the ring of a capture stream
+ * \return the number of frames read or < 0 on error */
+int32_t pw_stream_ring_read(struct pw_stream *stream, void *data, uint32_t frames);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,286 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <time.h>
+
+#include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/buffer/alloc.h>
+#include <spa/utils/hook.h>
+
+#include <pipewire/impl.h>
+
+/* drive the filter node directly, without a graph, with a number of audio
+ * DSP ports in each direction and a process callback that copies every
+ * input to an output. The node is taken from the context when the filter
+ * exports it, the proxy is never flushed to the server. */
+
+#define N_BUFFERS	2
+#define MAX_SAMPLES	8192
+#define MAX_COUNT	20000
+
+static const uint32_t port_counts[] = { 2, 16, 64 };
+static const uint32_t quantums[] = { 64, 1024 };
+
+struct bench_port {
+	struct spa_io_buffers io;
+	struct spa_buffer **buffers;
+	void *port_data;
+	uint32_t id;
+};
+
+struct bench {
+	struct pw_filter *filter;
+	struct spa_node *node;
+	struct spa_hook listener;
+	struct spa_hook node_listener;
+	struct spa_io_position position;
+	uint32_t n_ports;
+	uint32_t n_added[2];
+	struct bench_port ports[2][64];
+};
+
+static struct spa_node *exported_node;
+
+static struct pw_proxy *export_node(struct pw_core *core,
+		const char *type, const struct spa_dict *props, void *object,
+		size_t user_data_size)
+{
+	exported_node = object;
+	return pw_core_create_object(core, "client-node", PW_TYPE_INTERFACE_Node,
+			PW_VERSION_NODE, props, user_data_size);
+}
+
+static struct pw_export_type export_type = {
+	.type = SPA_TYPE_INTERFACE_Node,
+	.func = export_node,
+};
+
+/* the ports are announced in the order they are added */
+static void node_port_info(void *data, enum spa_direction direction, uint32_t port,
+		const struct spa_port_info *info)
+{
+	struct bench *b = data;
+
+	if (info != NULL && b->n_added[direction] < b->n_ports)
+		b->ports[direction][b->n_added[direction]++].id = port;
+}
+
+static const struct spa_node_events node_events = {
+	SPA_VERSION_NODE_EVENTS,
+	.port_info = node_port_info,
+};
+
+static void on_process_queue(void *data, struct spa_io_position *position)
+{
+	struct bench *b = data;
+	uint32_t i, n_samples = position->clock.duration;
+
+	for (i = 0; i < b->n_ports; i++) {
+		float *in = pw_filter_get_dsp_buffer(b->ports[SPA_DIRECTION_INPUT][i].port_data,
+				n_samples);
+		float *out = pw_filter_get_dsp_buffer(b->ports[SPA_DIRECTION_OUTPUT][i].port_data,
+				n_samples);
+		memcpy(out, in, n_samples * sizeof(float));
+	}
+}
+
+static void on_process_array(void *data, struct spa_io_position *position)
+{
+	struct bench *b = data;
+	uint32_t i, n_in, n_out, n_samples = position->clock.duration;
+	float **in, **out;
+
+	in = pw_filter_get_dsp_buffers(b->filter, PW_DIRECTION_INPUT, &n_in);
+	out = pw_filter_get_dsp_buffers(b->filter, PW_DIRECTION_OUTPUT, &n_out);
+
+	for (i = 0; i < SPA_MIN(n_in, n_out); i++)
+		memcpy(out[i], in[i], n_samples * sizeof(float));
+}
+
+static const struct pw_filter_events queue_events = {
+	PW_VERSION_FILTER_EVENTS,
+	.process = on_process_queue,
+};
+
+static const struct pw_filter_events array_events = {
+	PW_VERSION_FILTER_EVENTS,
+	.process = on_process_array,
+};
+
+static void bench_init(struct bench *b, struct pw_core *core, uint32_t n_ports,
+		bool array)
+{
+	struct spa_data datas[1];
+	uint32_t aligns[1] = { 16 };
+	uint32_t i, j;
+	int res;
+
+	spa_zero(*b);
+	b->n_ports = n_ports;
+
+	b->filter = pw_filter_new(core, "bench", NULL);
+	spa_assert(b->filter != NULL);
+
+	pw_filter_add_listener(b->filter, &b->listener,
+			array ? &array_events : &queue_events, b);
+
+	exported_node = NULL;
+	res = pw_filter_connect(b->filter, PW_FILTER_FLAG_RT_PROCESS |
+			(array ? PW_FILTER_FLAG_DSP_ARRAY : 0), NULL, 0);
+	spa_assert(res == 0);
+	spa_assert(exported_node != NULL);
+	b->node = exported_node;
+
+	spa_node_add_listener(b->node, &b->node_listener, &node_events, b);
+	spa_node_set_io(b->node, SPA_IO_Position, &b->position, sizeof(b->position));
+
+	datas[0].type = SPA_DATA_MemPtr;
+	datas[0].flags = 0;
+	datas[0].fd = -1;
+	datas[0].mapoffset = 0;
+	datas[0].maxsize = MAX_SAMPLES * sizeof(float);
+	datas[0].data = NULL;
+
+	for (i = 0; i < 2; i++) {
+		for (j = 0; j < n_ports; j++) {
+			struct bench_port *bp = &b->ports[i][j];
+
+			bp->port_data = pw_filter_add_port(b->filter, i,
+					PW_FILTER_PORT_FLAG_MAP_BUFFERS, 0,
+					pw_properties_new(
+						PW_KEY_FORMAT_DSP, "32 bit float mono audio",
+						NULL),
+					NULL, 0);
+			spa_assert(bp->port_data != NULL);
+			spa_assert(b->n_added[i] == j + 1);
+
+			bp->buffers = spa_buffer_alloc_array(N_BUFFERS, 0, 0, NULL,
+					1, datas, aligns);
+			spa_assert(bp->buffers != NULL);
+			res = spa_node_port_use_buffers(b->node, i, bp->id, 0,
+					bp->buffers, N_BUFFERS);
+			spa_assert(res == 0);
+
+			bp->io.status = i == SPA_DIRECTION_INPUT ?
+				SPA_STATUS_HAVE_DATA : SPA_STATUS_NEED_DATA;
+			bp->io.buffer_id = i == SPA_DIRECTION_INPUT ? 0 : SPA_ID_INVALID;
+			res = spa_node_port_set_io(b->node, i, bp->id, SPA_IO_Buffers,
+					&bp->io, sizeof(bp->io));
+			spa_assert(res == 0);
+		}
+	}
+}
+
+static void bench_clear(struct bench *b)
+{
+	uint32_t i, j;
+
+	spa_hook_remove(&b->node_listener);
+	spa_hook_remove(&b->listener);
+	pw_filter_destroy(b->filter);
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < b->n_ports; j++)
+			free(b->ports[i][j].buffers);
+}
+
+/* the peers of the filter: provide new input and consume the output */
+static void cycle(struct bench *b)
+{
+	uint32_t i;
+
+	spa_node_process(b->node);
+
+	for (i = 0; i < b->n_ports; i++) {
+		struct spa_io_buffers *in = &b->ports[SPA_DIRECTION_INPUT][i].io;
+		struct spa_io_buffers *out = &b->ports[SPA_DIRECTION_OUTPUT][i].io;
+
+		spa_assert(out->status == SPA_STATUS_HAVE_DATA);
+		in->status = SPA_STATUS_HAVE_DATA;
+		in->buffer_id = 0;
+		out->status = SPA_STATUS_NEED_DATA;
+	}
+}
+
+static void run_test(struct pw_core *core, const char *name, bool array,
+		uint32_t n_ports, uint32_t quantum)
+{
+	struct bench b;
+	struct timespec ts;
+	uint64_t t1, t2, elapsed;
+	uint32_t i;
+
+	bench_init(&b, core, n_ports, array);
+	b.position.clock.duration = quantum;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < MAX_COUNT; i++)
+		cycle(&b);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+	elapsed = t2 - t1;
+
+	fprintf(stderr, "%s: ports %u, quantum %u, elapsed %"PRIu64" count %u = %"PRIu64" ns/cycle\n",
+			name, n_ports, quantum, elapsed, MAX_COUNT, elapsed / MAX_COUNT);
+
+	bench_clear(&b);
+}
+
+int main(int argc, char *argv[])
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct pw_impl_module *module;
+	struct pw_core *core;
+	uint32_t i, j;
+
+	pw_init(&argc, &argv);
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop),
+			pw_properties_new(PW_KEY_CONFIG_NAME, "null", NULL), 0);
+	spa_assert(context != NULL);
+	module = pw_context_load_module(context,
+			"libpipewire-module-protocol-native", NULL, NULL);
+	spa_assert(module != NULL);
+	pw_context_register_export_type(context, &export_type);
+	core = pw_context_connect_self(context, NULL, 0);
+	spa_assert(core != NULL);
+
+	for (i = 0; i < SPA_N_ELEMENTS(port_counts); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(quantums); j++) {
+			run_test(core, "get_dsp_buffer", false, port_counts[i], quantums[j]);
+			run_test(core, "dsp array", true, port_counts[i], quantums[j]);
+		}
+	}
+
+	pw_core_disconnect(core);
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+
+	return 0;
+}
@@ -0,0 +1,156 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <limits.h>
+#include <time.h>
+#include <dlfcn.h>
+
+#include <spa/utils/names.h>
+#include <spa/support/plugin.h>
+
+#include <pipewire/pipewire.h>
+
+#define MAX_COUNT	2000
+
+enum mode {
+	MODE_LOAD,	/* plugin loaded for each handle, enumerate and index */
+	MODE_INDEXED,	/* plugin stays loaded, factory found in the index */
+	MODE_SCAN,	/* plugin stays loaded, factory found by walking the enum function */
+};
+
+static const struct {
+	const char *lib;
+	const char *factory_name;
+} factories[] = {
+	{ "audioconvert/libspa-audioconvert", SPA_NAME_AUDIO_PROCESS_CHANNELMIX },
+	{ "audioconvert/libspa-audioconvert", SPA_NAME_AUDIO_PROCESS_RESAMPLE },
+	{ "audioconvert/libspa-audioconvert", SPA_NAME_AUDIO_CONVERT },
+	{ "support/libspa-support", SPA_NAME_SUPPORT_CPU },
+};
+
+/* what pw_load_spa_handle() did before the factories were indexed */
+static struct spa_handle *scan_handle(void *hnd, const char *factory_name,
+		uint32_t n_support, const struct spa_support support[])
+{
+	spa_handle_factory_enum_func_t enum_func;
+	const struct spa_handle_factory *factory;
+	struct spa_handle *handle;
+	uint32_t index;
+
+	enum_func = dlsym(hnd, SPA_HANDLE_FACTORY_ENUM_FUNC_NAME);
+	spa_assert(enum_func != NULL);
+
+	for (index = 0;;) {
+		spa_assert(enum_func(&factory, &index) > 0);
+		if (factory->version >= 1 &&
+		    strcmp(factory->name, factory_name) == 0)
+			break;
+	}
+	handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+	spa_assert(handle != NULL);
+	spa_assert(spa_handle_factory_init(factory, handle, NULL, support, n_support) >= 0);
+	return handle;
+}
+
+static void run_test(const char *name, enum mode mode)
+{
+	struct spa_support support[32];
+	uint32_t n_support;
+	struct spa_handle *keep[SPA_N_ELEMENTS(factories)], *handle;
+	void *hnd[SPA_N_ELEMENTS(factories)];
+	const char *plugin_dir;
+	char path[PATH_MAX];
+	struct timespec ts;
+	uint64_t t1, t2, elapsed;
+	uint32_t i, j;
+
+	n_support = pw_get_support(support, SPA_N_ELEMENTS(support));
+
+	plugin_dir = getenv("SPA_PLUGIN_DIR");
+
+	/* keep a handle alive so that the plugin stays loaded and indexed */
+	for (j = 0; j < SPA_N_ELEMENTS(factories); j++) {
+		keep[j] = NULL;
+		hnd[j] = NULL;
+		if (mode == MODE_LOAD)
+			continue;
+		keep[j] = pw_load_spa_handle(factories[j].lib,
+				factories[j].factory_name, NULL, n_support, support);
+		spa_assert(keep[j] != NULL);
+		if (mode == MODE_SCAN) {
+			snprintf(path, sizeof(path), "%s/%s.so", plugin_dir, factories[j].lib);
+			hnd[j] = dlopen(path, RTLD_NOW);
+			spa_assert(hnd[j] != NULL);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(factories); j++) {
+			if (mode == MODE_SCAN) {
+				handle = scan_handle(hnd[j], factories[j].factory_name,
+						n_support, support);
+				spa_handle_clear(handle);
+				free(handle);
+				continue;
+			}
+			handle = pw_load_spa_handle(factories[j].lib,
+					factories[j].factory_name, NULL, n_support, support);
+			spa_assert(handle != NULL);
+			pw_unload_spa_handle(handle);
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+	elapsed = t2 - t1;
+
+	fprintf(stderr, "%s: elapsed %"PRIu64" count %u = %"PRIu64" ns/handle\n",
+			name, elapsed, MAX_COUNT,
+			elapsed / (MAX_COUNT * SPA_N_ELEMENTS(factories)));
+
+	for (j = 0; j < SPA_N_ELEMENTS(factories); j++) {
+		if (hnd[j])
+			dlclose(hnd[j]);
+		if (keep[j])
+			pw_unload_spa_handle(keep[j]);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	pw_init(&argc, &argv);
+
+	run_test("load", MODE_LOAD);
+	run_test("indexed", MODE_INDEXED);
+	/* needs the plugin path to dlopen the plugins directly */
+	if (getenv("SPA_PLUGIN_DIR"))
+		run_test("scan", MODE_SCAN);
+
+	pw_deinit();
+
+	return 0;
+}
@@ -0,0 +1,354 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/buffer/alloc.h>
+#include <spa/param/audio/format-utils.h>
+
+#include <pipewire/impl.h>
+
+/* drive the stream node directly, without a graph, so that only the
+ * cost of moving the data between the application and the node is
+ * measured. The node is taken from the context when the stream exports
+ * it, the proxy is never flushed to the server. */
+
+#define CHANNELS	2
+#define RATE		48000
+#define N_BUFFERS	4
+#define MAX_QUANTUM	4096
+#define MAX_COUNT	20000
+
+static const uint32_t quantums[] = { 64, 256, 1024 };
+
+#define VIDEO_BUFFERS	64
+#define VIDEO_PLANES	3
+#define PLANE_SIZE	(64 * 1024)
+#define MAX_RENEGOTIATE	200
+
+static int16_t source[MAX_QUANTUM * CHANNELS];
+static int16_t sink[MAX_QUANTUM * CHANNELS];
+
+struct bench {
+	struct pw_stream *stream;
+	struct spa_node *node;
+	struct spa_io_buffers io;
+	struct spa_io_position position;
+	struct spa_buffer **buffers;
+	uint32_t stride;
+};
+
+static struct pw_impl_node *exported_node;
+
+static struct pw_proxy *export_node(struct pw_core *core,
+		const char *type, const struct spa_dict *props, void *object,
+		size_t user_data_size)
+{
+	exported_node = object;
+	return pw_core_create_object(core, "client-node", PW_TYPE_INTERFACE_Node,
+			PW_VERSION_NODE, props, user_data_size);
+}
+
+static struct pw_export_type export_type = {
+	.type = PW_TYPE_INTERFACE_Node,
+	.func = export_node,
+};
+
+static const struct spa_node_callbacks node_callbacks = {
+	SPA_VERSION_NODE_CALLBACKS,
+};
+
+/* without a format the stream exports its own node, not an adapter */
+static struct spa_node *stream_connect(struct pw_stream *stream, enum pw_stream_flags flags)
+{
+	struct spa_node *node;
+	int res;
+
+	exported_node = NULL;
+	res = pw_stream_connect(stream, PW_DIRECTION_OUTPUT, PW_ID_ANY, flags, NULL, 0);
+	spa_assert(res == 0);
+	spa_assert(exported_node != NULL);
+
+	node = pw_impl_node_get_implementation(exported_node);
+	spa_assert(node != NULL);
+	/* the benchmark is the driver, don't wake up the graph */
+	spa_node_set_callbacks(node, &node_callbacks, NULL);
+	return node;
+}
+
+static void bench_init(struct bench *b, struct pw_core *core, bool ring)
+{
+	struct spa_data datas[1];
+	uint32_t aligns[1] = { 16 };
+	uint8_t buffer[1024];
+	struct spa_pod_builder builder = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	const struct spa_pod *format;
+	int res;
+
+	spa_zero(*b);
+	b->stride = CHANNELS * sizeof(int16_t);
+
+	b->stream = pw_stream_new(core, "bench", pw_properties_new(
+				PW_KEY_NODE_LATENCY, "1024/48000", NULL));
+	spa_assert(b->stream != NULL);
+
+	b->node = stream_connect(b->stream, PW_STREAM_FLAG_RT_PROCESS |
+			(ring ? PW_STREAM_FLAG_RING : 0));
+
+	format = spa_format_audio_raw_build(&builder, SPA_PARAM_Format,
+			&SPA_AUDIO_INFO_RAW_INIT(
+				.format = SPA_AUDIO_FORMAT_S16,
+				.channels = CHANNELS,
+				.rate = RATE));
+	res = spa_node_port_set_param(b->node, SPA_DIRECTION_OUTPUT, 0,
+			SPA_PARAM_Format, 0, format);
+	spa_assert(res == 0);
+
+	datas[0].type = SPA_DATA_MemPtr;
+	datas[0].flags = 0;
+	datas[0].fd = -1;
+	datas[0].mapoffset = 0;
+	datas[0].maxsize = MAX_QUANTUM * b->stride;
+	datas[0].data = NULL;
+	b->buffers = spa_buffer_alloc_array(N_BUFFERS, 0, 0, NULL, 1, datas, aligns);
+	spa_assert(b->buffers != NULL);
+
+	res = spa_node_port_use_buffers(b->node, SPA_DIRECTION_OUTPUT, 0, 0,
+			b->buffers, N_BUFFERS);
+	spa_assert(res == 0);
+
+	b->io.status = SPA_STATUS_NEED_DATA;
+	b->io.buffer_id = SPA_ID_INVALID;
+	res = spa_node_port_set_io(b->node, SPA_DIRECTION_OUTPUT, 0,
+			SPA_IO_Buffers, &b->io, sizeof(b->io));
+	spa_assert(res == 0);
+	spa_node_set_io(b->node, SPA_IO_Position, &b->position, sizeof(b->position));
+}
+
+static void bench_clear(struct bench *b)
+{
+	spa_node_port_use_buffers(b->node, SPA_DIRECTION_OUTPUT, 0, 0, NULL, 0);
+	free(b->buffers);
+	pw_stream_destroy(b->stream);
+}
+
+/* the driver side of a cycle: consume the buffer the stream produced */
+static void consume(struct bench *b)
+{
+	struct spa_data *d;
+
+	spa_node_process(b->node);
+	if (b->io.status == SPA_STATUS_HAVE_DATA &&
+	    b->io.buffer_id < N_BUFFERS) {
+		d = &b->buffers[b->io.buffer_id]->datas[0];
+		memcpy(sink, d->data, d->chunk->size);
+		b->io.status = SPA_STATUS_NEED_DATA;
+	}
+}
+
+static void run_queue(struct bench *b, uint32_t quantum)
+{
+	struct pw_buffer *buf;
+	struct spa_data *d;
+
+	if ((buf = pw_stream_dequeue_buffer(b->stream)) != NULL) {
+		d = &buf->buffer->datas[0];
+		memcpy(d->data, source, quantum * b->stride);
+		d->chunk->offset = 0;
+		d->chunk->size = quantum * b->stride;
+		d->chunk->stride = b->stride;
+		pw_stream_queue_buffer(b->stream, buf);
+	}
+	consume(b);
+}
+
+static void run_ring_write(struct bench *b, uint32_t quantum)
+{
+	pw_stream_ring_write(b->stream, source, quantum);
+	consume(b);
+}
+
+static void run_ring_reserve(struct bench *b, uint32_t quantum)
+{
+	uint32_t done = 0;
+	int32_t n;
+	void *data;
+
+	while (done < quantum &&
+	    (n = pw_stream_ring_reserve(b->stream, &data)) > 0) {
+		n = SPA_MIN((uint32_t)n, quantum - done);
+		memcpy(data, &source[done * CHANNELS], n * b->stride);
+		pw_stream_ring_commit(b->stream, n);
+		done += n;
+	}
+	consume(b);
+}
+
+static void run_test(struct pw_core *core, const char *name, bool ring,
+		uint32_t quantum, void (*func)(struct bench *b, uint32_t quantum))
+{
+	struct bench b;
+	struct timespec ts;
+	uint64_t t1, t2, elapsed;
+	uint32_t i;
+
+	bench_init(&b, core, ring);
+	b.position.clock.duration = quantum;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < MAX_COUNT; i++)
+		func(&b, quantum);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+	elapsed = t2 - t1;
+
+	fprintf(stderr, "%s: quantum %u, elapsed %"PRIu64" count %u = %"PRIu64" ns/cycle\n",
+			name, quantum, elapsed, MAX_COUNT, elapsed / MAX_COUNT);
+
+	bench_clear(&b);
+}
+
+static uint32_t count_mappings(void)
+{
+	FILE *f;
+	char line[512];
+	uint32_t count = 0;
+
+	if ((f = fopen("/proc/self/maps", "r")) == NULL)
+		return 0;
+	while (fgets(line, sizeof(line), f) != NULL)
+		count++;
+	fclose(f);
+	return count;
+}
+
+/* a video like buffer set with all the planes of all the buffers in one
+ * memfd, mapped and unmapped again like on each renegotiation */
+static void run_renegotiate(struct pw_core *core)
+{
+	struct pw_stream *stream;
+	struct spa_node *node;
+	struct spa_data datas[VIDEO_PLANES];
+	uint32_t aligns[VIDEO_PLANES] = { 16, 16, 16 };
+	struct spa_buffer **buffers;
+	struct timespec ts;
+	uint64_t t1, t2, elapsed;
+	uint32_t i, j, before, mapped = 0;
+	int fd, res;
+
+	fd = memfd_create("benchmark-stream", MFD_CLOEXEC);
+	spa_assert(fd >= 0);
+	res = ftruncate(fd, VIDEO_BUFFERS * VIDEO_PLANES * PLANE_SIZE);
+	spa_assert(res == 0);
+
+	for (i = 0; i < VIDEO_PLANES; i++) {
+		datas[i].type = SPA_DATA_MemFd;
+		datas[i].flags = SPA_DATA_FLAG_READWRITE;
+		datas[i].fd = fd;
+		datas[i].maxsize = PLANE_SIZE;
+		datas[i].data = NULL;
+	}
+	buffers = spa_buffer_alloc_array(VIDEO_BUFFERS, SPA_BUFFER_ALLOC_FLAG_NO_DATA, 0, NULL,
+			VIDEO_PLANES, datas, aligns);
+	spa_assert(buffers != NULL);
+	for (i = 0; i < VIDEO_BUFFERS; i++)
+		for (j = 0; j < VIDEO_PLANES; j++)
+			buffers[i]->datas[j].mapoffset = (i * VIDEO_PLANES + j) * PLANE_SIZE;
+
+	stream = pw_stream_new(core, "bench", NULL);
+	spa_assert(stream != NULL);
+	node = stream_connect(stream, PW_STREAM_FLAG_MAP_BUFFERS);
+
+	before = count_mappings();
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	for (i = 0; i < MAX_RENEGOTIATE; i++) {
+		res = spa_node_port_use_buffers(node, SPA_DIRECTION_OUTPUT, 0, 0,
+				buffers, VIDEO_BUFFERS);
+		spa_assert(res == 0);
+		if (i == 0)
+			mapped = count_mappings() - before;
+		spa_node_port_use_buffers(node, SPA_DIRECTION_OUTPUT, 0, 0, NULL, 0);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+	elapsed = t2 - t1;
+
+	fprintf(stderr, "use_buffers: %u buffers, %u planes, mappings %u, "
+			"elapsed %"PRIu64" count %u = %"PRIu64" ns/renegotiation\n",
+			VIDEO_BUFFERS, VIDEO_PLANES, mapped, elapsed, MAX_RENEGOTIATE,
+			elapsed / MAX_RENEGOTIATE);
+
+	pw_stream_destroy(stream);
+	free(buffers);
+	close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct pw_impl_module *module;
+	struct pw_core *core;
+	uint32_t i;
+
+	pw_init(&argc, &argv);
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop),
+			pw_properties_new(PW_KEY_CONFIG_NAME, "null", NULL), 0);
+	spa_assert(context != NULL);
+	module = pw_context_load_module(context,
+			"libpipewire-module-protocol-native", NULL, NULL);
+	spa_assert(module != NULL);
+	pw_context_register_export_type(context, &export_type);
+	core = pw_context_connect_self(context, NULL, 0);
+	spa_assert(core != NULL);
+
+	for (i = 0; i < SPA_N_ELEMENTS(source); i++)
+		source[i] = i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(quantums); i++) {
+		run_test(core, "dequeue/queue", false, quantums[i], run_queue);
+		run_test(core, "ring write", true, quantums[i], run_ring_write);
+		run_test(core, "ring reserve/commit", true, quantums[i], run_ring_reserve);
+	}
+	run_renegotiate(core);
+
+	pw_core_disconnect(core);
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+
+	return 0;
+}
@@ -0,0 +1,179 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <pipewire/impl.h>
+
+#include <spa/utils/names.h>
+
+#define N_UPDATES	200000
+
+struct data {
+	struct pw_main_loop *loop;
+	struct pw_core *core;
+	struct pw_proxy *proxy;
+	struct spa_hook node_listener;
+
+	bool clock_page;
+	struct pw_memmap *map;
+};
+
+static void node_info(void *data, const struct pw_node_info *info)
+{
+	struct data *d = data;
+	const char *str;
+
+	if (info->props &&
+	    (str = spa_dict_lookup(info->props, PW_KEY_NODE_CLOCK_PAGE)) != NULL)
+		d->clock_page = pw_properties_parse_bool(str);
+	pw_main_loop_quit(d->loop);
+}
+
+static void node_param(void *data, int seq, uint32_t id, uint32_t index,
+		uint32_t next, const struct spa_pod *param)
+{
+	struct data *d = data;
+
+	spa_assert(id == SPA_PARAM_IO);
+	spa_assert(index == PW_NODE_CLOCK_PARAM_INDEX);
+
+	d->map = pw_node_clock_map(d->core, param);
+	pw_main_loop_quit(d->loop);
+}
+
+static const struct pw_node_events node_events = {
+	PW_VERSION_NODE_EVENTS,
+	.info = node_info,
+	.param = node_param,
+};
+
+static void test_map(void)
+{
+	struct data d;
+	struct pw_context *context;
+	struct spa_io_clock clock;
+	struct pw_node_clock *page;
+
+	spa_zero(d);
+	d.loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(d.loop),
+			pw_properties_new(PW_KEY_CONFIG_NAME, "null", NULL), 0);
+	spa_assert(context != NULL);
+	pw_context_add_spa_lib(context, "support.*", "support/libspa-support");
+	spa_assert(pw_context_load_module(context,
+			"libpipewire-module-protocol-native", NULL, NULL) != NULL);
+	spa_assert(pw_context_load_module(context,
+			"libpipewire-module-spa-node-factory", NULL, NULL) != NULL);
+
+	d.core = pw_context_connect_self(context, NULL, 0);
+	spa_assert(d.core != NULL);
+
+	d.proxy = pw_core_create_object(d.core,
+			"spa-node-factory",
+			PW_TYPE_INTERFACE_Node,
+			PW_VERSION_NODE,
+			&SPA_DICT_INIT_ARRAY(((struct spa_dict_item[]) {
+				{ SPA_KEY_FACTORY_NAME, SPA_NAME_SUPPORT_NODE_DRIVER },
+				{ PW_KEY_NODE_NAME, "test-driver" }})), 0);
+	spa_assert(d.proxy != NULL);
+	pw_node_add_listener((struct pw_node*)d.proxy, &d.node_listener,
+			&node_events, &d);
+
+	/* drivers advertise the clock page */
+	while (!d.clock_page)
+		pw_main_loop_run(d.loop);
+
+	pw_node_enum_params((struct pw_node*)d.proxy, 0, SPA_PARAM_IO,
+			PW_NODE_CLOCK_PARAM_INDEX, 1, NULL);
+	pw_main_loop_run(d.loop);
+	spa_assert(d.map != NULL);
+	spa_assert(d.map->size == sizeof(struct pw_node_clock));
+
+	/* the page is sealed, it can't be made writable */
+	spa_assert(mprotect(d.map->ptr, d.map->size, PROT_READ | PROT_WRITE) < 0);
+
+	page = d.map->ptr;
+	spa_assert(pw_node_clock_read(page, &clock) == 0);
+
+	pw_memmap_free(d.map);
+	pw_proxy_destroy(d.proxy);
+	pw_core_disconnect(d.core);
+	pw_context_destroy(context);
+	pw_main_loop_destroy(d.loop);
+}
+
+/* write the page the way the driver does */
+static void *clock_writer(void *data)
+{
+	struct pw_node_clock *page = data;
+	uint32_t i, seq;
+
+	for (i = 1; i <= N_UPDATES; i++) {
+		seq = page->seq;
+		__atomic_store_n(&page->seq, seq + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		page->clock.position = i;
+		page->clock.nsec = i * 2;
+		page->clock.next_nsec = i * 3;
+		__atomic_store_n(&page->seq, seq + 2, __ATOMIC_RELEASE);
+	}
+	return NULL;
+}
+
+static void test_read(void)
+{
+	struct pw_node_clock page;
+	struct spa_io_clock clock;
+	pthread_t thread;
+	uint64_t last = 0;
+
+	spa_zero(page);
+	spa_assert(pthread_create(&thread, NULL, clock_writer, &page) == 0);
+
+	while (last < N_UPDATES) {
+		if (pw_node_clock_read(&page, &clock) < 0)
+			continue;
+		/* never a mix of two updates */
+		spa_assert(clock.nsec == clock.position * 2);
+		spa_assert(clock.next_nsec == clock.position * 3);
+		spa_assert(clock.position >= last);
+		last = clock.position;
+	}
+	pthread_join(thread, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+	pw_init(&argc, &argv);
+
+	alarm(20); /* watchdog; terminate after 20 seconds */
+
+	test_read();
+	test_map();
+
+	return 0;
+}
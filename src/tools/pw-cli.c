@@ -60,6 +60,20 @@ struct data {
 	unsigned int interactive:1;
 	unsigned int monitoring:1;
 	unsigned int quit:1;
+	unsigned int batch:1;
+	unsigned int barrier:1;
+	unsigned int waiting:1;
+
+	struct pw_array batch_cmds;
+	uint32_t batch_errors;
+};
+
+/* a command sent in batch mode, seq is the sync that was queued after it so
+ * that errors can be matched with the command that caused them */
+struct batch_cmd {
+	struct remote_data *rd;
+	uint32_t line;
+	int seq;
 };
 
 struct global {
@@ -220,6 +234,7 @@ static bool do_set_param(struct data *data, const char *cmd, char *args, char **
 static bool do_permissions(struct data *data, const char *cmd, char *args, char **error);
 static bool do_get_permissions(struct data *data, const char *cmd, char *args, char **error);
 static bool do_dump(struct data *data, const char *cmd, char *args, char **error);
+static bool do_sync(struct data *data, const char *cmd, char *args, char **error);
 
 #define DUMP_NAMES "Core|Module|Device|Node|Port|Factory|Client|Link|Session|Endpoint|EndpointStream"
 
@@ -244,6 +259,7 @@ static struct command command_list[] = {
 	{ "get-permissions", "gp", "Get permissions of a client <client-id>", do_get_permissions },
 	{ "dump", "D", "Dump objects in ways that are cleaner for humans to understand "
 		 "[short|deep|resolve|notype] [-sdrt] [all|"DUMP_NAMES"|<id>]", do_dump },
+	{ "sync", "sy", "Wait until the remote processed all previous commands", do_sync },
 };
 
 static bool do_help(struct data *data, const char *cmd, char *args, char **error)
@@ -306,7 +322,8 @@ static void on_core_done(void *_data, uint32_t id, int seq)
 	if (seq == rd->prompt_pending) {
 		if (d->interactive)
 			show_prompt(rd);
-		else
+		else if (!d->batch || d->waiting)
+			/* in batch mode, the loop only runs in wait_remote() */
 			pw_main_loop_quit(d->loop);
 	}
 }
@@ -410,14 +427,36 @@ static const struct pw_registry_events registry_events = {
 	.global_remove = registry_event_global_remove,
 };
 
+static struct batch_cmd *find_batch_cmd(struct data *data, struct remote_data *rd, int seq)
+{
+	struct batch_cmd *c;
+
+	pw_array_for_each(c, &data->batch_cmds) {
+		if (c->rd == rd && SPA_RESULT_ASYNC_SEQ(c->seq) >= seq)
+			return c;
+	}
+	return NULL;
+}
+
 static void on_core_error(void *_data, uint32_t id, int seq, int res, const char *message)
 {
 	struct remote_data *rd = _data;
 	struct data *data = rd->data;
+	struct batch_cmd *c;
 
 	pw_log_error("remote %p: error id:%u seq:%d res:%d (%s): %s", rd,
 			id, seq, res, spa_strerror(res), message);
 
+	if (data->batch) {
+		if ((c = find_batch_cmd(data, rd, seq)) != NULL)
+			fprintf(stderr, "Error: line %u: seq %d, id %u: %s (%s)\n",
+					c->line, seq, id, message, spa_strerror(res));
+		else
+			fprintf(stderr, "Error: seq %d, id %u: %s (%s)\n",
+					seq, id, message, spa_strerror(res));
+		data->batch_errors++;
+	}
+
 	if (id == PW_ID_CORE && res == -EPIPE)
 		pw_main_loop_quit(data->loop);
 }
@@ -2899,6 +2938,81 @@ static bool parse(struct data *data, char *buf, size_t size, char **error)
 	return false;
 }
 
+static bool do_sync(struct data *data, const char *cmd, char *args, char **error)
+{
+	/* outside of batch mode every command is already followed by a sync */
+	data->barrier = true;
+	return true;
+}
+
+static void wait_remote(struct data *data, struct remote_data *rd, int seq)
+{
+	rd->prompt_pending = seq;
+	data->waiting = true;
+	pw_main_loop_run(data->loop);
+	data->waiting = false;
+}
+
+/* Send the commands of a file without waiting for the remote after each
+ * one. Only a sync command, a switch of remote and the end of the file wait
+ * for the remote to catch up. */
+static int run_batch(struct data *data, FILE *f)
+{
+	struct pw_loop *l = pw_main_loop_get_loop(data->loop);
+	struct remote_data *rd = data->current;
+	struct batch_cmd *c;
+	char *buf = NULL, *error;
+	size_t size = 0;
+	ssize_t len;
+	uint32_t line = 0;
+	int seq;
+
+	data->batch = true;
+	pw_array_init(&data->batch_cmds, 64 * sizeof(struct batch_cmd));
+
+	while (!data->quit && (len = getline(&buf, &size, f)) >= 0) {
+		line++;
+
+		data->barrier = false;
+		if (!parse(data, buf, len, &error)) {
+			fprintf(stderr, "Error: line %u: \"%s\"\n", line, error);
+			free(error);
+			data->batch_errors++;
+			continue;
+		}
+		if (data->current == NULL)
+			break;
+
+		if (data->current != rd) {
+			/* wait for the registry of the new remote */
+			rd = data->current;
+			wait_remote(data, rd, pw_core_sync(rd->core, 0, 0));
+			continue;
+		}
+
+		seq = pw_core_sync(rd->core, 0, 0);
+		if ((c = pw_array_add(&data->batch_cmds, sizeof(*c))) != NULL) {
+			c->rd = rd;
+			c->line = line;
+			c->seq = seq;
+		}
+		if (data->barrier)
+			wait_remote(data, rd, seq);
+		else
+			/* flush the commands and handle replies, without blocking */
+			pw_loop_iterate(l, 0);
+	}
+	free(buf);
+
+	if (!data->quit && data->current)
+		wait_remote(data, data->current, pw_core_sync(data->current->core, 0, 0));
+
+	pw_array_clear(&data->batch_cmds);
+	data->batch = false;
+
+	return data->batch_errors > 0 ? -EIO : 0;
+}
+
 static void do_input(void *data, int fd, uint32_t mask)
 {
 	struct data *d = data;
@@ -2951,7 +3065,9 @@ static void show_help(struct data *data, const char *name)
 		"  -h, --help                            Show this help\n"
 		"      --version                         Show version\n"
 		"  -d, --daemon                          Start as daemon (Default false)\n"
-		"  -r, --remote                          Remote daemon name\n\n",
+		"  -r, --remote                          Remote daemon name\n"
+		"  -f, --file                            Run the commands in a file, - for\n"
+		"                                        stdin, without waiting for each one\n\n",
 		name);
 
 	do_help(data, "help", "", NULL);
@@ -2962,6 +3078,7 @@ int main(int argc, char *argv[])
 	struct data data = { 0 };
 	struct pw_loop *l;
 	char *opt_remote = NULL;
+	char *opt_file = NULL;
 	char *error;
 	bool daemon = false;
 	struct remote_data *rd;
@@ -2970,13 +3087,14 @@ int main(int argc, char *argv[])
 		{ "version",	no_argument,		 NULL, 'V' },
 		{ "daemon",	no_argument,		 NULL, 'd' },
 		{ "remote",	required_argument,	 NULL, 'r' },
+		{ "file",	required_argument,	 NULL, 'f' },
 		{ NULL,	0, NULL, 0}
 	};
-	int c, i;
+	int c, i, res = 0;
 
 	pw_init(&argc, &argv);
 
-	while ((c = getopt_long(argc, argv, "hVdr:", long_options, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "hVdr:f:", long_options, NULL)) != -1) {
 		switch (c) {
 		case 'h':
 			show_help(&data, argv[0]);
@@ -2995,6 +3113,9 @@ int main(int argc, char *argv[])
 		case 'r':
 			opt_remote = optarg;
 			break;
+		case 'f':
+			opt_file = optarg;
+			break;
 		default:
 			show_help(&data, argv[0]);
 			return -1;
@@ -3026,7 +3147,23 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
-	if (optind == argc) {
+	if (opt_file != NULL) {
+		FILE *f;
+
+		if (strcmp(opt_file, "-") == 0)
+			f = stdin;
+		else if ((f = fopen(opt_file, "re")) == NULL) {
+			fprintf(stderr, "Error: can't open \"%s\": %m\n", opt_file);
+			return -1;
+		}
+
+		pw_main_loop_run(data.loop);
+
+		if (!data.quit && run_batch(&data, f) < 0)
+			res = -1;
+		if (f != stdin)
+			fclose(f);
+	} else if (optind == argc) {
 		data.interactive = true;
 
 		pw_loop_add_io(l, STDIN_FILENO, SPA_IO_IN|SPA_IO_HUP, false, do_input, &data);
@@ -3063,5 +3200,5 @@ int main(int argc, char *argv[])
 	pw_map_clear(&data.vars);
 	pw_deinit();
 
-	return 0;
+	return res;
 }